@@ -5,11 +5,20 @@ use dash_compiler::{
     shared::src::SrcPool,
     parser::parse::{Node, NodePool},
     tokenize,
-    checker::pool::ASTPool, check_coherency,
+    checker::pool::ASTPool,
+    prelude::Prelude,
+    emit_bytecode,
+    incremental::CompileDb,
     // check_coherency
 };
 use normalize_path::NormalizePath;
-use std::path::PathBuf;
+use std::{path::{Path, PathBuf}, time::Duration};
+
+/// How often watch mode looks for changed sources
+const WATCH_INTERVAL: Duration = Duration::from_millis(500);
+/// Watch mode keeps what it knows about at most this many files, evicting
+/// the ones that haven't been seen for the longest
+const WATCH_MAX_FILES: usize = 1024;
 
 /// Simple program to greet a person
 #[derive(Parser, Debug)]
@@ -29,6 +38,71 @@ struct Args {
 
     #[clap(long)]
     debug_log_matches: bool,
+
+    /// Compile each source file into a `.dashc` module image next to it
+    #[clap(long)]
+    emit: bool,
+
+    /// Use a precompiled standard library image instead of checking the 
+    /// standard library's sources
+    #[clap(long)]
+    std: Option<PathBuf>,
+
+    /// Write the precompiled standard library image to a file and exit
+    #[clap(long)]
+    emit_std: Option<PathBuf>,
+
+    /// Keep checking the sources whenever they change. Only files that have
+    /// changed are checked again
+    #[clap(long)]
+    watch: bool,
+}
+
+/// Check the sources in `src_dir` every time they change, until the
+/// program is stopped
+fn watch(src_dir: &Path, emit: bool) -> ! {
+    let logger = Logger::default();
+    let mut db = CompileDb::with_max_files(WATCH_MAX_FILES);
+    let mut files: Vec<PathBuf> = vec![];
+    loop {
+        let found = if src_dir.is_file() {
+            vec![src_dir.to_path_buf()]
+        }
+        else {
+            SrcPool::find_src_files(src_dir.to_path_buf())
+        };
+        for path in files.iter().filter(|p| !found.contains(*p)) {
+            db.remove_source(path);
+        }
+        files = found;
+
+        let mut changed = vec![];
+        for path in &files {
+            // Files that are being written may not be readable yet; they're
+            // picked up on the next poll
+            let Ok(data) = std::fs::read_to_string(path) else { continue };
+            if db.set_source(path.clone(), data) {
+                changed.push(path.clone());
+            }
+        }
+        let stats = db.update();
+        if stats.checked > 0 {
+            if emit {
+                for path in &changed {
+                    let Some(image) = db.image(path) else { continue };
+                    if let Err(e) = std::fs::write(path.with_extension("dashc"), image) {
+                        println!("Unable to write {}: {e}", path.with_extension("dashc").display());
+                    }
+                }
+            }
+            logger.lock().unwrap().merge(changed.iter().map(|p| db.diagnostics(p).to_vec()));
+            println!(
+                "Checked {} changed files and reused {} unchanged ones",
+                stats.checked, stats.reused
+            );
+        }
+        std::thread::sleep(WATCH_INTERVAL);
+    }
 }
 
 fn main() {
@@ -36,7 +110,29 @@ fn main() {
     let cur_dir = std::env::current_dir().expect("Unable to get current directory");
 
     let logger = Logger::default();
+
+    if let Some(path) = args.std {
+        let image = std::fs::read(&path).unwrap_or_else(|e| {
+            println!("Unable to read {}: {e}", path.display());
+            std::process::exit(1);
+        });
+        if let Err(e) = Prelude::load_std(&image) {
+            println!("Unable to load {}: {e}", path.display());
+            std::process::exit(1);
+        }
+    }
+    if let Some(path) = args.emit_std {
+        if let Err(e) = std::fs::write(&path, Prelude::std().to_image()) {
+            println!("Unable to write {}: {e}", path.display());
+            std::process::exit(1);
+        }
+        return;
+    }
+
     let src_dir = args.dir.map(|d| cur_dir.join(d).normalize()).unwrap_or(cur_dir);
+    if args.watch {
+        watch(&src_dir, args.emit);
+    }
     let src_pool = SrcPool::new_from_dir(src_dir).expect("Unable to find sources");
     
     if args.debug_tokens {
@@ -60,8 +156,20 @@ fn main() {
         }
     }
 
-    for ast in &mut ast_pool {
-        check_coherency(ast, &mut node_pool, logger.clone());
+    ast_pool.check_all(&mut node_pool, Prelude::std(), logger.clone());
+
+    if args.emit && logger.lock().unwrap().errors() == 0 {
+        for ast in &ast_pool {
+            let src = ast.get(&node_pool).span_or_builtin(&node_pool).0;
+            let Some(image) = emit_bytecode(ast, &node_pool, Prelude::std(), logger.clone()) else {
+                continue;
+            };
+            let path = PathBuf::from(src.name()).with_extension("dashc");
+            if let Err(e) = std::fs::write(&path, image) {
+                println!("Unable to write {}: {e}", path.display());
+                std::process::exit(1);
+            }
+        }
     }
 
     let ref_logger = logger.lock().unwrap();
@@ -0,0 +1,95 @@
+use std::{process::ExitCode, sync::{Arc, Mutex}};
+use dash_compiler::{
+    checker::{coherency::Checker, pool::ASTPool},
+    parser::parse::NodePool,
+    prelude::Prelude,
+    shared::{logger::Logger, src::{Span, Src, SrcPool, Underline}},
+    token_count,
+};
+
+mod harness;
+use harness::Bench;
+
+/// Generate a file of `count` functions that each call the next one, which
+/// is only declared after them. Every call is a forward reference, so the
+/// checker has to come back to each function once its callee is declared
+fn forward_refs(count: usize) -> String {
+    let mut src = String::new();
+    for i in 0..count {
+        if i + 1 < count {
+            src += &format!("fun f{i}(x: int) -> int {{\n    f{}(x) + {i}\n}}\n", i + 1);
+        }
+        else {
+            src += &format!("fun f{i}(x: int) -> int {{\n    x\n}}\n");
+        }
+    }
+    src += "f0(1)\n";
+    src
+}
+
+/// Generate a file of `count` independent functions with a bit of
+/// everything in their bodies
+fn functions(count: usize) -> String {
+    let mut src = String::new();
+    for i in 0..count {
+        src += &format!(
+            "/// Function number {i}\n\
+            fun fun{i}(a: int, b: float, name: string) -> int {{\n    \
+                let x = a * {i} + {};\n    \
+                let label = \"item {i}: \" + name;\n    \
+                if x > 100 && b < 2.5 {{ x - 1 }} else {{ x + a }}\n\
+            }}\n",
+            i * 7 % 100,
+        );
+    }
+    src
+}
+
+/// Logger that drops every message, so only the compiler itself is timed
+fn quiet() -> Arc<Mutex<Logger>> {
+    Logger::new(|_| {})
+}
+
+fn main() -> ExitCode {
+    let mut bench = Bench::from_args();
+    // Checking against Std shouldn't be part of the first benchmark's time
+    Prelude::std();
+
+    let large = Src::from_memory("large.dash", functions(10_000));
+    println!("(large.dash is {} KiB)", large.data().len() / 1024);
+    bench.run("tokenizer/large_file", || {
+        token_count(&large, quiet())
+    });
+
+    for files in [1, 4, 16, 64] {
+        let srcs = SrcPool::new_from_srcs(
+            (0..files).map(|i| Src::from_memory(format!("file{i}.dash"), functions(2_000 / files))).collect()
+        );
+        bench.run(&format!("parse_src_pool/{files}_files"), || {
+            let mut pool = NodePool::new();
+            ASTPool::parse_src_pool(&mut pool, &srcs, quiet());
+            pool
+        });
+    }
+
+    for count in [100, 1_000] {
+        let srcs = SrcPool::new_from_srcs(vec![Src::from_memory("refs.dash", forward_refs(count))]);
+        bench.run(&format!("try_resolve/forward_refs_{count}"), || {
+            let mut pool = NodePool::new();
+            let logger = quiet();
+            let mut ast = *ASTPool::parse_src_pool(&mut pool, &srcs, logger.clone()).iter().next().unwrap();
+            Checker::try_resolve(&mut ast, &mut pool, Prelude::std(), logger)
+        });
+    }
+
+    // Every diagnostic shows the lines it points at, so files with many
+    // errors look up many locations
+    let spans = (0..1_000).map(|i| i * large.data().len() / 1_000).collect::<Vec<_>>();
+    bench.run("diagnostics/underline_1000", || {
+        spans.iter()
+            .map(|&offset| Span(&large, offset..offset + 1).underlined(Underline::Squiggle).len())
+            .sum::<usize>()
+    });
+
+    bench.finish()
+}
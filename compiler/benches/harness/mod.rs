@@ -0,0 +1,152 @@
+use std::{
+    collections::HashMap,
+    fs,
+    hint::black_box,
+    io::Write,
+    path::PathBuf,
+    process::{Command, ExitCode},
+    time::{Duration, Instant},
+};
+
+// A minimal benchmark runner shared by the compiler's benchmarks. Results
+// can be appended to a history file with `--history FILE`, and every run is
+// compared against the last run from a different commit in that file, so
+// regressions show up as soon as they're committed. The runtime benchmarks
+// in mod/bench write the same format, so both can share one history file
+
+/// How long a single sample of a benchmark should take
+const SAMPLE_TIME: Duration = Duration::from_millis(20);
+const SAMPLES: usize = 10;
+
+struct BenchResult {
+    name: String,
+    ns_per_iter: f64,
+}
+
+pub struct Bench {
+    filter: Option<String>,
+    history: Option<PathBuf>,
+    /// How much slower than the previous run a benchmark may get before it
+    /// counts as a regression, in percent
+    threshold: f64,
+    results: Vec<BenchResult>,
+}
+
+impl Bench {
+    /// Parse the options passed through `cargo bench -- [FILTER]
+    /// [--history FILE] [--threshold PERCENT]`
+    pub fn from_args() -> Self {
+        let mut bench = Self { filter: None, history: None, threshold: 10.0, results: vec![] };
+        let mut args = std::env::args().skip(1);
+        while let Some(arg) = args.next() {
+            match arg.as_str() {
+                "--history" => bench.history = args.next().map(PathBuf::from),
+                "--threshold" => {
+                    bench.threshold = args.next().and_then(|t| t.parse().ok()).unwrap_or(bench.threshold);
+                }
+                // Cargo passes this to every benchmark
+                "--bench" => {}
+                other => bench.filter = Some(other.to_string()),
+            }
+        }
+        bench
+    }
+
+    /// Time `f`, which should do one iteration of the benchmark. `f` is
+    /// called in batches long enough to be timed reliably, and the median
+    /// time of a batch is reported
+    pub fn run<T, F: FnMut() -> T>(&mut self, name: &str, mut f: F) {
+        if self.filter.as_ref().is_some_and(|filter| !name.contains(filter.as_str())) {
+            return;
+        }
+        // Warm up and find out how many iterations fill a sample
+        let start = Instant::now();
+        black_box(f());
+        let once = start.elapsed().max(Duration::from_nanos(1));
+        let iters = (SAMPLE_TIME.as_nanos() / once.as_nanos()).clamp(1, 1 << 24) as u32;
+
+        let mut samples = (0..SAMPLES)
+            .map(|_| {
+                let start = Instant::now();
+                for _ in 0..iters {
+                    black_box(f());
+                }
+                start.elapsed().as_nanos() as f64 / iters as f64
+            })
+            .collect::<Vec<_>>();
+        samples.sort_by(f64::total_cmp);
+        let ns_per_iter = samples[SAMPLES / 2];
+        println!("{name:<40} {:>14}", format_ns(ns_per_iter));
+        self.results.push(BenchResult { name: name.to_string(), ns_per_iter });
+    }
+
+    /// Compare the results against the history file and add them to it.
+    /// Fails if any benchmark regressed
+    pub fn finish(self) -> ExitCode {
+        let Some(history) = &self.history else { return ExitCode::SUCCESS };
+        let commit = current_commit();
+
+        let previous = fs::read_to_string(history).unwrap_or_default();
+        let mut baseline = HashMap::new();
+        for line in previous.lines() {
+            let Ok(entry) = serde_json::from_str::<serde_json::Value>(line) else { continue };
+            let (Some(name), Some(ns), Some(from)) = (entry["name"].as_str(), entry["ns"].as_f64(), entry["commit"].as_str()) else {
+                continue;
+            };
+            if from != commit {
+                baseline.insert(name.to_string(), (from.to_string(), ns));
+            }
+        }
+
+        let mut regressions = 0;
+        for result in &self.results {
+            let Some((from, ns)) = baseline.get(&result.name) else { continue };
+            let change = (result.ns_per_iter / ns - 1.0) * 100.0;
+            if change > self.threshold {
+                println!("REGRESSION {:<40} {:+.1}% since {from}", result.name, change);
+                regressions += 1;
+            }
+            else if change < -self.threshold {
+                println!("improved   {:<40} {:+.1}% since {from}", result.name, change);
+            }
+        }
+
+        let file = fs::OpenOptions::new().create(true).append(true).open(history);
+        let written = file.and_then(|mut file| {
+            for result in &self.results {
+                let entry = serde_json::json!({ "commit": commit, "name": result.name, "ns": result.ns_per_iter });
+                writeln!(file, "{entry}")?;
+            }
+            Ok(())
+        });
+        if let Err(e) = written {
+            eprintln!("Unable to write {}: {e}", history.display());
+            return ExitCode::FAILURE;
+        }
+        if regressions > 0 { ExitCode::FAILURE } else { ExitCode::SUCCESS }
+    }
+}
+
+/// The commit the benchmarks were built from. `DASH_BENCH_LABEL` can be set
+/// to tell apart runs of uncommitted changes
+fn current_commit() -> String {
+    if let Ok(label) = std::env::var("DASH_BENCH_LABEL") {
+        return label;
+    }
+    Command::new("git")
+        .args(["rev-parse", "--short", "HEAD"])
+        .output()
+        .ok()
+        .filter(|out| out.status.success())
+        .map(|out| String::from_utf8_lossy(&out.stdout).trim().to_string())
+        .unwrap_or_else(|| "unknown".to_string())
+}
+
+fn format_ns(ns: f64) -> String {
+    match ns {
+        ns if ns < 1e3 => format!("{ns:.1} ns"),
+        ns if ns < 1e6 => format!("{:.2} µs", ns / 1e3),
+        ns if ns < 1e9 => format!("{:.2} ms", ns / 1e6),
+        ns => format!("{:.2} s", ns / 1e9),
+    }
+}
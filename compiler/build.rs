@@ -0,0 +1,50 @@
+use std::{fs, io, path::{Path, PathBuf}};
+
+// Compiled images are cached by the compiler version that produced them, but
+// most changes to code generation don't bump the crate or image version. The
+// build ID is a hash of everything that can change the compiler's output, so
+// every build whose sources differ gets a different version string
+
+/// Everything the output of the compiler depends on, relative to this crate
+const INPUTS: &[&str] = &["src", "macros/src", "../lang/Std"];
+
+fn collect_files(dir: &Path, files: &mut Vec<PathBuf>) -> io::Result<()> {
+    for entry in fs::read_dir(dir)? {
+        let path = entry?.path();
+        if path.is_dir() {
+            collect_files(&path, files)?;
+        }
+        else {
+            files.push(path);
+        }
+    }
+    Ok(())
+}
+
+/// 64-bit FNV-1a, which unlike `DefaultHasher` is the same on every Rust
+/// version
+fn fnv1a(hash: &mut u64, bytes: &[u8]) {
+    for byte in bytes {
+        *hash ^= *byte as u64;
+        *hash = hash.wrapping_mul(0x100000001b3);
+    }
+}
+
+fn main() {
+    let mut files = Vec::new();
+    for input in INPUTS {
+        println!("cargo:rerun-if-changed={input}");
+        collect_files(Path::new(input), &mut files).expect("Unable to list compiler sources");
+    }
+    // Directory listings aren't ordered
+    files.sort();
+
+    let mut hash = 0xcbf29ce484222325;
+    for file in &files {
+        // Paths are hashed with forward slashes so the ID is the same on
+        // every platform
+        fnv1a(&mut hash, file.to_string_lossy().replace('\\', "/").as_bytes());
+        fnv1a(&mut hash, &fs::read(file).expect("Unable to read compiler source"));
+    }
+    println!("cargo:rustc-env=DASH_COMPILER_BUILD_ID={hash:016x}");
+}
@@ -103,7 +103,11 @@ fn impl_ast_item(
     quote! {
         #target
         impl #impl_generics crate::parser::parse::Node for #target_name #ty_generics #where_clause {
-            fn children(&self) -> Vec<&dyn crate::checker::resolve::ResolveRef> {
+            #[allow(unused_variables)]
+            fn for_each_child(
+                &self,
+                f: &mut dyn FnMut(&dyn crate::checker::resolve::ResolveRef)
+            ) {
                 #children_impl
             }
             #span_impl
@@ -238,10 +242,10 @@ pub fn token(args: TokenStream, stream: TokenStream) -> TokenStream {
             }
         },
         if args.value_is_token_tree {
-            quote! { vec![&self.value] }
+            quote! { f(&self.value); }
         }
         else {
-            quote! { Default::default() }
+            quote! {}
         },
         Some(quote! {
             fn span(&self, _: &crate::parser::parse::NodePool) -> Option<crate::shared::src::ArcSpan> {
@@ -390,7 +394,7 @@ fn field_to_tokens(data: &ast::Fields<ParseField>, self_name: Path) -> (TokenStr
                     #i: crate::parser::parse::ParseRef::parse_ref(pool, src.clone(), tokenizer)?,
                 });
                 children_impl.extend(quote! {
-                    (&self.#i as &dyn crate::checker::resolve::ResolveRef),
+                    f(&self.#i);
                 });
             }
             else {
@@ -398,7 +402,7 @@ fn field_to_tokens(data: &ast::Fields<ParseField>, self_name: Path) -> (TokenStr
                     crate::parser::parse::ParseRef::parse_ref(pool, src.clone(), tokenizer)?,
                 });
                 children_impl.extend(quote! {
-                    (&self.#field_ix as &dyn crate::checker::resolve::ResolveRef),
+                    f(&self.#field_ix);
                 });
             }
             if peek_ix < peek_count {
@@ -453,9 +457,7 @@ fn field_to_tokens(data: &ast::Fields<ParseField>, self_name: Path) -> (TokenStr
             #peek_impl
             peeked == #peek_count
         },
-        quote! {
-            vec![#children_impl]
-        }
+        children_impl
     )
 }
 
@@ -490,7 +492,7 @@ impl ToTokens for ParseReceiver {
                 for variant in data {
                     let v = &variant.ident;
                     if variant.fields.is_unit() {
-                        children_impl.extend(quote! { Self::#v => Default::default(), });
+                        children_impl.extend(quote! { Self::#v => {} });
                         // No peeking or parsing unit variants
                     }
                     else {
@@ -520,7 +522,7 @@ impl ToTokens for ParseReceiver {
                                 else {
                                     names.extend(quote! { #name, });
                                     children.extend(quote! {
-                                        (#name as &dyn crate::checker::resolve::ResolveRef),
+                                        f(#name);
                                     });
                                 }
                             }
@@ -537,14 +539,14 @@ impl ToTokens for ParseReceiver {
                                 else {
                                     names.extend(quote! { #c, });
                                     children.extend(quote! {
-                                        (#c as &dyn crate::checker::resolve::ResolveRef),
+                                        f(#c);
                                     });
                                 }
                             }
                             destruct = quote! { (#names) };
                         };
                         children_impl.extend(quote! {
-                            Self::#v #destruct => vec![#children],
+                            Self::#v #destruct => { #children }
                         });
                     }
                 }
@@ -654,3 +656,98 @@ pub fn derive_resolve(input: TokenStream) -> TokenStream {
         }
     }.to_token_stream().into()
 }
+
+#[derive(FromDeriveInput)]
+#[darling(supports(enum_newtype))]
+struct EmitReceiver {
+    ident: syn::Ident,
+    generics: syn::Generics,
+    data: ast::Data<ResolveVariant, ()>,
+}
+
+impl ToTokens for EmitReceiver {
+    fn to_tokens(&self, tokens: &mut TokenStream2) {
+        let emit;
+        let emit_operand;
+        let const_value;
+
+        match &self.data {
+            ast::Data::Struct(_) => {
+                unimplemented!("structs not yet supported")
+            }
+            ast::Data::Enum(data) => {
+                let mut emit_matches = quote! {};
+                let mut emit_operand_matches = quote! {};
+                let mut const_value_matches = quote! {};
+                for v in data {
+                    let ident = &v.ident;
+                    emit_matches.extend(quote_spanned! {
+                        v.ident.span() =>
+                        Self::#ident(value) => crate::codegen::emit::EmitRef::emit_ref(value, pool, emitter, dst),
+                    });
+                    emit_operand_matches.extend(quote_spanned! {
+                        v.ident.span() =>
+                        Self::#ident(value) => crate::codegen::emit::EmitRef::emit_operand_ref(value, pool, emitter),
+                    });
+                    const_value_matches.extend(quote_spanned! {
+                        v.ident.span() =>
+                        Self::#ident(value) => crate::codegen::emit::EmitRef::const_value_ref(value, pool),
+                    });
+                }
+                emit = quote! {
+                    match self {
+                        #emit_matches
+                    }
+                };
+                emit_operand = quote! {
+                    match self {
+                        #emit_operand_matches
+                    }
+                };
+                const_value = quote! {
+                    match self {
+                        #const_value_matches
+                    }
+                };
+            }
+        }
+
+        let name = &self.ident;
+        let (impl_generics, ty_generics, where_clause) = self.generics.split_for_impl();
+        tokens.extend(quote! {
+            impl #impl_generics crate::codegen::emit::EmitNode for #name #ty_generics #where_clause {
+                fn emit_node(
+                    &self,
+                    pool: &crate::parser::parse::NodePool,
+                    emitter: &mut crate::codegen::emit::Emitter,
+                    dst: Option<crate::codegen::bytecode::Reg>
+                ) -> crate::codegen::emit::EmitResult {
+                    #emit
+                }
+                fn emit_operand(
+                    &self,
+                    pool: &crate::parser::parse::NodePool,
+                    emitter: &mut crate::codegen::emit::Emitter
+                ) -> crate::codegen::emit::EmitResult<crate::codegen::bytecode::Reg> {
+                    #emit_operand
+                }
+                fn const_value(
+                    &self,
+                    pool: &crate::parser::parse::NodePool
+                ) -> Option<crate::codegen::fold::ConstValue> {
+                    #const_value
+                }
+            }
+        });
+    }
+}
+
+#[proc_macro_derive(EmitNode)]
+pub fn derive_emit(input: TokenStream) -> TokenStream {
+    match EmitReceiver::from_derive_input(&syn::parse(input).expect("Couldn't parse item")) {
+        Ok(v) => v,
+        Err(e) => {
+            return e.write_errors().into();
+        }
+    }.to_token_stream().into()
+}
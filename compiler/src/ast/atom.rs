@@ -1,9 +1,10 @@
 
-use dash_macros::{ParseNode, ResolveNode};
+use dash_macros::{ParseNode, ResolveNode, EmitNode};
 use super::{expr::{Expr, IdentPath, ExprList}, token::{lit, kw}};
 use crate::{
     ast::token::delim,
-    checker::{resolve::ResolveNode, coherency::Checker, ty::Ty, path}, parser::parse::{NodePool, Node}, shared::logger::{Message, Level, LoggerRef}
+    checker::{resolve::ResolveNode, coherency::Checker, ty::Ty, path}, parser::parse::{NodePool, Node}, shared::logger::{Message, Level, LoggerRef},
+    codegen::{emit::{EmitNode, Emitter, EmitResult, Binding}, bytecode::{Op, Instr, Reg}}
 };
 
 #[derive(Debug, ParseNode)]
@@ -43,7 +44,47 @@ impl ResolveNode for ItemUseNode {
     }
 }
 
-#[derive(Debug, ParseNode, ResolveNode)]
+impl ItemUseNode {
+    fn binding(&self, pool: &NodePool, emitter: &mut Emitter) -> EmitResult<Binding> {
+        match self {
+            Self::Ident(i) => emitter.lookup(&i.get(pool).to_path(pool).to_full(), self.span(pool)),
+            Self::This(_) => Err(emitter.error("'this' is not supported at runtime yet", self.span(pool))),
+        }
+    }
+}
+
+impl EmitNode for ItemUseNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        let binding = self.binding(pool, emitter)?;
+        let Some(dst) = dst else { return Ok(()) };
+        match binding {
+            Binding::Local(reg) => if reg != dst {
+                emitter.emit(Instr::abc(Op::Move, dst, reg, 0));
+            }
+            Binding::Global(global) => {
+                emitter.emit(Instr::abx(Op::GetGlobal, dst, global));
+            }
+            Binding::Function(id) => {
+                emitter.emit(Instr::abx(Op::LoadFunction, dst, id));
+            }
+            Binding::Native(_) => {
+                return Err(emitter.error("Extern functions can only be called directly", self.span(pool)));
+            }
+        }
+        Ok(())
+    }
+    fn emit_operand(&self, pool: &NodePool, emitter: &mut Emitter) -> EmitResult<Reg> {
+        // Locals can be used in place
+        if let Binding::Local(reg) = self.binding(pool, emitter)? {
+            return Ok(reg);
+        }
+        let reg = emitter.alloc_reg()?;
+        self.emit_node(pool, emitter, Some(reg))?;
+        Ok(reg)
+    }
+}
+
+#[derive(Debug, ParseNode, ResolveNode, EmitNode)]
 #[parse(expected = "expression")]
 pub enum AtomNode {
     ClosedExpr(delim::Parenthesized<Expr>),
@@ -2,11 +2,12 @@
 use crate::{
     parser::parse::{SeparatedWithTrailing, DontExpect, Node, NodePool},
     add_compile_message,
-    checker::{resolve::{ResolveNode, ResolveRef}, coherency::{Checker, ScopeID}, ty::Ty, entity::Entity, path},
-    shared::{src::ArcSpan, logger::{Message, Level, Note}}, try_resolve_ref
+    checker::{resolve::{ResolveNode, ResolveRef}, coherency::{Checker, ScopeID}, ty::Ty, entity::Entity, path, Ice},
+    shared::{src::ArcSpan, logger::{Message, Level, Note}}, try_resolve_ref,
+    codegen::{emit::{EmitNode, EmitRef, Emitter, EmitResult, Binding}, bytecode::{Op, Instr, Reg}}
 };
 use super::{token::{kw, op, punct, delim, Ident}, ty::TypeExpr, expr::{Expr, IdentPath, ExprList}};
-use dash_macros::{ParseNode, ResolveNode};
+use dash_macros::{ParseNode, ResolveNode, EmitNode};
 
 #[derive(Debug, ParseNode)]
 pub struct LetDeclNode {
@@ -49,6 +50,37 @@ impl ResolveNode for LetDeclNode {
     }
 }
 
+impl EmitNode for LetDeclNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        let name = self.name.get(pool).to_path(pool).to_full();
+        let binding = if emitter.scope_is_global() {
+            let global = emitter.new_global()?;
+            // Globals start out as void
+            if let Some((_, value)) = self.value {
+                let mark = emitter.next_reg();
+                let reg = value.emit_operand_ref(pool, emitter)?;
+                emitter.emit(Instr::abx(Op::SetGlobal, reg, global));
+                emitter.free_regs_to(mark);
+            }
+            Binding::Global(global)
+        }
+        else {
+            let reg = emitter.alloc_reg()?;
+            match self.value {
+                Some((_, value)) => value.emit_ref(pool, emitter, Some(reg))?,
+                None => { emitter.emit(Instr::abc(Op::LoadVoid, reg, 0, 0)); }
+            }
+            Binding::Local(reg)
+        };
+        // The variable only becomes visible after its initializer
+        emitter.bind(name, binding);
+        if let Some(dst) = dst {
+            emitter.emit(Instr::abc(Op::LoadVoid, dst, 0, 0));
+        }
+        Ok(())
+    }
+}
+
 // mfw no &'static str in const generics 😢
 add_compile_message!(ThisParamMayNotHaveValue: "the 'this' parameter may not have a default value");
 
@@ -75,6 +107,9 @@ impl ResolveNode for FunParamNode {
 
 #[derive(Debug, ParseNode)]
 pub struct FunDeclNode {
+    /// Calling an async function starts it as a task that runs alongside
+    /// the caller and may yield to continue on a later frame
+    async_kw: Option<kw::Async>,
     fun_kw: kw::Fun,
     name: Option<IdentPath>,
     params: delim::Parenthesized<SeparatedWithTrailing<FunParam, punct::Comma>>,
@@ -101,11 +136,13 @@ impl ResolveNode for FunDeclNode {
         }
         let ret_ty = try_resolve_ref!(self.ret_ty, (pool, checker), Some((_, ty)) => ty);
         let body = {
+            // The parameters stay declared if the body is resolved again
+            let first_visit = self.scope.is_none();
             let _scope = checker.enter_scope(&mut self.scope);
-            for (name, ty, span) in &params {
+            for (name, ty, span) in params.iter().filter(|_| first_visit) {
                 if let Err(old) = checker.scope().entities_mut().try_push(
                     &path::IdentPath::new([path::Ident::from(name.as_str())], false),
-                    Entity::new(ty.clone(), self.span_or_builtin(pool), true)
+                    Entity::new(ty.clone(), span.clone(), true)
                 ) {
                     let old_span = old.span();
                     checker.logger().lock().unwrap().log(Message::new(
@@ -117,7 +154,22 @@ impl ResolveNode for FunDeclNode {
             }
             self.body.try_resolve_ref(pool, checker)?
         };
-        checker.expect_ty_eq(ret_ty.clone(), body.clone(), self.body.get(pool).span(pool));
+        let ret_ty = if self.async_kw.is_some() {
+            // Tasks run detached from their caller, so there is nobody to
+            // return a value to
+            if let Some((_, ty)) = self.ret_ty.filter(|_| ret_ty != Ty::Void) {
+                checker.logger().lock().unwrap().log(Message::new(
+                    Level::Error,
+                    "Async functions can't return a value",
+                    ty.get(pool).span_or_builtin(pool).as_ref()
+                ));
+            }
+            Ty::Void
+        }
+        else {
+            checker.expect_ty_eq(ret_ty.clone(), body.clone(), self.body.get(pool).span(pool));
+            ret_ty
+        };
 
         let fty = Ty::Function {
             params: params.into_iter().map(|p| (Some(p.0), p.1)).collect(),
@@ -140,10 +192,169 @@ impl ResolveNode for FunDeclNode {
     }
 }
 
-#[derive(Debug, ParseNode, ResolveNode)]
+impl FunDeclNode {
+    pub(crate) fn name(&self, pool: &NodePool) -> Option<path::IdentPath> {
+        self.name.map(|n| n.get(pool).to_path(pool))
+    }
+    pub(crate) fn is_async(&self) -> bool {
+        self.async_kw.is_some()
+    }
+    /// Get the default value of the parameter at an index, if it has one
+    pub(crate) fn param_default(&self, pool: &NodePool, index: usize) -> Option<Expr> {
+        match *self.params.get(pool).value.iter().nth(index)?.get(pool) {
+            FunParamNode::NamedParam { default_value, .. } => default_value.map(|(_, v)| v),
+            FunParamNode::ThisParam { .. } => None,
+        }
+    }
+}
+
+impl EmitNode for FunDeclNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        let name = self.name(pool);
+        // Functions declared directly in a block have already been reserved
+        let id = match name.as_ref().and_then(|n| emitter.find_in_scope(&n.to_full())) {
+            Some(Binding::Function(id)) if !emitter.is_function_defined(id) => id,
+            _ => {
+                let display = name.as_ref().map(|n| n.to_string()).unwrap_or("<anonymous>".into());
+                let id = emitter.reserve_function(&display, None)?;
+                if let Some(ref name) = name {
+                    emitter.bind(name.to_full(), Binding::Function(id));
+                }
+                id
+            }
+        };
+
+        let params = self.params.get(pool).value.iter()
+            .map(|param| match *param.get(pool) {
+                FunParamNode::NamedParam { name, .. } => Ok(name.get(pool).to_string()),
+                FunParamNode::ThisParam { .. } => Err(emitter.error(
+                    "'this' parameters are not supported at runtime yet",
+                    param.get(pool).span(pool)
+                )),
+            })
+            .collect::<Result<Vec<_>, _>>()?;
+        let Ok(param_count) = u8::try_from(params.len()) else {
+            return Err(emitter.error("Functions can have at most 255 parameters", self.span(pool)));
+        };
+
+        emitter.begin_function(id, param_count, self.is_async());
+        let prev = emitter.enter_span(self.span(pool));
+        for (reg, name) in params.into_iter().enumerate() {
+            emitter.bind(
+                path::IdentPath::new([path::Ident::from(name)], false).to_full(),
+                Binding::Local(reg as Reg)
+            );
+        }
+        let result = emitter.alloc_reg()?;
+        self.body.emit_ref(pool, emitter, Some(result))?;
+        emitter.emit(Instr::abc(Op::Return, result, 0, 0));
+        emitter.leave_span(prev);
+        emitter.end_function();
+
+        if let Some(dst) = dst {
+            emitter.emit(Instr::abx(Op::LoadFunction, dst, id));
+        }
+        Ok(())
+    }
+}
+
+/// A function implemented by the runtime
+#[derive(Debug, ParseNode)]
+pub struct ExternFunDeclNode {
+    public_kw: Option<kw::Public>,
+    extern_kw: kw::Extern,
+    fun_kw: kw::Fun,
+    name: IdentPath,
+    params: delim::Parenthesized<SeparatedWithTrailing<FunParam, punct::Comma>>,
+    ret_ty: Option<(punct::Arrow, TypeExpr)>,
+}
+
+impl ResolveNode for ExternFunDeclNode {
+    fn try_resolve_node(&mut self, pool: &NodePool, checker: &mut Checker) -> Option<Ty> {
+        let mut params = Vec::new();
+        for param in self.params.get(pool).value.iter() {
+            match *param.get(pool) {
+                FunParamNode::NamedParam { name, ty, default_value } => {
+                    let ty = ty.1.try_resolve_ref(pool, checker)?;
+                    if default_value.is_some() {
+                        checker.logger().lock().unwrap().log(Message::new(
+                            Level::Error,
+                            "Parameters of extern functions may not have default values",
+                            param.get(pool).span_or_builtin(pool).as_ref()
+                        ));
+                    }
+                    params.push((Some(name.get(pool).to_string()), ty));
+                }
+                FunParamNode::ThisParam { .. } => {
+                    checker.logger().lock().unwrap().log(Message::new(
+                        Level::Error,
+                        "Extern functions may not have a 'this' parameter",
+                        param.get(pool).span_or_builtin(pool).as_ref()
+                    ));
+                    return Some(Ty::Invalid);
+                }
+            }
+        }
+        let ret_ty = try_resolve_ref!(self.ret_ty, (pool, checker), Some((_, ty)) => ty);
+        let fty = Ty::Function {
+            params,
+            // Unlike normal functions, there's no body to infer the type from
+            ret_ty: ret_ty.or(Ty::Void).into(),
+        };
+        let name = self.name.get(pool).to_path(pool);
+        if let Err(old) = checker.scope().entities_mut().try_push(
+            &name,
+            Entity::new(fty.clone(), self.span_or_builtin(pool), false)
+        ) {
+            let old_span = old.span();
+            checker.logger().lock().unwrap().log(Message::new(
+                Level::Error,
+                format!("Name {} has already been defined", name),
+                self.span_or_builtin(pool).as_ref()
+            ).note(Note::new_at("Previous definition here", old_span.as_ref())));
+        }
+        Some(fty)
+    }
+}
+
+impl ExternFunDeclNode {
+    /// The name of the function and whether it's public
+    pub(crate) fn name(&self, pool: &NodePool) -> (path::IdentPath, bool) {
+        (self.name.get(pool).to_path(pool), self.public_kw.is_some())
+    }
+    /// Bind the function to the native import that implements it. Natives
+    /// are linked by name when the module is loaded, and public ones are
+    /// listed in the module's symbol table so other modules can import them
+    pub(crate) fn declare(&self, ty: Option<Ty>, pool: &NodePool, emitter: &mut Emitter) -> EmitResult {
+        let name = self.name.get(pool).to_path(pool);
+        let Ok(param_count) = u8::try_from(self.params.get(pool).value.iter().count()) else {
+            return Err(emitter.error("Functions can have at most 255 parameters", self.span(pool)));
+        };
+        let id = emitter.native(&name.to_string(), param_count)?;
+        if self.public_kw.is_some() {
+            let ty = ty.ice("extern function was not resolved");
+            emitter.export(&name.to_full(), &ty, id, self.span(pool))?;
+        }
+        emitter.bind(name.to_full(), Binding::Native(id));
+        Ok(())
+    }
+}
+
+impl EmitNode for ExternFunDeclNode {
+    fn emit_node(&self, _: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        // The enclosing block has already declared the function
+        if let Some(dst) = dst {
+            emitter.emit(Instr::abc(Op::LoadVoid, dst, 0, 0));
+        }
+        Ok(())
+    }
+}
+
+#[derive(Debug, ParseNode, ResolveNode, EmitNode)]
 #[parse(expected = "item declaration")]
 pub enum DeclNode {
     LetDecl(LetDecl),
     FunDecl(FunDecl),
+    ExternFunDecl(ExternFunDecl),
 }
 
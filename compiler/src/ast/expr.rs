@@ -1,7 +1,7 @@
 
 use std::sync::Arc;
 
-use dash_macros::{ParseNode, ResolveNode};
+use dash_macros::{ParseNode, ResolveNode, EmitNode};
 use crate::{
     parser::{
         parse::{
@@ -11,10 +11,12 @@ use crate::{
         tokenizer::TokenIterator
     },
     shared::src::Src,
-    checker::{resolve::{ResolveNode, ResolveRef}, coherency::{Checker, ScopeID}, ty::Ty, path}, try_resolve_list
+    checker::{resolve::{ResolveNode, ResolveRef}, coherency::{Checker, ScopeID}, ty::Ty, path}, try_resolve_list,
+    codegen::{emit::{EmitNode, EmitRef, Emitter, EmitResult, Binding}, bytecode::{Op, Instr, Reg}}
 };
 use super::{
-    decl::Decl,
+    atom::{AtomNode, ItemUseNode},
+    decl::{Decl, DeclNode, FunDecl, ExternFunDecl},
     token::{Ident, punct::{self, TerminatingSemicolon}, op::{Prec, self}, delim},
     atom::Atom,
     flow::Flow,
@@ -58,7 +60,7 @@ impl ResolveNode for IdentPathNode {
     }
 }
 
-#[derive(Debug, ParseNode, ResolveNode)]
+#[derive(Debug, ParseNode, ResolveNode, EmitNode)]
 #[parse(expected = "expression")]
 pub enum ScalarExprNode {
     Decl(Decl),
@@ -66,7 +68,7 @@ pub enum ScalarExprNode {
     Atom(Atom),
 }
 
-#[derive(Debug, ResolveNode)]
+#[derive(Debug, ResolveNode, EmitNode)]
 pub enum ExprNode {
     BinOp(BinOp),
     UnOp(UnOp),
@@ -77,6 +79,43 @@ pub enum ExprNode {
 pub type Expr = RefToNode<ExprNode>;
 
 impl ExprNode {
+    /// If this expression is a function declaration, get it
+    pub(crate) fn as_fun_decl(&self, pool: &NodePool) -> Option<FunDecl> {
+        let Self::Scalar(scalar) = self else { return None };
+        match &*scalar.get(pool) {
+            ScalarExprNode::Decl(decl) => match &*decl.get(pool) {
+                DeclNode::FunDecl(fun) => Some(*fun),
+                _ => None,
+            },
+            _ => None,
+        }
+    }
+    /// If this expression is an extern function declaration, get it
+    pub(crate) fn as_extern_fun_decl(&self, pool: &NodePool) -> Option<ExternFunDecl> {
+        let Self::Scalar(scalar) = self else { return None };
+        match &*scalar.get(pool) {
+            ScalarExprNode::Decl(decl) => match &*decl.get(pool) {
+                DeclNode::ExternFunDecl(fun) => Some(*fun),
+                _ => None,
+            },
+            _ => None,
+        }
+    }
+    /// If this expression is a plain name, get it
+    pub(crate) fn as_item_path(&self, pool: &NodePool) -> Option<path::IdentPath> {
+        let Self::Scalar(scalar) = self else { return None };
+        match &*scalar.get(pool) {
+            ScalarExprNode::Atom(atom) => match &*atom.get(pool) {
+                AtomNode::ItemUse(item) => match &*item.get(pool) {
+                    ItemUseNode::Ident(i) => Some(i.get(pool).to_path(pool)),
+                    _ => None,
+                },
+                _ => None,
+            },
+            _ => None,
+        }
+    }
+
     fn parse_postfix(
         pool: &mut NodePool,
         src: Arc<Src>,
@@ -136,13 +175,13 @@ impl ExprNode {
 }
 
 impl Node for ExprNode {
-    fn children(&self) -> Vec<&dyn ResolveRef> {
+    fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
         match self {
-            Self::BinOp(binop) => vec![binop],
-            Self::UnOp(unop) => vec![unop],
-            Self::Call(call) => vec![call],
-            Self::Index(index) => vec![index],
-            Self::Scalar(scalar) => vec![scalar],
+            Self::BinOp(binop) => f(binop),
+            Self::UnOp(unop) => f(unop),
+            Self::Call(call) => f(call),
+            Self::Index(index) => f(index),
+            Self::Scalar(scalar) => f(scalar),
         }
     }
 }
@@ -174,6 +213,12 @@ pub struct ExprListNode {
     scope: Option<ScopeID>,
 }
 
+impl ExprListNode {
+    pub(crate) fn exprs(&self) -> impl Iterator<Item = Expr> + '_ {
+        self.exprs.iter().map(|(e, _)| *e)
+    }
+}
+
 impl ResolveNode for ExprListNode {
     fn try_resolve_node(&mut self, pool: &NodePool, checker: &mut Checker) -> Option<Ty> {
         let _handle = checker.enter_scope(&mut self.scope);
@@ -186,3 +231,38 @@ impl ResolveNode for ExprListNode {
         Some(Ty::Void)
     }
 }
+
+impl EmitNode for ExprListNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        emitter.push_scope();
+        // Functions can be called before their declaration, so reserve them
+        // up front
+        for (expr, _) in &self.exprs {
+            if let Some(fun) = expr.get(pool).as_fun_decl(pool) {
+                if let Some(name) = fun.get(pool).name(pool) {
+                    let id = emitter.reserve_function(&name.to_string(), Some(fun))?;
+                    if fun.get(pool).is_async() {
+                        emitter.mark_async(id);
+                    }
+                    emitter.bind(name.to_full(), Binding::Function(id));
+                }
+            }
+            else if let Some(fun) = expr.get(pool).as_extern_fun_decl(pool) {
+                fun.get(pool).declare(fun.resolved_ty(pool), pool, emitter)?;
+            }
+        }
+        let mut has_value = false;
+        for (i, (expr, semicolon)) in self.exprs.iter().enumerate() {
+            let last = i + 1 == self.exprs.len() && !semicolon.get(pool).has_semicolon();
+            let prev = emitter.enter_span(expr.get(pool).span(pool));
+            expr.emit_ref(pool, emitter, if last { dst } else { None })?;
+            emitter.leave_span(prev);
+            has_value = last;
+        }
+        if let (Some(dst), false) = (dst, has_value) {
+            emitter.emit(Instr::abc(Op::LoadVoid, dst, 0, 0));
+        }
+        emitter.pop_scope();
+        Ok(())
+    }
+}
@@ -1,8 +1,9 @@
 
-use dash_macros::{ParseNode, ResolveNode};
+use dash_macros::{ParseNode, ResolveNode, EmitNode};
 use crate::{
     parser::parse::{Separated, SeparatedWithTrailing, Node, NodePool},
-    checker::{resolve::{ResolveNode, ResolveRef}, ty::Ty, coherency::Checker}, try_resolve_ref
+    checker::{resolve::{ResolveNode, ResolveRef}, ty::Ty, coherency::Checker}, try_resolve_ref,
+    codegen::{emit::{EmitNode, EmitRef, Emitter, EmitResult}, bytecode::{Op, Instr, Reg}}
 };
 use super::{token::{kw, delim, punct}, expr::{Expr, ExprList, IdentComponent}};
 
@@ -24,7 +25,35 @@ impl ResolveNode for IfNode {
     }
 }
 
-#[derive(Debug, ParseNode, ResolveNode)]
+impl EmitNode for IfNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        let mark = emitter.next_reg();
+        let cond = self.cond.emit_operand_ref(pool, emitter)?;
+        let to_falsy = emitter.emit_jump(Op::JumpIfNot, cond);
+        emitter.free_regs_to(mark);
+
+        self.truthy.emit_ref(pool, emitter, dst)?;
+        match (self.falsy, dst) {
+            (Some((_, falsy)), _) => {
+                let to_end = emitter.emit_jump(Op::Jump, 0);
+                emitter.patch_jump(to_falsy)?;
+                falsy.emit_ref(pool, emitter, dst)?;
+                emitter.patch_jump(to_end)?;
+            }
+            // Without an else branch the result is void
+            (None, Some(dst)) => {
+                let to_end = emitter.emit_jump(Op::Jump, 0);
+                emitter.patch_jump(to_falsy)?;
+                emitter.emit(Instr::abc(Op::LoadVoid, dst, 0, 0));
+                emitter.patch_jump(to_end)?;
+            }
+            (None, None) => emitter.patch_jump(to_falsy)?,
+        }
+        Ok(())
+    }
+}
+
+#[derive(Debug, ParseNode, ResolveNode, EmitNode)]
 #[parse(expected = "block or if statement")]
 pub enum ElseNode {
     Else(delim::Braced<ExprList>),
@@ -44,6 +73,49 @@ impl ResolveNode for ReturnNode {
     }
 }
 
+impl EmitNode for ReturnNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, _: Option<Reg>) -> EmitResult {
+        match self.expr {
+            Some(expr) => {
+                let mark = emitter.next_reg();
+                let reg = expr.emit_operand_ref(pool, emitter)?;
+                emitter.emit(Instr::abc(Op::Return, reg, 0, 0));
+                emitter.free_regs_to(mark);
+            }
+            None => {
+                emitter.emit(Instr::abc(Op::ReturnVoid, 0, 0, 0));
+            }
+        }
+        Ok(())
+    }
+}
+
+/// Suspend the current task until the next frame
+#[derive(Debug, ParseNode)]
+pub struct YieldNode {
+    yield_kw: kw::Yield,
+}
+
+impl ResolveNode for YieldNode {
+    fn try_resolve_node(&mut self, _: &NodePool, _: &mut Checker) -> Option<Ty> {
+        Some(Ty::Void)
+    }
+}
+
+impl EmitNode for YieldNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        // Only tasks have a scheduler to return to
+        if !emitter.in_async_function() {
+            return Err(emitter.error("'yield' can only be used in async functions", self.span(pool)));
+        }
+        emitter.emit(Instr::abc(Op::Yield, 0, 0, 0));
+        if let Some(dst) = dst {
+            emitter.emit(Instr::abc(Op::LoadVoid, dst, 0, 0));
+        }
+        Ok(())
+    }
+}
+
 #[derive(Debug, ParseNode)]
 #[parse(expected = "identifier")]
 enum UsingComponentNode {
@@ -81,10 +153,17 @@ impl ResolveNode for UsingNode {
     }
 }
 
-#[derive(Debug, ParseNode, ResolveNode)]
+impl EmitNode for UsingNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, _: Option<Reg>) -> EmitResult {
+        Err(emitter.error("'using' is not supported at runtime yet", self.span(pool)))
+    }
+}
+
+#[derive(Debug, ParseNode, ResolveNode, EmitNode)]
 #[parse(expected = "control flow expression")]
 pub enum FlowNode {
     If(If),
     Return(Return),
+    Yield(Yield),
     Using(Using),
 }
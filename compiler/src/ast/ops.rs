@@ -4,7 +4,11 @@ use dash_macros::ParseNode;
 use crate::{
     parser::{parse::{FatalParseError, ParseNodeFn, SeparatedWithTrailing, NodePool, RefToNode, Node, ParseRef, NodeID}, tokenizer::TokenIterator},
     shared::{src::{Src, ArcSpan}, logger::{Message, Level, Note, LoggerRef}},
-    checker::{resolve::{ResolveNode, ResolveRef}, coherency::Checker, ty::Ty, path}, ice
+    checker::{resolve::{ResolveNode, ResolveRef}, coherency::Checker, ty::Ty, path, Ice}, ice,
+    codegen::{
+        emit::{EmitNode, EmitRef, Emitter, EmitResult, Binding, PropertyAccess},
+        bytecode::{Op, Instr, Reg}, fold::ConstValue, image::PropertyType
+    }
 };
 use super::{expr::Expr, token::{op, delim, Ident, punct}};
 
@@ -41,11 +45,75 @@ impl CallNode {
         };
         Ok(pool.add(res))
     }
+
+    /// The passed arguments in the order they were written, with the index
+    /// of the parameter each one is passed to
+    fn slotted_args(&self, pool: &NodePool, params: &[(Option<String>, Ty)]) -> Vec<(usize, Expr)> {
+        self.args.get(pool).value.iter().enumerate().map(|(ix, arg)| match *arg.get(pool) {
+            ArgNode::Unnamed(value) => (ix, value),
+            ArgNode::Named(name, _, value) => {
+                let name = name.get(pool).to_string();
+                let slot = params.iter()
+                    .position(|p| p.0.as_ref() == Some(&name))
+                    .ice("named argument did not match any parameter");
+                (slot, value)
+            }
+        }).collect()
+    }
+
+    /// Compile a call to one of the Std property accessors into a property
+    /// access site. The accessors aren't natives the runtime implements, so
+    /// the property has to be known at compile time
+    fn emit_property_access(
+        &self, access: PropertyAccess, params: &[(Option<String>, Ty)],
+        pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>
+    ) -> EmitResult {
+        // Accessors are declared as (target, property, value?)
+        let args = self.slotted_args(pool, params);
+        let (name, span) = args.iter()
+            .find(|(slot, _)| *slot == 1)
+            .map(|(_, value)| (value.const_value_ref(pool), value.get(pool).span(pool)))
+            .ice("property accessor was called without a property");
+        let Some(ConstValue::String(name)) = name else {
+            return Err(emitter.error("Property names have to be known at compile time", span));
+        };
+        let mark = emitter.next_reg();
+        let base = emitter.alloc_regs(match access {
+            PropertyAccess::Get(_) => 1,
+            PropertyAccess::Set => 2,
+        })?;
+        for (slot, value) in args {
+            match slot {
+                0 => value.emit_ref(pool, emitter, Some(base))?,
+                2 => value.emit_ref(pool, emitter, Some(base + 1))?,
+                _ => {}
+            }
+        }
+        match access {
+            PropertyAccess::Get(ty) => {
+                let site = emitter.property_site(&name, ty)?;
+                emitter.emit(Instr::abx(Op::GetProp, base, site));
+                if let Some(dst) = dst {
+                    emitter.emit(Instr::abc(Op::Move, dst, base, 0));
+                }
+            }
+            PropertyAccess::Set => {
+                let site = emitter.property_site(&name, PropertyType::Any)?;
+                emitter.emit(Instr::abx(Op::SetProp, base, site));
+                if let Some(dst) = dst {
+                    emitter.emit(Instr::abc(Op::LoadVoid, dst, 0, 0));
+                }
+            }
+        }
+        emitter.free_regs_to(mark);
+        Ok(())
+    }
 }
 
 impl Node for CallNode {
-    fn children(&self) -> Vec<&dyn ResolveRef> {
-        vec![&self.target, &self.args]
+    fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
+        f(&self.target);
+        f(&self.args);
     }
 }
 
@@ -160,6 +228,86 @@ impl ResolveNode for CallNode {
     }
 }
 
+impl EmitNode for CallNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        let prev = emitter.enter_span(self.span(pool));
+        let mark = emitter.next_reg();
+
+        let params = match self.target.resolved_ty(pool).as_ref().map(|t| t.reduce()) {
+            Some(Ty::Function { params, ret_ty: _ }) => params.clone(),
+            _ => ice!("call target was not resolved to a function type"),
+        };
+
+        let path = self.target.get(pool).as_item_path(pool);
+        if let Some(access) = path.as_ref().and_then(|p| emitter.property_accessor(&p.to_full())) {
+            self.emit_property_access(access, &params, pool, emitter, dst)?;
+            emitter.leave_span(prev);
+            return Ok(());
+        }
+
+        // Calls to functions known by name don't need the function in a
+        // register
+        let binding = match path {
+            Some(path) => Some(emitter.lookup(&path.to_full(), self.target.get(pool).span(pool))?),
+            None => None,
+        };
+        let direct = match binding {
+            Some(Binding::Function(id)) => Some(id),
+            _ => None,
+        };
+        let native = match binding {
+            Some(Binding::Native(id)) => Some(id),
+            _ => None,
+        };
+        let target = match (direct, native) {
+            (None, None) => Some(self.target.emit_operand_ref(pool, emitter)?),
+            _ => None,
+        };
+
+        let Ok(param_count) = u8::try_from(params.len()) else {
+            return Err(emitter.error("Functions can have at most 255 parameters", self.span(pool)));
+        };
+
+        // Arguments are evaluated in the order they were written, straight
+        // into the parameter slots of the callee's frame
+        let base = emitter.alloc_regs((param_count as u16).max(1))?;
+        let mut passed = vec![false; params.len()];
+        for (slot, value) in self.slotted_args(pool, &params) {
+            value.emit_ref(pool, emitter, Some(base + slot as Reg))?;
+            passed[slot] = true;
+        }
+        for (slot, _) in passed.iter().enumerate().filter(|(_, p)| !**p) {
+            let default = direct
+                .and_then(|id| emitter.fun_decl(id))
+                .and_then(|decl| decl.get(pool).param_default(pool, slot));
+            match default {
+                Some(value) => value.emit_ref(pool, emitter, Some(base + slot as Reg))?,
+                None => return Err(emitter.error(
+                    format!(
+                        "No value for parameter {} was passed, and it has no default value known at compile time",
+                        params[slot].0.clone().unwrap_or(slot.to_string())
+                    ),
+                    self.span(pool)
+                )),
+            }
+        }
+
+        match (direct, native, target) {
+            (Some(id), _, _) if emitter.is_async(id) => emitter.emit(Instr::abx(Op::Spawn, base, id)),
+            (Some(id), _, _) => emitter.emit(Instr::abx(Op::Call, base, id)),
+            (_, Some(id), _) => emitter.emit(Instr::abx(Op::CallNative, base, id)),
+            (None, None, Some(target)) => emitter.emit(Instr::abc(Op::CallValue, base, target, 0)),
+            (None, None, None) => unreachable!(),
+        };
+        if let Some(dst) = dst {
+            emitter.emit(Instr::abc(Op::Move, dst, base, 0));
+        }
+        emitter.free_regs_to(mark);
+        emitter.leave_span(prev);
+        Ok(())
+    }
+}
+
 #[derive(Debug)]
 pub struct IndexNode {
     target: Expr,
@@ -185,8 +333,10 @@ impl IndexNode {
 }
 
 impl Node for IndexNode {
-    fn children(&self) -> Vec<&dyn ResolveRef> {
-        vec![&self.target, &self.index, &self.trailing_comma]
+    fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
+        f(&self.target);
+        f(&self.index);
+        f(&self.trailing_comma);
     }
 }
 
@@ -196,6 +346,12 @@ impl ResolveNode for IndexNode {
     }
 }
 
+impl EmitNode for IndexNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, _: Option<Reg>) -> EmitResult {
+        Err(emitter.error("Indexing is not supported at runtime yet", self.span(pool)))
+    }
+}
+
 #[derive(Debug)]
 pub struct UnOpNode {
     op: op::Unary,
@@ -221,8 +377,9 @@ impl UnOpNode {
 }
 
 impl Node for UnOpNode {
-    fn children(&self) -> Vec<&dyn ResolveRef> {
-        vec![&self.op, &self.target]
+    fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
+        f(&self.op);
+        f(&self.target);
     }
 }
 
@@ -262,6 +419,37 @@ impl ResolveNode for UnOpNode {
     }
 }
 
+impl EmitNode for UnOpNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        if let Some(value) = self.const_value(pool) {
+            return emitter.emit_const(&value, dst);
+        }
+        let op = match self.op.get(pool).op() {
+            op::UnaryOp::Not => Op::Not,
+            op::UnaryOp::Neg => Op::Neg,
+            op::UnaryOp::Plus => return self.target.emit_ref(pool, emitter, dst),
+            op::UnaryOp::Question => return Err(emitter.error(
+                "Operator '?' is not supported at runtime yet",
+                self.span(pool)
+            )),
+        };
+        let prev = emitter.enter_span(self.span(pool));
+        let mark = emitter.next_reg();
+        let target = self.target.emit_operand_ref(pool, emitter)?;
+        let dst = match dst {
+            Some(dst) => dst,
+            None => emitter.alloc_reg()?,
+        };
+        emitter.emit(Instr::abc(op, dst, target, 0));
+        emitter.free_regs_to(mark);
+        emitter.leave_span(prev);
+        Ok(())
+    }
+    fn const_value(&self, pool: &NodePool) -> Option<ConstValue> {
+        ConstValue::unary(self.op.get(pool).op(), &self.target.const_value_ref(pool)?)
+    }
+}
+
 #[derive(Debug)]
 pub struct BinOpNode {
     lhs: Expr,
@@ -271,6 +459,34 @@ pub struct BinOpNode {
 pub type BinOp = RefToNode<BinOpNode>;
 
 impl BinOpNode {
+    /// Get the specialized version of an op if the checker resolved both
+    /// operands to the same primitive type, and whether its operands need
+    /// to be swapped
+    fn typed_op(&self, pool: &NodePool, op: Op) -> Option<(Op, bool)> {
+        let a = self.lhs.resolved_ty(pool)?;
+        let b = self.rhs.resolved_ty(pool)?;
+        match (a.reduce(), b.reduce(), op) {
+            (Ty::Int, Ty::Int, Op::Add) => Some((Op::AddInt, false)),
+            (Ty::Int, Ty::Int, Op::Sub) => Some((Op::SubInt, false)),
+            (Ty::Int, Ty::Int, Op::Mul) => Some((Op::MulInt, false)),
+            (Ty::Int, Ty::Int, Op::Less) => Some((Op::LessInt, false)),
+            (Ty::Int, Ty::Int, Op::Leq) => Some((Op::LeqInt, false)),
+            (Ty::Int, Ty::Int, Op::Grt) => Some((Op::LessInt, true)),
+            (Ty::Int, Ty::Int, Op::Geq) => Some((Op::LeqInt, true)),
+            (Ty::Float, Ty::Float, Op::Add) => Some((Op::AddFloat, false)),
+            (Ty::Float, Ty::Float, Op::Sub) => Some((Op::SubFloat, false)),
+            (Ty::Float, Ty::Float, Op::Mul) => Some((Op::MulFloat, false)),
+            (Ty::Float, Ty::Float, Op::Div) => Some((Op::DivFloat, false)),
+            (Ty::Float, Ty::Float, Op::Less) => Some((Op::LessFloat, false)),
+            (Ty::Float, Ty::Float, Op::Leq) => Some((Op::LeqFloat, false)),
+            (Ty::Float, Ty::Float, Op::Grt) => Some((Op::LessFloat, true)),
+            (Ty::Float, Ty::Float, Op::Geq) => Some((Op::LeqFloat, true)),
+            // Int division can fail, and everything else is rare enough
+            // that the generic ops are fine
+            _ => None,
+        }
+    }
+
     pub(crate) fn parse_with<F>(
         lhs: Expr,
         mut rhs: F,
@@ -290,8 +506,10 @@ impl BinOpNode {
 }
 
 impl Node for BinOpNode {
-    fn children(&self) -> Vec<&dyn ResolveRef> {
-        vec![&self.lhs, &self.op, &self.rhs]
+    fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
+        f(&self.lhs);
+        f(&self.op);
+        f(&self.rhs);
     }
 }
 
@@ -335,3 +553,71 @@ impl ResolveNode for BinOpNode {
         }
     }
 }
+
+impl EmitNode for BinOpNode {
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        if let Some(value) = self.const_value(pool) {
+            return emitter.emit_const(&value, dst);
+        }
+        let op = match self.op.get(pool).op() {
+            op::BinaryOp::Eq => Op::Eq,
+            op::BinaryOp::Neq => Op::Neq,
+            op::BinaryOp::Less => Op::Less,
+            op::BinaryOp::Leq => Op::Leq,
+            op::BinaryOp::Grt => Op::Grt,
+            op::BinaryOp::Geq => Op::Geq,
+            op::BinaryOp::Add => Op::Add,
+            op::BinaryOp::Sub => Op::Sub,
+            op::BinaryOp::Mul => Op::Mul,
+            op::BinaryOp::Div => Op::Div,
+            op::BinaryOp::Mod => Op::Mod,
+            op::BinaryOp::And | op::BinaryOp::Or => return self.emit_logical(pool, emitter, dst),
+            op::BinaryOp::Seq => return Err(emitter.error(
+                "Assignment is not supported at runtime yet",
+                self.span(pool)
+            )),
+        };
+        let prev = emitter.enter_span(self.span(pool));
+        let mark = emitter.next_reg();
+        let a = self.lhs.emit_operand_ref(pool, emitter)?;
+        let b = self.rhs.emit_operand_ref(pool, emitter)?;
+        // Even if the result is unused the operation can still fail
+        let dst = match dst {
+            Some(dst) => dst,
+            None => emitter.alloc_reg()?,
+        };
+        match self.typed_op(pool, op) {
+            Some((op, false)) => emitter.emit(Instr::abc(op, dst, a, b)),
+            Some((op, true)) => emitter.emit(Instr::abc(op, dst, b, a)),
+            None => emitter.emit(Instr::abc(op, dst, a, b)),
+        };
+        emitter.free_regs_to(mark);
+        emitter.leave_span(prev);
+        Ok(())
+    }
+    fn const_value(&self, pool: &NodePool) -> Option<ConstValue> {
+        let a = self.lhs.const_value_ref(pool)?;
+        let b = self.rhs.const_value_ref(pool)?;
+        ConstValue::binary(self.op.get(pool).op(), &a, &b)
+    }
+}
+
+impl BinOpNode {
+    /// `&&` and `||` only evaluate their right-hand side if needed
+    fn emit_logical(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        let mark = emitter.next_reg();
+        let dst = match dst {
+            Some(dst) => dst,
+            None => emitter.alloc_reg()?,
+        };
+        self.lhs.emit_ref(pool, emitter, Some(dst))?;
+        let skip = emitter.emit_jump(
+            if self.op.get(pool).op() == op::BinaryOp::And { Op::JumpIfNot } else { Op::JumpIf },
+            dst
+        );
+        self.rhs.emit_ref(pool, emitter, Some(dst))?;
+        emitter.patch_jump(skip)?;
+        emitter.free_regs_to(mark);
+        Ok(())
+    }
+}
@@ -19,6 +19,8 @@ pub(crate) mod kw {
     pub struct Let {}
     #[token(kind = "Keyword", raw = "fun")]
     pub struct Fun {}
+    #[token(kind = "Keyword", raw = "async")]
+    pub struct Async {}
     #[token(kind = "Keyword", raw = "if")]
     pub struct If {}
     #[token(kind = "Keyword", raw = "else")]
@@ -27,8 +29,14 @@ pub(crate) mod kw {
     pub struct This {}
     #[token(kind = "Keyword", raw = "return")]
     pub struct Return {}
+    #[token(kind = "Keyword", raw = "yield")]
+    pub struct Yield {}
     #[token(kind = "Keyword", raw = "using")]
     pub struct Using {}
+    #[token(kind = "Keyword", raw = "extern")]
+    pub struct Extern {}
+    #[token(kind = "Keyword", raw = "public")]
+    pub struct Public {}
 
     #[token(kind = "Ident", raw = "get")]
     pub struct Get {}
@@ -39,7 +47,11 @@ pub(crate) mod kw {
 pub(crate) mod lit {
     use dash_macros::{token, ParseNode};
 
-    use crate::{checker::{resolve::ResolveNode, coherency::Checker, ty::Ty}, parser::parse::NodePool};
+    use crate::{
+        checker::{resolve::ResolveNode, coherency::Checker, ty::Ty},
+        parser::parse::NodePool,
+        codegen::{emit::{EmitNode, Emitter, EmitResult}, bytecode::{Reg, MIN_INT, MAX_INT}, fold::ConstValue}
+    };
 
     #[token(kind = "Keyword", raw = "void", no_default_resolve)]
     pub struct Void {}
@@ -50,6 +62,15 @@ pub(crate) mod lit {
         }
     }
 
+    impl EmitNode for VoidNode {
+        fn emit_node(&self, _: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+            emitter.emit_const(&ConstValue::Void, dst)
+        }
+        fn const_value(&self, _: &NodePool) -> Option<ConstValue> {
+            Some(ConstValue::Void)
+        }
+    }
+
     #[token(kind = "Keyword", raw = "true")]
     pub struct True {}
 
@@ -69,6 +90,15 @@ pub(crate) mod lit {
         }
     }
 
+    impl EmitNode for BoolNode {
+        fn emit_node(&self, _: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+            emitter.emit_const(&ConstValue::Bool(matches!(self, Self::True(_))), dst)
+        }
+        fn const_value(&self, _: &NodePool) -> Option<ConstValue> {
+            Some(ConstValue::Bool(matches!(self, Self::True(_))))
+        }
+    }
+
     #[token(kind = "Int(_)", no_default_resolve)]
     pub struct Int {
         value: i64,
@@ -80,6 +110,22 @@ pub(crate) mod lit {
         }
     }
 
+    impl EmitNode for IntNode {
+        fn emit_node(&self, _: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+            if !(MIN_INT..=MAX_INT).contains(&self.value) {
+                return Err(emitter.error(
+                    format!("Integer {} is too large; ints are 48 bits wide", self.value),
+                    Some(self.span.clone())
+                ));
+            }
+            emitter.emit_const(&ConstValue::Int(self.value), dst)
+        }
+        fn const_value(&self, _: &NodePool) -> Option<ConstValue> {
+            // Out-of-range ints are reported when they're emitted
+            (MIN_INT..=MAX_INT).contains(&self.value).then_some(ConstValue::Int(self.value))
+        }
+    }
+
     #[token(kind = "Float(_)", no_default_resolve)]
     pub struct Float {
         value: f64,
@@ -91,6 +137,15 @@ pub(crate) mod lit {
         }
     }
 
+    impl EmitNode for FloatNode {
+        fn emit_node(&self, _: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+            emitter.emit_const(&ConstValue::Float(self.value), dst)
+        }
+        fn const_value(&self, _: &NodePool) -> Option<ConstValue> {
+            Some(ConstValue::Float(self.value))
+        }
+    }
+
     #[token(kind = "String(_)", no_default_resolve)]
     pub struct String {
         value: std::string::String,
@@ -101,6 +156,15 @@ pub(crate) mod lit {
             Some(Ty::String)
         }
     }
+
+    impl EmitNode for StringNode {
+        fn emit_node(&self, _: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+            emitter.emit_const(&ConstValue::String(self.value.clone()), dst)
+        }
+        fn const_value(&self, _: &NodePool) -> Option<ConstValue> {
+            Some(ConstValue::String(self.value.clone()))
+        }
+    }
 }
 
 pub(crate) mod punct {
@@ -135,8 +199,8 @@ pub(crate) mod punct {
     }
 
     impl Node for TerminatingSemicolonNode {
-        fn children(&self) -> Vec<&dyn ResolveRef> {
-            vec![&self.semicolons]
+        fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
+            f(&self.semicolons);
         }
     }
 
@@ -331,7 +395,8 @@ pub(crate) mod delim {
 
     use crate::{
         parser::parse::{NodePool, ParseRef},
-        checker::{resolve::{ResolveNode, ResolveRef}, coherency::Checker, ty::Ty}
+        checker::{resolve::{ResolveNode, ResolveRef}, coherency::Checker, ty::Ty},
+        codegen::{emit::{EmitNode, EmitRef, Emitter, EmitResult}, bytecode::Reg, fold::ConstValue}
     };
 
     #[token(kind = "Parentheses(_)", value_is_token_tree, no_default_resolve)]
@@ -344,6 +409,18 @@ pub(crate) mod delim {
             self.value.try_resolve_ref(pool, checker)
         }
     }
+
+    impl<T: ResolveRef + ParseRef + EmitRef> EmitNode for ParenthesizedNode<T> {
+        fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+            self.value.emit_ref(pool, emitter, dst)
+        }
+        fn emit_operand(&self, pool: &NodePool, emitter: &mut Emitter) -> EmitResult<Reg> {
+            self.value.emit_operand_ref(pool, emitter)
+        }
+        fn const_value(&self, pool: &NodePool) -> Option<ConstValue> {
+            self.value.const_value_ref(pool)
+        }
+    }
      
     #[token(kind = "Brackets(_)", value_is_token_tree, no_default_resolve)]
     pub struct Bracketed<T: ParseRef + ResolveRef> {
@@ -367,6 +444,15 @@ pub(crate) mod delim {
         }
     }
 
+    impl<T: ResolveRef + ParseRef + EmitRef> EmitNode for BracedNode<T> {
+        fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+            self.value.emit_ref(pool, emitter, dst)
+        }
+        fn emit_operand(&self, pool: &NodePool, emitter: &mut Emitter) -> EmitResult<Reg> {
+            self.value.emit_operand_ref(pool, emitter)
+        }
+    }
+
     /// Placeholder used for peeking delimiters
     #[derive(Debug, ParseNode)]
     pub struct PNode;
@@ -3,11 +3,11 @@ use std::sync::Arc;
 
 use dash_macros::{ParseNode, ResolveNode};
 use crate::{
-    parser::{parse::{ParseNode, FatalParseError, RefToNode, NodePool, Node, NodeID, ParseRef}, tokenizer::TokenIterator},
+    parser::{parse::{ParseNode, FatalParseError, RefToNode, NodePool, Node, NodeID, ParseRef, SeparatedWithTrailing}, tokenizer::TokenIterator},
     shared::{src::Src, logger::{Message, Level, LoggerRef}},
-    checker::{resolve::{ResolveNode, ResolveRef}, coherency::Checker, ty::Ty}
+    checker::{resolve::{ResolveNode, ResolveRef}, coherency::Checker, ty::Ty}, try_resolve_ref
 };
-use super::{expr::IdentPath, token::op};
+use super::{expr::IdentPath, token::{op, lit, kw, punct, delim}};
 
 #[derive(Debug)]
 pub enum TypeExprNode {
@@ -17,10 +17,13 @@ pub enum TypeExprNode {
 pub type TypeExpr = RefToNode<TypeExprNode>;
 
 impl Node for TypeExprNode {
-    fn children(&self) -> Vec<&dyn ResolveRef> {
+    fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
         match self {
-            Self::Optional(ty, q) => vec![ty, q],
-            Self::Atom(atom) => vec![atom],
+            Self::Optional(ty, q) => {
+                f(ty);
+                f(q);
+            }
+            Self::Atom(atom) => f(atom),
         }
     }
 }
@@ -52,9 +55,31 @@ impl ResolveNode for TypeExprNode {
 #[derive(Debug, ParseNode, ResolveNode)]
 #[parse(expected = "type")]
 pub enum TypeAtomNode {
+    /// `void` is a keyword, so it can't be looked up like other types
+    Void(lit::Void),
+    Function(FunType),
     TypeIdent(TypeIdent),
 }
 
+/// The type of a function value, like `fun(string, int) -> object`
+#[derive(Debug, ParseNode)]
+pub struct FunTypeNode {
+    fun_kw: kw::Fun,
+    params: delim::Parenthesized<SeparatedWithTrailing<TypeExpr, punct::Comma>>,
+    ret_ty: Option<(punct::Arrow, TypeExpr)>,
+}
+
+impl ResolveNode for FunTypeNode {
+    fn try_resolve_node(&mut self, pool: &NodePool, checker: &mut Checker) -> Option<Ty> {
+        let mut params = Vec::new();
+        for param in self.params.get(pool).value.iter() {
+            params.push((None, param.try_resolve_ref(pool, checker)?));
+        }
+        let ret_ty = try_resolve_ref!(self.ret_ty, (pool, checker), Some((_, ty)) => ty else Ty::Void);
+        Some(Ty::Function { params, ret_ty: ret_ty.into() })
+    }
+}
+
 #[derive(Debug, ParseNode)]
 pub struct TypeIdentNode {
     name: IdentPath,
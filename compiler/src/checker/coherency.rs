@@ -1,45 +1,96 @@
 
-use std::collections::HashMap;
+use std::{cell::RefCell, collections::{HashMap, BTreeSet}};
 use crate::{
-    shared::{logger::{LoggerRef, Message, Level, Note}, src::{ArcSpan, Span}},
+    shared::{logger::{LoggerRef, Message, Level, Note}, src::ArcSpan},
     ast::token::op,
-    parser::parse::NodePool,
-    checker::resolve::ResolveRef
+    parser::parse::{NodePool, NodeID},
+    checker::resolve::ResolveRef,
+    prelude::Prelude
 };
 use super::{ty::Ty, path::{FullIdentPath, IdentPath, Ident}, entity::Entity, pool::AST};
 
+/// Something that can be declared in a scope
+pub trait ScopeItem {
+    /// If this item is only visible after its declaration, the position 
+    /// where the declaration ends in the source
+    fn declaration_end(&self) -> Option<usize> {
+        None
+    }
+}
+
+impl ScopeItem for Ty {}
+
+impl ScopeItem for Entity {
+    fn declaration_end(&self) -> Option<usize> {
+        self.ephemeral().then(|| self.span().1.end)
+    }
+}
+
+/// The source position of the node being resolved, if it's being resolved 
+/// again. On the first walk over the AST, variables have only been declared 
+/// if they come before the node, but later on all of them have been
+#[derive(Debug, Clone, Copy, Default)]
+struct Visibility(Option<usize>);
+
+impl Visibility {
+    fn can_see<T: ScopeItem>(&self, item: &T) -> bool {
+        match (self.0, item.declaration_end()) {
+            (Some(pos), Some(end)) => end <= pos,
+            _ => true,
+        }
+    }
+}
+
+/// The state lookups in the checker's scopes share
+#[derive(Debug, Default)]
+struct Lookups {
+    visibility: Visibility,
+    /// The names of items that couldn't be found in some scope
+    missed: RefCell<Vec<Ident>>,
+}
+
+impl Lookups {
+    fn find<'s, T: ScopeItem>(&self, space: &'s ItemSpace<T>, name: &IdentPath, stack: &FullIdentPath) -> Option<&'s T> {
+        let found = space.find(name, stack, self.visibility);
+        if found.is_none() {
+            self.missed.borrow_mut().extend(name.last().cloned());
+        }
+        found
+    }
+}
+
 #[derive(Debug)]
 struct ItemSpace<T> {
     items: HashMap<FullIdentPath, T>,
 }
 
-impl<T> ItemSpace<T> {
+impl<T: ScopeItem> ItemSpace<T> {
     fn new<H: Into<HashMap<FullIdentPath, T>>>(values: H) -> Self {
         Self { items: values.into() }
     }
     /// Try to find an item in this scope with a fully resolved name
-    fn get(&self, full_name: &FullIdentPath) -> Option<&T> {
-        self.items.get(full_name)
+    fn get(&self, full_name: &FullIdentPath, visibility: Visibility) -> Option<&T> {
+        self.items.get(full_name).filter(|item| visibility.can_see(*item))
     }
     /// Try to find an item in this scope with an unresolved name
-    fn find(&self, name: &IdentPath, stack: &FullIdentPath) -> Option<&T> {
+    fn find(&self, name: &IdentPath, stack: &FullIdentPath, visibility: Visibility) -> Option<&T> {
         // This is an optimization; the else branch would also do this since 
         // FullIdentPath::join would just return `name` every time
         if name.is_absolute() {
-            self.get(&name.to_full())
+            self.get(&name.to_full(), visibility)
         }
         else {
             // Try joining the path to the namespace stack. If not found, check 
             // that namespace's parent namespace, all the way down to root
             let mut temp = stack.clone();
             while !temp.is_empty() {
-                if let Some(found) = self.get(&temp.join(name)) {
+                if let Some(found) = self.get(&temp.join(name), visibility) {
                     return Some(found);
                 }
                 temp.pop();
             }
             // Check root namespace
-            self.get(&name.to_full())
+            self.get(&name.to_full(), visibility)
         }
     }
     fn try_push(&mut self, name: &IdentPath, item: T, stack: &FullIdentPath) -> Result<&T, &T> {
@@ -71,12 +122,13 @@ impl<T> Default for ItemSpace<T> {
 pub struct ItemSpaceWithStack<'s, T> {
     space: &'s ItemSpace<T>,
     stack: &'s FullIdentPath,
+    lookups: &'s Lookups,
 }
 
-impl<'s, T> ItemSpaceWithStack<'s, T> {
+impl<'s, T: ScopeItem> ItemSpaceWithStack<'s, T> {
     /// Try to find an item in this scope with an unresolved name
     pub fn find(self, name: &IdentPath) -> Option<&'s T> {
-        self.space.find(name, self.stack)
+        self.lookups.find(self.space, name, self.stack)
     }
 }
 
@@ -84,16 +136,22 @@ impl<'s, T> ItemSpaceWithStack<'s, T> {
 pub struct ItemSpaceWithStackMut<'s, T> {
     space: &'s mut ItemSpace<T>,
     stack: &'s FullIdentPath,
+    lookups: &'s Lookups,
+    declared: &'s mut Vec<Ident>,
 }
 
 #[allow(unused)]
-impl<'s, T> ItemSpaceWithStackMut<'s, T> {
+impl<'s, T: ScopeItem> ItemSpaceWithStackMut<'s, T> {
     /// Try to find an item in this scope with an unresolved name
     pub fn find(self, name: &IdentPath) -> Option<&'s T> {
-        self.space.find(name, self.stack)
+        self.lookups.find(self.space, name, self.stack)
     }
     pub fn try_push(self, name: &IdentPath, item: T) -> Result<&'s T, &'s T> {
-        self.space.try_push(name, item, self.stack)
+        let res = self.space.try_push(name, item, self.stack);
+        if res.is_ok() {
+            self.declared.extend(name.last().cloned());
+        }
+        res
     }
 }
 
@@ -112,7 +170,7 @@ impl Scope {
             entities: Default::default(),
         }
     }
-    fn root() -> Self {
+    fn root(prelude: &Prelude) -> Self {
         macro_rules! decl_binop {
             ($a: ident $op: ident $b: ident => $r: ident) => {
                 (Ty::$a, op::BinaryOp::$op, Ty::$b, Ty::$r)
@@ -122,7 +180,7 @@ impl Scope {
         Self {
             parent: None,
             types: ItemSpace::new(
-                [Ty::Never, Ty::Void, Ty::Bool, Ty::Int, Ty::Float, Ty::String]
+                [Ty::Never, Ty::Void, Ty::Bool, Ty::Int, Ty::Float, Ty::String, Ty::Object]
                     .map(|t| (FullIdentPath::new([t.to_string().into()]), t))
             ),
             entities: ItemSpace::new(
@@ -177,26 +235,30 @@ impl Scope {
                         false
                     )
                 ))
+                .into_iter()
+                .chain(prelude.items().iter().map(|item| (
+                    item.name.clone(),
+                    Entity::new(item.ty.clone(), ArcSpan::builtin(), false)
+                )))
+                .collect::<HashMap<_, _>>()
             ),
         }
     }
-    fn drop_ephemeral(&mut self) {
-        self.entities.items.retain(|_, v| !v.ephemeral());
-    }
 }
 
 #[derive(Debug)]
 pub struct ScopeWithStack<'s> {
     scope: &'s Scope,
     stack: &'s FullIdentPath,
+    lookups: &'s Lookups,
 }
 
 impl<'s> ScopeWithStack<'s> {
     pub fn types(&self) -> ItemSpaceWithStack<'s, Ty> {
-        ItemSpaceWithStack { space: &self.scope.types, stack: self.stack }
+        ItemSpaceWithStack { space: &self.scope.types, stack: self.stack, lookups: self.lookups }
     }
     pub fn entities(&self) -> ItemSpaceWithStack<'s, Entity> {
-        ItemSpaceWithStack { space: &self.scope.entities, stack: self.stack }
+        ItemSpaceWithStack { space: &self.scope.entities, stack: self.stack, lookups: self.lookups }
     }
 }
 
@@ -207,21 +269,33 @@ impl<'s> ScopeWithStack<'s> {
 pub struct ScopeWithStackMut<'s> {
     scope: &'s mut Scope,
     stack: &'s FullIdentPath,
+    lookups: &'s Lookups,
+    declared: &'s mut Vec<Ident>,
 }
 
 #[allow(unused)]
 impl<'s> ScopeWithStackMut<'s> {
     pub fn types(self) -> ItemSpaceWithStack<'s, Ty> {
-        ItemSpaceWithStack { space: &self.scope.types, stack: self.stack }
+        ItemSpaceWithStack { space: &self.scope.types, stack: self.stack, lookups: self.lookups }
     }
     pub fn entities(self) -> ItemSpaceWithStack<'s, Entity> {
-        ItemSpaceWithStack { space: &self.scope.entities, stack: self.stack }
+        ItemSpaceWithStack { space: &self.scope.entities, stack: self.stack, lookups: self.lookups }
     }
     pub fn types_mut(self) -> ItemSpaceWithStackMut<'s, Ty> {
-        ItemSpaceWithStackMut { space: &mut self.scope.types, stack: self.stack }
+        ItemSpaceWithStackMut {
+            space: &mut self.scope.types,
+            stack: self.stack,
+            lookups: self.lookups,
+            declared: self.declared,
+        }
     }
     pub fn entities_mut(self) -> ItemSpaceWithStackMut<'s, Entity> {
-        ItemSpaceWithStackMut { space: &mut self.scope.entities, stack: self.stack }
+        ItemSpaceWithStackMut {
+            space: &mut self.scope.entities,
+            stack: self.stack,
+            lookups: self.lookups,
+            declared: self.declared,
+        }
     }
 }
 
@@ -242,11 +316,12 @@ pub struct ScopeIter<'s> {
     current: Option<ScopeID>,
     scopes: &'s Vec<Scope>,
     stack: &'s FullIdentPath,
+    lookups: &'s Lookups,
 }
 
 impl<'s> ScopeIter<'s> {
-    fn new(first: ScopeID, scopes: &'s Vec<Scope>, stack: &'s FullIdentPath) -> Self {
-        Self { current: Some(first), scopes, stack }
+    fn new(first: ScopeID, scopes: &'s Vec<Scope>, stack: &'s FullIdentPath, lookups: &'s Lookups) -> Self {
+        Self { current: Some(first), scopes, stack, lookups }
     }
 }
 
@@ -255,65 +330,181 @@ impl<'s> Iterator for ScopeIter<'s> {
     fn next(&mut self) -> Option<Self::Item> {
         let ret = self.scopes.get(self.current?.0).unwrap();
         self.current = ret.parent;
-        Some(ScopeWithStack { scope: ret, stack: self.stack })
+        Some(ScopeWithStack { scope: ret, stack: self.stack, lookups: self.lookups })
     }
 }
 
+/// Where an unresolved node was visited from, so it can be resolved again 
+/// without re-walking its ancestors
+struct NodeContext {
+    parent: Option<NodeID>,
+    scope: ScopeID,
+    namespace: FullIdentPath,
+    /// Where the node starts in the source, once it's needed
+    start: Option<Option<usize>>,
+}
+
+/// A node that is currently being resolved
+struct Visit {
+    id: NodeID,
+    scope: ScopeID,
+    /// The visibility to restore once the node has been left
+    visibility: Visibility,
+    /// The number of missed lookups before the node was entered
+    missed: usize,
+    some_children_unresolved: bool,
+}
+
 pub struct Checker {
     logger: LoggerRef,
     current_scope: ScopeID,
     scopes: Vec<Scope>,
     namespace_stack: FullIdentPath,
-    some_nodes_resolve_state_changed: bool,
+    lookups: Lookups,
+    /// The names of all declared items, in the order they were declared in
+    declared: Vec<Ident>,
+    /// How many of `declared` have been checked for nodes waiting on them
+    declared_checked: usize,
+    visiting: Vec<Visit>,
+    unresolved: HashMap<NodeID, NodeContext>,
+    /// Unresolved nodes whose children all resolved, by the names they 
+    /// couldn't find. These can only resolve once one of them is declared
+    waiting: HashMap<Ident, Vec<NodeID>>,
+    /// Unresolved nodes that may resolve now. Nodes are parsed before their 
+    /// parents, so going in order of IDs retries children first
+    worklist: BTreeSet<NodeID>,
 }
 
 impl Checker {
-    fn new(logger: LoggerRef) -> Self {
+    fn new(prelude: &Prelude, logger: LoggerRef) -> Self {
         Self {
             logger: logger.clone(),
             current_scope: ScopeID(0),
-            scopes: Vec::from([Scope::root()]),
+            scopes: Vec::from([Scope::root(prelude)]),
             namespace_stack: FullIdentPath::default(),
-            some_nodes_resolve_state_changed: false,
+            lookups: Lookups::default(),
+            declared: Vec::new(),
+            declared_checked: 0,
+            visiting: Vec::new(),
+            unresolved: HashMap::new(),
+            waiting: HashMap::new(),
+            worklist: BTreeSet::new(),
         }
     }
-    pub fn try_resolve(ast: &mut AST, pool: &mut NodePool, logger: LoggerRef) -> Ty {
-        let mut checker = Checker::new(logger.clone());
-        for i in 0.. {
-            // todo: allow customizing max loop count via a compiler option
-            if i > 1000 {
-                checker.logger.lock().unwrap().log(Message::new(
-                    Level::Error,
-                    "Internal error: maximum check loop count reached (1000)",
-                    Span::builtin()
-                ).note(Note::new(
-                    "Try simplifying your codebase, moving definitions of types \
-                    and functions before their uses", true
-                )));
-                return Ty::Invalid;
-            }
-            // Reset node state marker
-            checker.some_nodes_resolve_state_changed = false;
-            if let Some(r) = ast.try_resolve_ref(pool, &mut checker) {
-                return r;
+    /// Resolve an AST. After the first walk over the AST, only nodes whose 
+    /// dependencies have changed are resolved again: nodes whose children 
+    /// just resolved, and nodes that couldn't find an item that has been 
+    /// declared since. This terminates, since every node only resolves once, 
+    /// and nodes that fail without unresolved children don't declare anything
+    pub fn try_resolve(ast: &mut AST, pool: &mut NodePool, prelude: &Prelude, logger: LoggerRef) -> Ty {
+        let mut checker = Checker::new(prelude, logger.clone());
+        if let Some(r) = ast.try_resolve_ref(pool, &mut checker) {
+            return r;
+        }
+        loop {
+            for name in &checker.declared[checker.declared_checked..] {
+                if let Some(ids) = checker.waiting.remove(name) {
+                    checker.worklist.extend(ids);
+                }
             }
-            // If no nodes' states changed, then we have ended up in an 
-            // infinite unresolvable loop
-            if !checker.some_nodes_resolve_state_changed {
+            checker.declared_checked = checker.declared.len();
+            // If nothing could have changed, then the rest of the AST is 
+            // unresolvable
+            if checker.worklist.is_empty() {
                 pool.release_unresolved(&checker, logger);
                 return Ty::Invalid;
             }
+            while let Some(id) = checker.worklist.pop_first() {
+                checker.retry(id, pool);
+                if let Some(r) = ast.resolved_ty(pool) {
+                    return r;
+                }
+            }
+        }
+    }
+    /// Resolve an unresolved node again in the scope it was first visited in
+    fn retry(&mut self, id: NodeID, pool: &NodePool) {
+        if pool.is_resolved(id) {
+            return;
+        }
+        let Some(ctx) = self.unresolved.get(&id) else { return };
+        let scope = std::mem::replace(&mut self.current_scope, ctx.scope);
+        let namespace = std::mem::replace(&mut self.namespace_stack, ctx.namespace.clone());
+        pool.try_resolve(id, self);
+        self.current_scope = scope;
+        self.namespace_stack = namespace;
+    }
+    /// Start resolving a node. Returns false if the node should be skipped, 
+    /// since it's being visited again but nothing it depends on has changed. 
+    /// The node being retried is never skipped
+    pub fn enter_node(&mut self, id: NodeID, pool: &NodePool) -> bool {
+        let ctx = self.unresolved.get_mut(&id);
+        if ctx.is_some() && !self.visiting.is_empty() && !self.worklist.contains(&id) {
+            if let Some(parent) = self.visiting.last_mut() {
+                parent.some_children_unresolved = true;
+            }
+            return false;
+        }
+        self.visiting.push(Visit {
+            id,
+            scope: self.current_scope,
+            visibility: self.lookups.visibility,
+            missed: self.lookups.missed.borrow().len(),
+            some_children_unresolved: false,
+        });
+        // Nodes visited for the first time inherit their parent's visibility
+        if let Some(ctx) = ctx {
+            let start = *ctx.start.get_or_insert_with(|| pool.span(id).map(|s| s.1.start));
+            self.lookups.visibility = Visibility(start);
+        }
+        true
+    }
+    pub fn leave_node(&mut self, id: NodeID, resolved: bool) {
+        let visit = self.visiting.pop().unwrap();
+        debug_assert_eq!(visit.id, id, "Nodes must be left in the order they were entered");
+        self.lookups.visibility = visit.visibility;
+        let missed = self.lookups.missed.borrow_mut().drain(visit.missed..).collect::<Vec<_>>();
+        let parent = self.visiting.last_mut();
+        if resolved {
+            if let Some(ctx) = self.unresolved.remove(&id) {
+                // If the parent is being resolved right now, it sees this 
+                // node's type anyway
+                if let (None, Some(parent)) = (parent, ctx.parent) {
+                    self.worklist.insert(parent);
+                }
+            }
+            return;
+        }
+        let parent = parent.map(|p| {
+            p.some_children_unresolved = true;
+            p.id
+        });
+        self.unresolved.entry(id).or_insert_with(|| NodeContext {
+            parent,
+            scope: visit.scope,
+            namespace: self.namespace_stack.clone(),
+            start: None,
+        });
+        // Nodes with unresolved children are queued once one of them resolves
+        if !visit.some_children_unresolved {
+            for name in missed {
+                let ids = self.waiting.entry(name).or_default();
+                if ids.last() != Some(&id) {
+                    ids.push(id);
+                }
+            }
         }
-        unreachable!()
     }
 
     pub fn scopes(&self) -> ScopeIter {
-        ScopeIter::new(self.current_scope, &self.scopes, &self.namespace_stack)
+        ScopeIter::new(self.current_scope, &self.scopes, &self.namespace_stack, &self.lookups)
     }
     pub fn scope(&mut self) -> ScopeWithStackMut {
         ScopeWithStackMut {
             scope: self.scopes.get_mut(self.current_scope.0).unwrap(),
-            stack: &self.namespace_stack
+            stack: &self.namespace_stack,
+            lookups: &self.lookups,
+            declared: &mut self.declared,
         }
     }
     pub fn enter_scope(&mut self, scope: &mut Option<ScopeID>) -> LeaveScope {
@@ -328,8 +519,9 @@ impl Checker {
         LeaveScope { checker: self }
     }
     fn leave_scope(&mut self) {
+        // Variables are kept around after leaving their scope, since nodes 
+        // in it may be resolved again later
         if let Some(parent) = self.scope().scope.parent {
-            self.scope().scope.drop_ephemeral();
             self.current_scope = parent;
         }
     }
@@ -341,10 +533,6 @@ impl Checker {
         self.namespace_stack.pop();
     }
 
-    pub fn mark_some_nodes_resolve_state_changed(&mut self) {
-        self.some_nodes_resolve_state_changed = true;
-    }
-
     pub fn expect_ty_decided(&self, a: Ty, span: Option<ArcSpan>) -> bool {
         if let Ty::Undecided(name, a_span) = a {
             self.logger.lock().unwrap().log(Message::new(
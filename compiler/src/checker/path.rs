@@ -71,6 +71,9 @@ impl IdentPath {
     pub fn is_absolute(&self) -> bool {
         self.absolute
     }
+    pub fn last(&self) -> Option<&Ident> {
+        self.components.last()
+    }
 }
 
 impl Display for IdentPath {
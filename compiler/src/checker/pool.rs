@@ -1,9 +1,13 @@
 
 use crate::ast::expr::ExprList;
+use crate::checker::coherency::Checker;
+use crate::checker::ty::Ty;
 use crate::parser::tokenizer::Tokenizer;
-use crate::shared::src::SrcPool;
-use crate::shared::logger::LoggerRef;
+use crate::shared::parallel;
+use crate::shared::src::{SrcPool, Span};
+use crate::shared::logger::{Logger, LoggerRef, Message, Level};
 use crate::parser::parse::{ParseRef, NodePool};
+use crate::prelude::Prelude;
 
 pub type AST = ExprList;
 
@@ -12,16 +16,70 @@ pub struct ASTPool {
 }
 
 impl<'s: 'g, 'g> ASTPool {
+    /// Parse every source file in the pool. Each file is parsed on its own 
+    /// thread into its own segment of `list`, so the segment of a file's 
+    /// nodes is the index of the file in `pool`
     pub fn parse_src_pool(list: &mut NodePool, pool: &SrcPool, logger: LoggerRef) -> Self {
+        assert!(list.is_empty(), "Sources must be parsed into an empty pool");
+        let parsed = parallel::map(pool.iter().enumerate().collect(), |(i, src)| {
+            let mut list = NodePool::new_segment(i);
+            let file_logger = Logger::buffered();
+            // Sources may not have been read yet, in which case they're read 
+            // by the thread that parses them
+            if let Err(e) = src.load() {
+                file_logger.lock().unwrap().log(Message::new(Level::Error, e, Span(&src, 0..0)));
+                return (list, None, file_logger.lock().unwrap().take());
+            }
+            let ast = ExprList::parse_complete(
+                &mut list,
+                src.clone(),
+                Tokenizer::new(&src, file_logger.clone())
+            ).ok();
+            let diagnostics = file_logger.lock().unwrap().take();
+            (list, ast, diagnostics)
+        });
+        let mut lists = Vec::with_capacity(parsed.len());
+        let mut asts = Vec::with_capacity(parsed.len());
+        let mut diagnostics = Vec::with_capacity(parsed.len());
+        for (l, ast, d) in parsed {
+            lists.push(l);
+            asts.push(ast);
+            diagnostics.push(d);
+        }
+        logger.lock().unwrap().merge(diagnostics);
+        *list = NodePool::join(lists);
         Self {
-            asts: pool.iter()
-                .filter_map(|src| ExprList::parse_complete(
-                    list,
-                    src.clone(),
-                    Tokenizer::new(&src, logger.clone())
-                ).ok())
-                .collect(),
+            asts: asts.into_iter().flatten().collect(),
+        }
+    }
+    /// Check every AST in the pool. Source files don't see each other's 
+    /// declarations, so each one is checked on its own thread with only its 
+    /// own segment of `list`, and sees nothing else but the prelude. Returns 
+    /// the type of each AST in order
+    pub fn check_all(&mut self, list: &mut NodePool, prelude: &Prelude, logger: LoggerRef) -> Vec<Ty> {
+        let mut segments = std::mem::take(list).split()
+            .into_iter()
+            .map(Some)
+            .collect::<Vec<_>>();
+        let work = self.asts.iter()
+            .map(|ast| (*ast, segments[ast.id().segment()].take().unwrap()))
+            .collect();
+        let checked = parallel::map(work, |(mut ast, mut list)| {
+            let file_logger = Logger::buffered();
+            let ty = Checker::try_resolve(&mut ast, &mut list, prelude, file_logger.clone());
+            let diagnostics = file_logger.lock().unwrap().take();
+            (ast, list, ty, diagnostics)
+        });
+        let mut tys = Vec::with_capacity(checked.len());
+        let mut diagnostics = Vec::with_capacity(checked.len());
+        for (ast, checked, ty, d) in checked {
+            segments[ast.id().segment()] = Some(checked);
+            tys.push(ty);
+            diagnostics.push(d);
         }
+        logger.lock().unwrap().merge(diagnostics);
+        *list = NodePool::join(segments.into_iter().map(Option::unwrap));
+        tys
     }
     pub fn iter(&self) -> <&Vec<AST> as IntoIterator>::IntoIter {
         self.into_iter()
@@ -44,4 +102,4 @@ impl<'a> IntoIterator for &'a mut ASTPool {
     fn into_iter(self) -> Self::IntoIter {
         self.asts.iter_mut()
     }
-}
\ No newline at end of file
+}
@@ -22,6 +22,9 @@ pub enum Ty {
     Float,
     /// UTF-8 string type
     String,
+    /// A native object owned by the host, like a node. Objects can only be 
+    /// passed around and used through extern functions
+    Object,
     /// Function type
     Function {
         params: Vec<(Option<String>, Ty)>,
@@ -55,6 +58,7 @@ impl Ty {
             "int" => Self::Int,
             "float" => Self::Float,
             "string" => Self::String,
+            "object" => Self::Object,
             _ => ice!("invalid builtin type '{name}'")
         }
     }
@@ -83,9 +87,23 @@ impl Ty {
     /// Test whether this type is implicitly convertible to another type or 
     /// not
     /// 
-    /// In most cases this means equality
+    /// In most cases this means equality. Functions are convertible if their
+    /// parameters and return types are, regardless of parameter names
     pub fn convertible(&self, other: &Ty) -> bool {
-        self.is_unreal() || other.is_unreal() || *self.reduce() == *other.reduce()
+        if self.is_unreal() || other.is_unreal() {
+            return true;
+        }
+        match (self.reduce(), other.reduce()) {
+            (
+                Ty::Function { params: a, ret_ty: a_ret },
+                Ty::Function { params: b, ret_ty: b_ret }
+            ) => {
+                a.len() == b.len() &&
+                    a.iter().zip(b).all(|((_, a), (_, b))| a.convertible(b)) &&
+                    a_ret.convertible(b_ret)
+            }
+            (a, b) => a == b,
+        }
     }
 
     pub fn span(&self) -> ArcSpan {
@@ -98,6 +116,7 @@ impl Ty {
             Ty::Int => ArcSpan::builtin(),
             Ty::Float => ArcSpan::builtin(),
             Ty::String => ArcSpan::builtin(),
+            Ty::Object => ArcSpan::builtin(),
             Ty::Function { params: _, ret_ty: _ } => ArcSpan::builtin(),
             Ty::Option { ty: _ } => ArcSpan::builtin(),
             Ty::Alias { name: _, ty: _, decl_span } |
@@ -109,6 +128,97 @@ impl Ty {
     pub fn or(self, other: Ty) -> Ty {
         if self.is_unreal() { other } else { self }
     }
+
+    /// Encode this type as a compact signature for a module's symbol table, 
+    /// like `(msg:s)v` for `fun(msg: string) -> void`. Returns None for 
+    /// types that only exist inside the file that declared them
+    pub fn signature(&self) -> Option<String> {
+        let mut sig = String::new();
+        self.write_signature(&mut sig).then_some(sig)
+    }
+    fn write_signature(&self, sig: &mut String) -> bool {
+        match self {
+            Self::Never => sig.push('!'),
+            Self::Void => sig.push('v'),
+            Self::Bool => sig.push('b'),
+            Self::Int => sig.push('i'),
+            Self::Float => sig.push('f'),
+            Self::String => sig.push('s'),
+            Self::Object => sig.push('o'),
+            Self::Option { ty } => {
+                sig.push('?');
+                return ty.write_signature(sig);
+            }
+            Self::Function { params, ret_ty } => {
+                sig.push('(');
+                for (i, (name, ty)) in params.iter().enumerate() {
+                    if i > 0 {
+                        sig.push(',');
+                    }
+                    if let Some(name) = name {
+                        sig.push_str(name);
+                        sig.push(':');
+                    }
+                    if !ty.write_signature(sig) {
+                        return false;
+                    }
+                }
+                sig.push(')');
+                return ret_ty.write_signature(sig);
+            }
+            Self::Undecided(..) | Self::Invalid | Self::Alias { .. } | Self::Named { .. } => return false,
+        }
+        true
+    }
+
+    /// Decode a type from a signature made by `signature`
+    pub fn from_signature(sig: &str) -> Option<Self> {
+        let (ty, rest) = Self::read_signature(sig)?;
+        rest.is_empty().then_some(ty)
+    }
+    fn read_signature(sig: &str) -> Option<(Self, &str)> {
+        let mut chars = sig.chars();
+        let ty = match chars.next()? {
+            '!' => Self::Never,
+            'v' => Self::Void,
+            'b' => Self::Bool,
+            'i' => Self::Int,
+            'f' => Self::Float,
+            's' => Self::String,
+            'o' => Self::Object,
+            '?' => {
+                let (ty, rest) = Self::read_signature(chars.as_str())?;
+                return Some((Self::Option { ty: ty.into() }, rest));
+            }
+            '(' => {
+                let mut params = Vec::new();
+                let mut rest = chars.as_str();
+                while !rest.starts_with(')') {
+                    if !params.is_empty() {
+                        rest = rest.strip_prefix(',')?;
+                    }
+                    // Type codes are never followed by a colon, so anything 
+                    // that is must be a parameter name
+                    let name = rest.split_once(':')
+                        .filter(|(name, _)| name.chars().all(|c| c.is_alphanumeric() || c == '_'));
+                    let name = match name {
+                        Some((name, after)) => {
+                            rest = after;
+                            Some(name.to_string())
+                        }
+                        None => None,
+                    };
+                    let (ty, after) = Self::read_signature(rest)?;
+                    params.push((name, ty));
+                    rest = after;
+                }
+                let (ret_ty, rest) = Self::read_signature(&rest[1..])?;
+                return Some((Self::Function { params, ret_ty: ret_ty.into() }, rest));
+            }
+            _ => return None,
+        };
+        Some((ty, chars.as_str()))
+    }
 }
 
 impl Display for Ty {
@@ -122,6 +232,7 @@ impl Display for Ty {
             Self::Int => f.write_str("int"),
             Self::Float => f.write_str("float"),
             Self::String => f.write_str("string"),
+            Self::Object => f.write_str("object"),
             Self::Function { params, ret_ty } => write!(
                 f,
                 "fun({}) -> {ret_ty}", params.iter()
@@ -0,0 +1,154 @@
+// The opcode list and encodings must be kept in sync with the runtime's
+// interpreter in mod/src/lang/Bytecode.hpp
+
+/// Register-based opcodes. `R[x]` is register x of the current frame, `K[x]`
+/// is constant x of the module and `G[x]` is global x
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+pub enum Op {
+    /// Do nothing
+    Nop,
+    /// R[A] = R[B]
+    Move,
+    /// R[A] = K[Bx]
+    LoadConst,
+    /// R[A] = sBx
+    LoadInt,
+    /// R[A] = (B != 0)
+    LoadBool,
+    /// R[A] = void
+    LoadVoid,
+    /// R[A] = function Bx
+    LoadFunction,
+    /// R[A] = G[Bx]
+    GetGlobal,
+    /// G[Bx] = R[A]
+    SetGlobal,
+    /// R[A] = R[A].P[Bx], where P[Bx] is property access site Bx
+    GetProp,
+    /// R[A].P[Bx] = R[A + 1]
+    SetProp,
+
+    /// R[A] = R[B] + R[C]
+    Add,
+    /// R[A] = R[B] - R[C]
+    Sub,
+    /// R[A] = R[B] * R[C]
+    Mul,
+    /// R[A] = R[B] / R[C]
+    Div,
+    /// R[A] = R[B] % R[C]
+    Mod,
+    /// R[A] = -R[B]
+    Neg,
+    /// R[A] = !R[B]
+    Not,
+
+    /// R[A] = R[B] == R[C]
+    Eq,
+    /// R[A] = R[B] != R[C]
+    Neq,
+    /// R[A] = R[B] < R[C]
+    Less,
+    /// R[A] = R[B] <= R[C]
+    Leq,
+    /// R[A] = R[B] > R[C]
+    Grt,
+    /// R[A] = R[B] >= R[C]
+    Geq,
+
+    // Typed arithmetic, emitted when the checker has already resolved both
+    // operands to the same primitive type, so the runtime can skip its type
+    // tests. `>` and `>=` are emitted as `<` and `<=` with swapped operands
+
+    /// R[A] = R[B] + R[C] for ints
+    AddInt,
+    /// R[A] = R[B] - R[C] for ints
+    SubInt,
+    /// R[A] = R[B] * R[C] for ints
+    MulInt,
+    /// R[A] = R[B] < R[C] for ints
+    LessInt,
+    /// R[A] = R[B] <= R[C] for ints
+    LeqInt,
+    /// R[A] = R[B] + R[C] for floats
+    AddFloat,
+    /// R[A] = R[B] - R[C] for floats
+    SubFloat,
+    /// R[A] = R[B] * R[C] for floats
+    MulFloat,
+    /// R[A] = R[B] / R[C] for floats
+    DivFloat,
+    /// R[A] = R[B] < R[C] for floats
+    LessFloat,
+    /// R[A] = R[B] <= R[C] for floats
+    LeqFloat,
+
+    /// ip += sBx
+    Jump,
+    /// if R[A] then ip += sBx
+    JumpIf,
+    /// if !R[A] then ip += sBx
+    JumpIfNot,
+
+    /// Call function Bx with the arguments in R[A]..; the result is written
+    /// to R[A]
+    Call,
+    /// Like Call, but the function is read from R[B]
+    CallValue,
+    /// Call native import Bx with the arguments in R[A]..; the result is
+    /// written to R[A]
+    CallNative,
+    /// Return R[A] to the caller
+    Return,
+    /// Return void to the caller
+    ReturnVoid,
+    /// Start async function Bx as a new task with the arguments in R[A]..;
+    /// R[A] is set to void
+    Spawn,
+    /// Suspend the current task until the next frame
+    Yield,
+}
+
+/// A register index in the current function's frame
+pub type Reg = u8;
+
+/// A single fixed-width instruction. Layout, from the lowest bits:
+///  - `op`: 8 bits
+///  - `A`: 8 bits
+///  - `B`: 8 bits, `C`: 8 bits, or alternatively `Bx`: 16 bits
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Instr(u32);
+
+impl Instr {
+    pub fn abc(op: Op, a: Reg, b: u8, c: u8) -> Self {
+        Self(op as u32 | (a as u32) << 8 | (b as u32) << 16 | (c as u32) << 24)
+    }
+    pub fn abx(op: Op, a: Reg, bx: u16) -> Self {
+        Self(op as u32 | (a as u32) << 8 | (bx as u32) << 16)
+    }
+    pub fn asbx(op: Op, a: Reg, sbx: i16) -> Self {
+        Self::abx(op, a, sbx as u16)
+    }
+    /// Replace the `sBx` operand of this instruction, used for patching
+    /// jumps once their target is known
+    pub fn with_sbx(self, sbx: i16) -> Self {
+        Self(self.0 & 0xffff | (sbx as u16 as u32) << 16)
+    }
+    pub fn bits(self) -> u32 {
+        self.0
+    }
+}
+
+/// Ints are 48 bits wide at runtime, since values are NaN-boxed into a
+/// single word
+pub const MIN_INT: i64 = -(1 << 47);
+pub const MAX_INT: i64 = (1 << 47) - 1;
+
+/// An entry in the module's constant pool
+#[derive(Debug, Clone, PartialEq)]
+pub enum Constant {
+    Int(i64),
+    Float(f64),
+    String(String),
+}
@@ -0,0 +1,454 @@
+use std::{collections::{HashMap, HashSet}, sync::Arc};
+use crate::{
+    parser::parse::{NodePool, Node, RefToNode},
+    checker::{resolve::ResolveNode, path::FullIdentPath, pool::AST, ty::Ty},
+    shared::{src::{ArcSpan, Src}, logger::{LoggerRef, Message, Level}},
+    ast::decl::FunDecl,
+    prelude::Prelude
+};
+use super::{
+    bytecode::{Op, Instr, Reg, Constant},
+    fold::ConstValue,
+    image::{ImageBuilder, FunctionProto, FunctionID, PropertyType, FUNCTION_ASYNC, MAX_TABLE_SIZE}
+};
+
+/// Registers are addressed by 8-bit operands
+const MAX_REGISTERS: u16 = 256;
+
+pub struct FatalEmitError;
+
+pub type EmitResult<T = ()> = Result<T, FatalEmitError>;
+
+/// A Node that can be compiled into bytecode
+pub trait EmitNode: Node {
+    /// Emit code that evaluates this node. If `dst` is provided, the result
+    /// is written to it; otherwise the result is discarded
+    fn emit_node(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult;
+
+    /// Emit code that evaluates this node and get the register holding the
+    /// result. By default this evaluates into a new temporary, but nodes
+    /// that already live in a register (like locals) can return it directly
+    fn emit_operand(&self, pool: &NodePool, emitter: &mut Emitter) -> EmitResult<Reg> {
+        let reg = emitter.alloc_reg()?;
+        self.emit_node(pool, emitter, Some(reg))?;
+        Ok(reg)
+    }
+
+    /// Evaluate this node at compile time, if its value doesn't depend on
+    /// anything only known at runtime. Nodes with a constant value should
+    /// emit it with `Emitter::emit_const` instead of computing it
+    fn const_value(&self, _pool: &NodePool) -> Option<ConstValue> {
+        None
+    }
+}
+
+/// Reference(s) to Nodes that can be compiled into bytecode
+pub trait EmitRef {
+    fn emit_ref(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult;
+    fn emit_operand_ref(&self, pool: &NodePool, emitter: &mut Emitter) -> EmitResult<Reg>;
+    fn const_value_ref(&self, pool: &NodePool) -> Option<ConstValue>;
+}
+
+impl<T: EmitNode + ResolveNode> EmitRef for RefToNode<T> {
+    fn emit_ref(&self, pool: &NodePool, emitter: &mut Emitter, dst: Option<Reg>) -> EmitResult {
+        self.get(pool).emit_node(pool, emitter, dst)
+    }
+    fn emit_operand_ref(&self, pool: &NodePool, emitter: &mut Emitter) -> EmitResult<Reg> {
+        self.get(pool).emit_operand(pool, emitter)
+    }
+    fn const_value_ref(&self, pool: &NodePool) -> Option<ConstValue> {
+        self.get(pool).const_value(pool)
+    }
+}
+
+/// How a call to one of the Std property accessors is compiled
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PropertyAccess {
+    Get(PropertyType),
+    Set,
+}
+
+/// The Std functions that read and write properties of native objects, as
+/// `(target, property, value?)`. They're declared as externs, but calls to
+/// them are always compiled into property access sites, which the runtime
+/// caches per site, so the runtime doesn't implement them
+const PROPERTY_ACCESSORS: &[(&str, PropertyAccess)] = &[
+    ("getInt", PropertyAccess::Get(PropertyType::Int)),
+    ("getString", PropertyAccess::Get(PropertyType::String)),
+    ("getFloat", PropertyAccess::Get(PropertyType::Float)),
+    ("setInt", PropertyAccess::Set),
+    ("setString", PropertyAccess::Set),
+    ("setFloat", PropertyAccess::Set),
+    ("setObject", PropertyAccess::Set),
+];
+
+/// What a name refers to at runtime
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Binding {
+    Local(Reg),
+    Global(u16),
+    Function(FunctionID),
+    /// A native import
+    Native(u16),
+}
+
+struct EmitScope {
+    names: HashMap<FullIdentPath, Binding>,
+    /// Index of the function this scope belongs to in the function stack
+    function: usize,
+    /// Whether `let` declarations in this scope create globals
+    global: bool,
+    /// First free register when this scope was entered; locals declared in
+    /// this scope are released once it's left
+    reg_mark: u16,
+}
+
+struct FunctionState {
+    id: FunctionID,
+    code: Vec<Instr>,
+    spans: Vec<(u32, ArcSpan)>,
+    current_span: Option<ArcSpan>,
+    next_reg: u16,
+    register_count: u16,
+    param_count: u8,
+    is_async: bool,
+}
+
+/// Compiles a checked AST into a module image
+pub struct Emitter<'p> {
+    logger: LoggerRef,
+    prelude: &'p Prelude,
+    image: ImageBuilder,
+    scopes: Vec<EmitScope>,
+    functions: Vec<FunctionState>,
+    fun_decls: HashMap<FunctionID, FunDecl>,
+    async_functions: HashSet<FunctionID>,
+    global_count: u32,
+    next_scope_global: bool,
+}
+
+impl<'p> Emitter<'p> {
+    fn new(prelude: &'p Prelude, logger: LoggerRef) -> Self {
+        Self {
+            logger,
+            prelude,
+            image: ImageBuilder::new(),
+            scopes: vec![],
+            functions: vec![],
+            fun_decls: HashMap::new(),
+            async_functions: HashSet::new(),
+            global_count: 0,
+            next_scope_global: false,
+        }
+    }
+
+    /// Compile a fully checked AST into a module image. The top-level block
+    /// becomes the module's entry point, and its `let` declarations become
+    /// module globals
+    pub fn emit_module(ast: &AST, pool: &NodePool, prelude: &'p Prelude, logger: LoggerRef) -> Option<Vec<u8>> {
+        let mut emitter = Emitter::new(prelude, logger);
+        let entry = emitter.emit_entry(ast, pool).ok()?;
+        Some(emitter.image.write(entry, emitter.global_count))
+    }
+
+    fn emit_entry(&mut self, ast: &AST, pool: &NodePool) -> EmitResult<FunctionID> {
+        let entry = self.reserve_function("<module>", None)?;
+        self.begin_function(entry, 0, false);
+        self.next_scope_global = true;
+        let result = self.alloc_reg()?;
+        ast.emit_ref(pool, self, Some(result))?;
+        self.emit(Instr::abc(Op::Return, result, 0, 0));
+        self.end_function();
+        Ok(entry)
+    }
+
+    fn state(&mut self) -> &mut FunctionState {
+        self.functions.last_mut().expect("Internal compiler error: no function is being emitted")
+    }
+
+    pub fn error<S: Into<String>>(&self, msg: S, span: Option<ArcSpan>) -> FatalEmitError {
+        self.logger.lock().unwrap().log(Message::new(
+            Level::Error,
+            msg.into(),
+            span.unwrap_or(ArcSpan::builtin()).as_ref()
+        ));
+        FatalEmitError
+    }
+    fn error_here<S: Into<String>>(&mut self, msg: S) -> FatalEmitError {
+        let span = self.state().current_span.clone();
+        self.error(msg, span)
+    }
+
+    /// Reserve an ID for a function, so it can be called before its code
+    /// has been emitted
+    pub fn reserve_function(&mut self, name: &str, decl: Option<FunDecl>) -> EmitResult<FunctionID> {
+        let Some(id) = self.image.reserve_function(name) else {
+            return Err(self.error(
+                format!("Too many functions in module (the limit is {MAX_TABLE_SIZE})"),
+                None
+            ));
+        };
+        if let Some(decl) = decl {
+            self.fun_decls.insert(id, decl);
+        }
+        Ok(id)
+    }
+    /// Get the declaration of a function, if it has one
+    pub fn fun_decl(&self, id: FunctionID) -> Option<FunDecl> {
+        self.fun_decls.get(&id).copied()
+    }
+    /// Make calls to a function start a task instead
+    pub fn mark_async(&mut self, id: FunctionID) {
+        self.async_functions.insert(id);
+    }
+    /// Whether calling a function starts a task instead
+    pub fn is_async(&self, id: FunctionID) -> bool {
+        self.async_functions.contains(&id)
+    }
+    pub fn in_async_function(&mut self) -> bool {
+        self.state().is_async
+    }
+    pub fn is_function_defined(&self, id: FunctionID) -> bool {
+        self.image.is_defined(id)
+    }
+
+    /// Start emitting the code for a function. The function's parameters
+    /// occupy its first registers, in order
+    pub fn begin_function(&mut self, id: FunctionID, param_count: u8, is_async: bool) {
+        if is_async {
+            self.mark_async(id);
+        }
+        self.functions.push(FunctionState {
+            id,
+            code: vec![],
+            spans: vec![],
+            current_span: None,
+            next_reg: param_count as u16,
+            register_count: param_count as u16,
+            param_count,
+            is_async,
+        });
+        self.push_scope();
+    }
+    pub fn end_function(&mut self) {
+        self.pop_scope();
+        let fun = self.functions.pop().expect("Internal compiler error: no function is being emitted");
+        self.image.define_function(fun.id, FunctionProto {
+            code: fun.code,
+            register_count: fun.register_count,
+            param_count: fun.param_count,
+            flags: if fun.is_async { FUNCTION_ASYNC } else { 0 },
+            spans: fun.spans,
+        });
+    }
+
+    pub fn push_scope(&mut self) {
+        let global = std::mem::take(&mut self.next_scope_global);
+        let reg_mark = self.state().next_reg;
+        self.scopes.push(EmitScope {
+            names: HashMap::new(),
+            function: self.functions.len() - 1,
+            global,
+            reg_mark,
+        });
+    }
+    pub fn pop_scope(&mut self) {
+        let scope = self.scopes.pop().expect("Internal compiler error: popped root scope");
+        self.state().next_reg = scope.reg_mark;
+    }
+    /// Whether `let` declarations in the current scope create globals
+    pub fn scope_is_global(&self) -> bool {
+        self.scopes.last().is_some_and(|s| s.global)
+    }
+    pub fn bind(&mut self, name: FullIdentPath, binding: Binding) {
+        self.scopes.last_mut().unwrap().names.insert(name, binding);
+    }
+    /// Find a name only in the innermost scope
+    pub fn find_in_scope(&self, name: &FullIdentPath) -> Option<Binding> {
+        self.scopes.last().and_then(|s| s.names.get(name)).copied()
+    }
+    /// Find what a name refers to
+    pub fn lookup(&mut self, name: &FullIdentPath, span: Option<ArcSpan>) -> EmitResult<Binding> {
+        let current = self.functions.len() - 1;
+        for scope in self.scopes.iter().rev() {
+            if let Some(binding) = scope.names.get(name) {
+                if let Binding::Local(_) = binding {
+                    if scope.function != current {
+                        return Err(self.error(
+                            format!("Functions can not capture local variables like {name} yet"),
+                            span
+                        ));
+                    }
+                }
+                return Ok(*binding);
+            }
+        }
+        // Only the parts of the prelude a module actually uses end up in its
+        // imports
+        if let Some(item) = self.prelude.find(name) {
+            let native = item.native.clone();
+            return self.native(&native, item.param_count()).map(Binding::Native);
+        }
+        Err(self.error(format!("{name} can not be used at runtime"), span))
+    }
+
+    /// If a name refers to one of the Std property accessors, get how calls
+    /// to it are compiled
+    pub fn property_accessor(&self, name: &FullIdentPath) -> Option<PropertyAccess> {
+        if self.scopes.iter().any(|s| s.names.contains_key(name)) {
+            return None;
+        }
+        let item = self.prelude.find(name)?;
+        PROPERTY_ACCESSORS.iter().find(|(native, _)| *native == item.native).map(|(_, access)| *access)
+    }
+
+    pub fn new_global(&mut self) -> EmitResult<u16> {
+        if self.global_count as usize >= MAX_TABLE_SIZE {
+            return Err(self.error_here(
+                format!("Too many globals in module (the limit is {MAX_TABLE_SIZE})")
+            ));
+        }
+        self.global_count += 1;
+        Ok((self.global_count - 1) as u16)
+    }
+
+    pub fn alloc_reg(&mut self) -> EmitResult<Reg> {
+        self.alloc_regs(1)
+    }
+    /// Allocate consecutive registers, returning the first one
+    pub fn alloc_regs(&mut self, count: u16) -> EmitResult<Reg> {
+        let state = self.state();
+        let first = state.next_reg;
+        if first + count > MAX_REGISTERS {
+            return Err(self.error_here(format!(
+                "Function needs too many registers (the limit is {MAX_REGISTERS})"
+            )));
+        }
+        let state = self.state();
+        state.next_reg += count;
+        state.register_count = state.register_count.max(state.next_reg);
+        Ok(first as Reg)
+    }
+    /// The next register that would be allocated, for freeing temporaries
+    /// with `free_regs_to`
+    pub fn next_reg(&mut self) -> u16 {
+        self.state().next_reg
+    }
+    pub fn free_regs_to(&mut self, mark: u16) {
+        self.state().next_reg = mark;
+    }
+
+    pub fn constant(&mut self, value: Constant) -> EmitResult<u16> {
+        match self.image.constant(value) {
+            Some(k) => Ok(k),
+            None => Err(self.error_here(format!(
+                "Too many constants in module (the limit is {MAX_TABLE_SIZE})"
+            ))),
+        }
+    }
+
+    /// Emit code that loads a value known at compile time
+    pub fn emit_const(&mut self, value: &ConstValue, dst: Option<Reg>) -> EmitResult {
+        let Some(dst) = dst else { return Ok(()) };
+        let k = match value {
+            ConstValue::Void => {
+                self.emit(Instr::abc(Op::LoadVoid, dst, 0, 0));
+                return Ok(());
+            }
+            ConstValue::Bool(value) => {
+                self.emit(Instr::abc(Op::LoadBool, dst, *value as u8, 0));
+                return Ok(());
+            }
+            ConstValue::Int(value) => match i16::try_from(*value) {
+                // Small ints fit straight into the instruction
+                Ok(value) => {
+                    self.emit(Instr::asbx(Op::LoadInt, dst, value));
+                    return Ok(());
+                }
+                Err(_) => self.constant(Constant::Int(*value))?,
+            },
+            ConstValue::Float(value) => self.constant(Constant::Float(*value))?,
+            ConstValue::String(value) => self.constant(Constant::String(value.clone()))?,
+        };
+        self.emit(Instr::abx(Op::LoadConst, dst, k));
+        Ok(())
+    }
+
+    /// Import a native function by name
+    pub fn native(&mut self, name: &str, param_count: u8) -> EmitResult<u16> {
+        match self.image.native(name, param_count) {
+            Some(id) => Ok(id),
+            None => Err(self.error_here(format!(
+                "Too many extern functions in module (the limit is {MAX_TABLE_SIZE})"
+            ))),
+        }
+    }
+    /// List a native import in the module's symbol table
+    pub fn export(&mut self, name: &FullIdentPath, ty: &Ty, native: u16, span: Option<ArcSpan>) -> EmitResult {
+        let Some(signature) = ty.signature() else {
+            return Err(self.error(format!("{name} has a type that can't be exported ({ty})"), span));
+        };
+        self.image.export(&Prelude::export_name(name), &signature, native);
+        Ok(())
+    }
+
+    /// Get a new property access site for a `GetProp` or `SetProp`
+    pub fn property_site(&mut self, name: &str, ty: PropertyType) -> EmitResult<u16> {
+        match self.image.property_site(name, ty) {
+            Some(site) => Ok(site),
+            None => Err(self.error_here(format!(
+                "Too many property accesses in module (the limit is {MAX_TABLE_SIZE})"
+            ))),
+        }
+    }
+
+    pub fn emit(&mut self, instr: Instr) -> usize {
+        let state = self.state();
+        state.code.push(instr);
+        state.code.len() - 1
+    }
+    /// Emit a jump whose target is filled in later with `patch_jump`
+    pub fn emit_jump(&mut self, op: Op, cond: Reg) -> usize {
+        self.emit(Instr::asbx(op, cond, 0))
+    }
+    /// Make a jump emitted with `emit_jump` target the next instruction
+    pub fn patch_jump(&mut self, jump: usize) -> EmitResult {
+        let offset = self.state().code.len() as isize - jump as isize - 1;
+        let Ok(offset) = i16::try_from(offset) else {
+            return Err(self.error_here("Function is too large to jump across"));
+        };
+        let state = self.state();
+        state.code[jump] = state.code[jump].with_sbx(offset);
+        Ok(())
+    }
+
+    /// Attribute the following instructions to a source span. Returns the
+    /// previous span so it can be restored with `leave_span` once the node
+    /// has been emitted
+    pub fn enter_span(&mut self, span: Option<ArcSpan>) -> Option<ArcSpan> {
+        let prev = self.state().current_span.clone();
+        self.set_span(span);
+        prev
+    }
+    pub fn leave_span(&mut self, prev: Option<ArcSpan>) {
+        self.set_span(prev);
+    }
+    fn set_span(&mut self, span: Option<ArcSpan>) {
+        let state = self.state();
+        let Some(span) = span else { return };
+        if *span.0 == Src::Builtin || matches!(state.current_span, Some(ref cur) if same_span(cur, &span)) {
+            return;
+        }
+        let pc = state.code.len() as u32;
+        match state.spans.last_mut() {
+            // Nothing was emitted for the previous span
+            Some(last) if last.0 == pc => last.1 = span.clone(),
+            _ => state.spans.push((pc, span.clone())),
+        }
+        state.current_span = Some(span);
+    }
+}
+
+fn same_span(a: &ArcSpan, b: &ArcSpan) -> bool {
+    Arc::ptr_eq(&a.0, &b.0) && a.1 == b.1
+}
@@ -0,0 +1,170 @@
+use crate::ast::token::op::{BinaryOp, UnaryOp};
+
+// Folding has to produce exactly what the runtime's interpreter would, so
+// these must be kept in sync with the arithmetic in mod/src/lang/VM.cpp.
+// Anything that could fail at runtime (like division by zero) is left for
+// the runtime, so the error is reported where it happens
+
+/// Strings built by folding `string * int` are only kept if they're at most
+/// this long, so a small expression can't bloat the image
+const MAX_FOLDED_STRING_LEN: usize = 1024;
+
+/// A value known at compile time
+#[derive(Debug, Clone, PartialEq)]
+pub enum ConstValue {
+    Void,
+    Bool(bool),
+    Int(i64),
+    Float(f64),
+    String(String),
+}
+
+/// Wrap an int to the 48 bits ints have at runtime
+fn wrap_int(value: i64) -> i64 {
+    (value << 16) >> 16
+}
+
+impl ConstValue {
+    pub fn int(value: i64) -> Self {
+        Self::Int(wrap_int(value))
+    }
+
+    fn as_number(&self) -> Option<f64> {
+        match self {
+            Self::Int(i) => Some(*i as f64),
+            Self::Float(f) => Some(*f),
+            _ => None,
+        }
+    }
+
+    /// Evaluate a binary operation on two constants. Returns None if the
+    /// operation can't be evaluated at compile time
+    pub fn binary(op: BinaryOp, a: &ConstValue, b: &ConstValue) -> Option<ConstValue> {
+        use ConstValue as C;
+        Some(match (op, a, b) {
+            (BinaryOp::And, C::Bool(a), C::Bool(b)) => C::Bool(*a && *b),
+            (BinaryOp::Or, C::Bool(a), C::Bool(b)) => C::Bool(*a || *b),
+
+            (BinaryOp::Eq, a, b) => C::Bool(Self::equal(a, b)?),
+            (BinaryOp::Neq, a, b) => C::Bool(!Self::equal(a, b)?),
+
+            (BinaryOp::Add, C::Int(a), C::Int(b)) => C::int(a.wrapping_add(*b)),
+            (BinaryOp::Sub, C::Int(a), C::Int(b)) => C::int(a.wrapping_sub(*b)),
+            (BinaryOp::Mul, C::Int(a), C::Int(b)) => C::int(a.wrapping_mul(*b)),
+            (BinaryOp::Div, C::Int(a), C::Int(b)) if *b != 0 => C::int(a / b),
+            (BinaryOp::Mod, C::Int(a), C::Int(b)) if *b != 0 => C::int(a % b),
+            // `int % float` converts the result back to an int, which the
+            // runtime can't do for every result
+            (BinaryOp::Mod, C::Int(_), C::Float(_)) => return None,
+
+            (BinaryOp::Add | BinaryOp::Sub | BinaryOp::Mul | BinaryOp::Div | BinaryOp::Mod, a, b) => {
+                let (Some(x), Some(y)) = (a.as_number(), b.as_number()) else {
+                    return Self::binary_string(op, a, b);
+                };
+                C::Float(match op {
+                    BinaryOp::Add => x + y,
+                    BinaryOp::Sub => x - y,
+                    BinaryOp::Mul => x * y,
+                    BinaryOp::Div => x / y,
+                    _ => x % y,
+                })
+            }
+
+            (BinaryOp::Less | BinaryOp::Leq | BinaryOp::Grt | BinaryOp::Geq, a, b) => {
+                let ord = match (a, b) {
+                    (C::Int(a), C::Int(b)) => Some(a.cmp(b)),
+                    (C::String(a), C::String(b)) => Some(a.as_bytes().cmp(b.as_bytes())),
+                    _ => a.as_number()?.partial_cmp(&b.as_number()?),
+                };
+                // Comparisons with NaN are always false
+                let Some(ord) = ord else { return Some(C::Bool(false)) };
+                C::Bool(match op {
+                    BinaryOp::Less => ord.is_lt(),
+                    BinaryOp::Leq => ord.is_le(),
+                    BinaryOp::Grt => ord.is_gt(),
+                    _ => ord.is_ge(),
+                })
+            }
+
+            _ => return None,
+        })
+    }
+
+    fn binary_string(op: BinaryOp, a: &ConstValue, b: &ConstValue) -> Option<ConstValue> {
+        match (op, a, b) {
+            (BinaryOp::Add, ConstValue::String(a), ConstValue::String(b)) => {
+                Some(ConstValue::String(format!("{a}{b}")))
+            }
+            (BinaryOp::Mul, ConstValue::String(a), ConstValue::Int(times)) => {
+                let times = (*times).max(0) as usize;
+                if a.len().saturating_mul(times) > MAX_FOLDED_STRING_LEN {
+                    return None;
+                }
+                Some(ConstValue::String(a.repeat(times)))
+            }
+            _ => None,
+        }
+    }
+
+    fn equal(a: &ConstValue, b: &ConstValue) -> Option<bool> {
+        use ConstValue as C;
+        Some(match (a, b) {
+            (C::Void, C::Void) => true,
+            (C::Bool(a), C::Bool(b)) => a == b,
+            (C::Int(a), C::Int(b)) => a == b,
+            (C::String(a), C::String(b)) => a == b,
+            (a, b) => match (a.as_number(), b.as_number()) {
+                (Some(x), Some(y)) => x == y,
+                // Values of different types are never equal
+                _ => false,
+            },
+        })
+    }
+
+    /// Evaluate a unary operation on a constant
+    pub fn unary(op: UnaryOp, a: &ConstValue) -> Option<ConstValue> {
+        match (op, a) {
+            (UnaryOp::Plus, a) => Some(a.clone()),
+            (UnaryOp::Neg, ConstValue::Int(i)) => Some(ConstValue::int(i.wrapping_neg())),
+            (UnaryOp::Neg, ConstValue::Float(f)) => Some(ConstValue::Float(-f)),
+            (UnaryOp::Not, ConstValue::Bool(b)) => Some(ConstValue::Bool(!b)),
+            _ => None,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// The generic comparison ops in mod/src/lang/VM.cpp, which compare 
+    /// numbers with the operators themselves
+    fn interpreted(op: BinaryOp, x: f64, y: f64) -> bool {
+        match op {
+            BinaryOp::Less => x < y,
+            BinaryOp::Leq => x <= y,
+            BinaryOp::Grt => x > y,
+            _ => x >= y,
+        }
+    }
+
+    #[test]
+    fn nan_comparisons_match_interpreter() {
+        let values = [
+            ConstValue::Float(f64::NAN),
+            ConstValue::Float(1.5),
+            ConstValue::int(2),
+        ];
+        for op in [BinaryOp::Less, BinaryOp::Leq, BinaryOp::Grt, BinaryOp::Geq] {
+            for a in &values {
+                for b in &values {
+                    let expected = interpreted(op, a.as_number().unwrap(), b.as_number().unwrap());
+                    assert_eq!(
+                        ConstValue::binary(op, a, b), Some(ConstValue::Bool(expected)),
+                        "{a:?} {op:?} {b:?}"
+                    );
+                }
+            }
+        }
+    }
+}
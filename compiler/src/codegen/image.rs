@@ -0,0 +1,335 @@
+use std::collections::HashMap;
+use crate::shared::src::ArcSpan;
+use super::bytecode::{Instr, Constant};
+
+// The layout of images must be kept in sync with the runtime's loader in
+// mod/src/lang/Image.hpp
+
+/// Magic bytes at the start of every compiled module (`.dashc`) image
+pub const IMAGE_MAGIC: &[u8; 4] = b"DSHC";
+/// Bumped whenever the layout of images or the bytecode changes. The runtime
+/// rejects images with a different version
+pub const IMAGE_VERSION: u32 = 6;
+/// Every section starts at an offset aligned to this many bytes
+const IMAGE_SECTION_ALIGN: usize = 16;
+const IMAGE_HEADER_SIZE: usize = 88;
+const IMAGE_SECTION_COUNT: usize = 8;
+/// Index of the sections `read_exports` needs in the header
+const STRINGS_SECTION: usize = 0;
+const NATIVES_SECTION: usize = 3;
+const EXPORTS_SECTION: usize = 7;
+
+/// Functions, globals and constants are referred to by 16-bit operands
+pub const MAX_TABLE_SIZE: usize = u16::MAX as usize + 1;
+
+pub type FunctionID = u16;
+
+/// Flags of a function prototype
+pub const FUNCTION_ASYNC: u8 = 1 << 0;
+
+/// The type of value a property get expects. Native properties aren't typed
+/// for the checker, so the runtime checks the value read against this
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+pub enum PropertyType {
+    Any,
+    Int,
+    String,
+    /// Ints are read as floats
+    Float,
+    Object,
+}
+
+/// A function whose code has been fully emitted
+#[derive(Debug)]
+pub struct FunctionProto {
+    pub code: Vec<Instr>,
+    pub register_count: u16,
+    pub param_count: u8,
+    /// `FUNCTION_*` flags
+    pub flags: u8,
+    /// Source locations of the function's instructions as (pc, span) pairs,
+    /// sorted by pc
+    pub spans: Vec<(u32, ArcSpan)>,
+}
+
+#[derive(Hash, PartialEq, Eq)]
+enum ConstantKey {
+    Int(i64),
+    Float(u64),
+    String(String),
+}
+
+/// Builds a module image that the runtime can map into memory and execute
+/// without any further processing
+#[derive(Default)]
+pub struct ImageBuilder {
+    strings: Vec<u8>,
+    string_offsets: HashMap<String, u32>,
+    constants: Vec<Constant>,
+    constant_ids: HashMap<ConstantKey, u16>,
+    function_names: Vec<u32>,
+    functions: Vec<Option<FunctionProto>>,
+    natives: Vec<(u32, u8)>,
+    property_sites: Vec<(u32, PropertyType)>,
+    exports: Vec<(u32, u32, u16)>,
+}
+
+impl ImageBuilder {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Add a string to the string table, returning its offset
+    pub fn string(&mut self, value: &str) -> u32 {
+        if let Some(offset) = self.string_offsets.get(value) {
+            return *offset;
+        }
+        let offset = self.strings.len() as u32;
+        self.strings.extend((value.len() as u32).to_le_bytes());
+        self.strings.extend(value.as_bytes());
+        self.strings.push(0);
+        // Strings are length-prefixed, so keep them aligned for the length
+        while self.strings.len() % 4 != 0 {
+            self.strings.push(0);
+        }
+        self.string_offsets.insert(value.to_string(), offset);
+        offset
+    }
+
+    /// Add a constant to the constant pool, returning its index. Returns
+    /// None if the pool is full
+    pub fn constant(&mut self, value: Constant) -> Option<u16> {
+        let key = match &value {
+            Constant::Int(i) => ConstantKey::Int(*i),
+            Constant::Float(f) => ConstantKey::Float(f.to_bits()),
+            Constant::String(s) => ConstantKey::String(s.clone()),
+        };
+        if let Some(id) = self.constant_ids.get(&key) {
+            return Some(*id);
+        }
+        if self.constants.len() >= MAX_TABLE_SIZE {
+            return None;
+        }
+        let id = self.constants.len() as u16;
+        if let Constant::String(ref s) = value {
+            self.string(s);
+        }
+        self.constants.push(value);
+        self.constant_ids.insert(key, id);
+        Some(id)
+    }
+
+    /// Reserve an ID for a function whose code will be provided later with
+    /// `define_function`. Returns None if there are too many functions
+    pub fn reserve_function(&mut self, name: &str) -> Option<FunctionID> {
+        if self.functions.len() >= MAX_TABLE_SIZE {
+            return None;
+        }
+        let name = self.string(name);
+        self.function_names.push(name);
+        self.functions.push(None);
+        Some((self.functions.len() - 1) as FunctionID)
+    }
+
+    pub fn define_function(&mut self, id: FunctionID, proto: FunctionProto) {
+        for (_, ArcSpan(src, _)) in &proto.spans {
+            self.string(&src.name());
+        }
+        self.functions[id as usize] = Some(proto);
+    }
+
+    /// Add a native function import, returning its index. Imports are
+    /// resolved by name when the runtime loads the module
+    pub fn native(&mut self, name: &str, param_count: u8) -> Option<u16> {
+        let name = self.string(name);
+        if let Some(ix) = self.natives.iter().position(|n| *n == (name, param_count)) {
+            return Some(ix as u16);
+        }
+        if self.natives.len() >= MAX_TABLE_SIZE {
+            return None;
+        }
+        self.natives.push((name, param_count));
+        Some((self.natives.len() - 1) as u16)
+    }
+
+    /// Add a property access site, returning its index. Every access needs
+    /// its own site, since the runtime keeps an inline cache per site. Sets
+    /// should use `PropertyType::Any`
+    pub fn property_site(&mut self, name: &str, ty: PropertyType) -> Option<u16> {
+        if self.property_sites.len() >= MAX_TABLE_SIZE {
+            return None;
+        }
+        let name = self.string(name);
+        self.property_sites.push((name, ty));
+        Some((self.property_sites.len() - 1) as u16)
+    }
+
+    /// List a native import in the module's symbol table, so other modules
+    /// can import it by name. `signature` is the encoded type of the import
+    pub fn export(&mut self, name: &str, signature: &str, native: u16) {
+        let name = self.string(name);
+        let signature = self.string(signature);
+        self.exports.push((name, signature, native));
+    }
+
+    /// Whether the code for a reserved function has been provided yet
+    pub fn is_defined(&self, id: FunctionID) -> bool {
+        self.functions[id as usize].is_some()
+    }
+
+    /// Write out the image. Every reserved function must have been defined
+    pub fn write(mut self, entry: FunctionID, global_count: u32) -> Vec<u8> {
+        let mut code = Vec::new();
+        let mut protos = Vec::new();
+        let mut spans = Vec::new();
+        let functions = std::mem::take(&mut self.functions);
+        for (id, fun) in functions.into_iter().enumerate() {
+            let fun = fun.unwrap_or_else(|| panic!(
+                "Internal compiler error: function #{id} was reserved but never defined"
+            ));
+            // Code offsets are in instructions, not bytes
+            let offset = (code.len() / 4) as u32;
+            protos.extend(offset.to_le_bytes());
+            protos.extend((fun.code.len() as u32).to_le_bytes());
+            protos.extend(self.function_names[id].to_le_bytes());
+            protos.extend(fun.register_count.to_le_bytes());
+            protos.push(fun.param_count);
+            protos.push(fun.flags);
+
+            for (pc, ArcSpan(src, range)) in &fun.spans {
+                let (line, column) = src.line_col(range.start);
+                let (line, column) = (line as u32, column as u32);
+                spans.extend((offset + pc).to_le_bytes());
+                spans.extend(self.string_offsets[&src.name()].to_le_bytes());
+                spans.extend(line.to_le_bytes());
+                spans.extend(column.to_le_bytes());
+            }
+            code.extend(fun.code.iter().flat_map(|i| i.bits().to_le_bytes()));
+        }
+
+        let mut constants = Vec::new();
+        for k in &self.constants {
+            let (ty, value) = match k {
+                Constant::Int(i) => (0u8, *i as u64),
+                Constant::Float(f) => (1u8, f.to_bits()),
+                Constant::String(s) => (2u8, self.string_offsets[s] as u64),
+            };
+            constants.push(ty);
+            constants.extend([0u8; 7]);
+            constants.extend(value.to_le_bytes());
+        }
+
+        let mut natives = Vec::new();
+        for (name, param_count) in &self.natives {
+            natives.extend(name.to_le_bytes());
+            natives.push(*param_count);
+            natives.extend([0u8; 3]);
+        }
+
+        let mut properties = Vec::new();
+        for (name, ty) in &self.property_sites {
+            properties.extend(name.to_le_bytes());
+            properties.push(*ty as u8);
+            properties.extend([0u8; 3]);
+        }
+
+        let mut exports = Vec::new();
+        for (name, signature, native) in &self.exports {
+            exports.extend(name.to_le_bytes());
+            exports.extend(signature.to_le_bytes());
+            exports.extend(native.to_le_bytes());
+            exports.extend([0u8; 2]);
+        }
+
+        // Order must match the ImageSection enum
+        let sections: [&[u8]; IMAGE_SECTION_COUNT] = [
+            &self.strings, &constants, &protos, &natives, &code, &spans, &properties, &exports
+        ];
+        let align = |n: usize| n.div_ceil(IMAGE_SECTION_ALIGN) * IMAGE_SECTION_ALIGN;
+        let mut offsets = [0usize; IMAGE_SECTION_COUNT];
+        let mut size = align(IMAGE_HEADER_SIZE);
+        for (i, section) in sections.iter().enumerate() {
+            offsets[i] = size;
+            size = align(size + section.len());
+        }
+
+        let mut image = Vec::with_capacity(size);
+        image.extend(IMAGE_MAGIC);
+        image.extend(IMAGE_VERSION.to_le_bytes());
+        image.extend((size as u32).to_le_bytes());
+        image.extend((entry as u32).to_le_bytes());
+        image.extend(global_count.to_le_bytes());
+        // Flags
+        image.extend(0u32.to_le_bytes());
+        for (offset, section) in offsets.iter().zip(sections) {
+            image.extend((*offset as u32).to_le_bytes());
+            image.extend((section.len() as u32).to_le_bytes());
+        }
+        for (offset, section) in offsets.iter().zip(sections) {
+            image.resize(*offset, 0);
+            image.extend(section);
+        }
+        image.resize(size, 0);
+        image
+    }
+}
+
+/// A native import listed in a module's symbol table
+#[derive(Debug, Clone)]
+pub struct Export {
+    pub name: String,
+    pub signature: String,
+    /// Name of the native function the runtime links the import to
+    pub native: String,
+    pub param_count: u8,
+}
+
+/// Read the symbol table of a module image without loading the rest of it
+pub fn read_exports(image: &[u8]) -> Result<Vec<Export>, String> {
+    let u32_at = |offset: usize| -> Result<u32, String> {
+        image.get(offset..offset + 4)
+            .map(|b| u32::from_le_bytes(b.try_into().unwrap()))
+            .ok_or_else(|| "Image is truncated".to_string())
+    };
+    if image.len() < IMAGE_HEADER_SIZE || &image[0..4] != IMAGE_MAGIC {
+        return Err("Not a compiled Dash module".into());
+    }
+    let version = u32_at(4)?;
+    if version != IMAGE_VERSION {
+        return Err(format!(
+            "Module was compiled for image version {version}, but this compiler requires version {IMAGE_VERSION}"
+        ));
+    }
+    let section = |index: usize| -> Result<&[u8], String> {
+        let offset = u32_at(24 + index * 8)? as usize;
+        let size = u32_at(28 + index * 8)? as usize;
+        image.get(offset..offset + size).ok_or_else(|| format!("Section #{index} is out of bounds"))
+    };
+    let strings = section(STRINGS_SECTION)?;
+    let string = |offset: u32| -> Result<String, String> {
+        let offset = offset as usize;
+        let len = strings.get(offset..offset + 4)
+            .map(|b| u32::from_le_bytes(b.try_into().unwrap()) as usize)
+            .ok_or("String is out of bounds")?;
+        strings.get(offset + 4..offset + 4 + len)
+            .and_then(|s| std::str::from_utf8(s).ok())
+            .map(str::to_string)
+            .ok_or_else(|| "String is out of bounds".to_string())
+    };
+    let natives = section(NATIVES_SECTION)?;
+    section(EXPORTS_SECTION)?
+        .chunks_exact(12)
+        .map(|entry| {
+            let field = |i: usize| u32::from_le_bytes(entry[i..i + 4].try_into().unwrap());
+            let native = u16::from_le_bytes([entry[8], entry[9]]) as usize * 8;
+            let import = natives.get(native..native + 8).ok_or("Export refers to a native that doesn't exist")?;
+            Ok(Export {
+                name: string(field(0))?,
+                signature: string(field(4))?,
+                native: string(u32::from_le_bytes(import[0..4].try_into().unwrap()))?,
+                param_count: import[4],
+            })
+        })
+        .collect()
+}
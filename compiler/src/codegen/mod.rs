@@ -0,0 +1,4 @@
+pub mod bytecode;
+pub mod image;
+pub mod emit;
+pub mod fold;
@@ -0,0 +1,124 @@
+use std::{
+    ffi::{c_char, CString},
+    panic::{catch_unwind, AssertUnwindSafe},
+    path::PathBuf,
+    sync::OnceLock,
+};
+use crate::{
+    codegen::image::IMAGE_VERSION,
+    incremental::CompileDb,
+    prelude::Prelude,
+};
+
+// C interface used by the runtime mod to compile sources on the fly. The
+// declarations must be kept in sync with mod/src/lang/Compiler.hpp
+
+/// The result of compiling a source file. Must be freed with
+/// `dash_free_compile_result`
+#[repr(C)]
+pub struct DashCompileResult {
+    /// The compiled module image, or null if compilation failed
+    pub image: *mut u8,
+    pub image_size: usize,
+    /// Everything the compiler logged as a NUL-terminated string, or null if
+    /// nothing was logged
+    pub messages: *mut c_char,
+}
+
+/// Identifies the compiler build that produced an image. Compiled images are
+/// only reused by a runtime with the same compiler version, so this must
+/// change whenever the output of the compiler changes. The build ID is a
+/// hash of the compiler's sources (see build.rs)
+#[no_mangle]
+pub extern "C" fn dash_compiler_version() -> *const c_char {
+    static VERSION: OnceLock<CString> = OnceLock::new();
+    VERSION.get_or_init(|| {
+        CString::new(format!(
+            "{} (image v{IMAGE_VERSION}, build {})",
+            env!("CARGO_PKG_VERSION"), env!("DASH_COMPILER_BUILD_ID")
+        )).unwrap()
+    }).as_ptr()
+}
+
+// Every compile gets its own database. The runtime's bytecode cache already
+// skips sources that haven't changed, so a database kept between compiles
+// would mostly hold the pools and images of files that are never compiled
+// again, for the whole session. It would also need a lock that keeps the
+// runtime's worker threads from compiling files in parallel. Tools that
+// recompile the same files, like `dash-cli --watch`, keep one instead
+
+fn compile(path: PathBuf, data: String) -> (Option<Vec<u8>>, String) {
+    let mut db = CompileDb::new();
+    db.set_source(path.clone(), data);
+    db.update();
+    let image = db.image(&path).map(<[u8]>::to_vec);
+    let messages = db.diagnostics(&path).iter().fold(String::new(), |mut acc, d| {
+        acc.push_str(&d.text);
+        acc.push('\n');
+        acc
+    });
+    (image, messages)
+}
+
+/// Compile a source file into a module image. `path` is only used for
+/// diagnostics and debug info; the source is read from `data`
+///
+/// # Safety
+/// `path` and `data` must point to valid UTF-8 of the given lengths
+#[no_mangle]
+pub unsafe extern "C" fn dash_compile(
+    path: *const u8, path_len: usize,
+    data: *const u8, data_len: usize
+) -> DashCompileResult {
+    let path = String::from_utf8_lossy(std::slice::from_raw_parts(path, path_len)).into_owned();
+    let data = String::from_utf8_lossy(std::slice::from_raw_parts(data, data_len)).into_owned();
+
+    // The runtime writes messages to a log file, not a terminal
+    colored::control::set_override(false);
+
+    let (image, messages) = catch_unwind(AssertUnwindSafe(|| compile(PathBuf::from(path), data)))
+        .unwrap_or_else(|_| (None, String::from("Internal compiler error while compiling")));
+
+    let (image, image_size) = match image {
+        Some(image) => {
+            let size = image.len();
+            (Box::into_raw(image.into_boxed_slice()) as *mut u8, size)
+        }
+        None => (std::ptr::null_mut(), 0),
+    };
+    let messages = if messages.is_empty() {
+        std::ptr::null_mut()
+    }
+    else {
+        // Messages don't contain NULs unless the source does
+        CString::new(messages.replace('\0', "")).unwrap().into_raw()
+    };
+    DashCompileResult { image, image_size, messages }
+}
+
+/// Use a precompiled image of the standard library, so it doesn't need to be
+/// checked before the first compile. Must be called before anything is
+/// compiled. Returns false if the image is invalid or Std has already been
+/// loaded
+///
+/// # Safety
+/// `image` must point to `image_size` readable bytes
+#[no_mangle]
+pub unsafe extern "C" fn dash_load_std(image: *const u8, image_size: usize) -> bool {
+    let image = std::slice::from_raw_parts(image, image_size);
+    catch_unwind(|| Prelude::load_std(image).is_ok()).unwrap_or(false)
+}
+
+/// Free the memory owned by a compile result
+///
+/// # Safety
+/// `result` must have been returned by `dash_compile` and not freed before
+#[no_mangle]
+pub unsafe extern "C" fn dash_free_compile_result(result: DashCompileResult) {
+    if !result.image.is_null() {
+        drop(Box::from_raw(std::ptr::slice_from_raw_parts_mut(result.image, result.image_size)));
+    }
+    if !result.messages.is_null() {
+        drop(CString::from_raw(result.messages));
+    }
+}
@@ -0,0 +1,243 @@
+use std::{
+    collections::HashMap,
+    path::{Path, PathBuf},
+    sync::Arc,
+};
+use crate::{
+    shared::{logger::{Diagnostic, Logger}, parallel, src::{Src, SrcPool}},
+    parser::parse::NodePool,
+    checker::{pool::{ASTPool, AST}, ty::Ty},
+    prelude::Prelude,
+    emit_bytecode,
+};
+
+// An incremental compilation database for tools that compile the same
+// sources over and over, like editors and language servers.
+// Every result is memoized by the contents of its source file, so after an
+// edit only the edited files are tokenized, parsed and checked again. Files
+// don't see each other's declarations yet, so nothing else depends on them.
+// The only thing they share is the standard library, which never changes
+// while the database exists.
+// Databases can be given a maximum number of files, so one that lives as
+// long as an editor session doesn't keep every file that was ever opened.
+// Files that weren't set for the longest are evicted first
+
+/// Everything the database knows about one version of a source file
+struct FileState {
+    src: Arc<Src>,
+    pool: NodePool,
+    ast: Option<AST>,
+    ty: Option<Ty>,
+    diagnostics: Vec<Diagnostic>,
+    errors: usize,
+    /// The compiled module image, once it has been asked for
+    image: Option<Option<Vec<u8>>>,
+    /// When the file was last set, for picking which files to evict
+    last_set: u64,
+}
+
+impl FileState {
+    /// Parse and check a file on its own, collecting what it logs
+    fn check(src: Arc<Src>, last_set: u64) -> Self {
+        let logger = Logger::buffered();
+        let mut pool = NodePool::new();
+        let mut asts = ASTPool::parse_src_pool(&mut pool, &SrcPool::new_from_srcs(vec![src.clone()]), logger.clone());
+        let ty = asts.check_all(&mut pool, Prelude::std(), logger.clone()).pop();
+        let errors = logger.lock().unwrap().errors();
+        let diagnostics = logger.lock().unwrap().take();
+        Self {
+            src,
+            pool,
+            ast: asts.iter().next().copied(),
+            ty,
+            diagnostics,
+            errors,
+            image: None,
+            last_set,
+        }
+    }
+}
+
+/// How much work the last call to `CompileDb::update` did
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct UpdateStats {
+    /// Files that were parsed and checked again
+    pub checked: usize,
+    /// Files whose previous results were still up-to-date
+    pub reused: usize,
+    /// Files that were forgotten to stay within the maximum number of files
+    pub evicted: usize,
+}
+
+#[derive(Default)]
+pub struct CompileDb {
+    files: HashMap<PathBuf, FileState>,
+    /// Sources that have been set but not checked yet, along with when they
+    /// were set
+    pending: HashMap<PathBuf, (String, u64)>,
+    /// Counts calls to `set_source`
+    clock: u64,
+    max_files: Option<usize>,
+}
+
+impl CompileDb {
+    pub fn new() -> Self {
+        Self::default()
+    }
+    /// Create a database that keeps at most `max_files` files, evicting the
+    /// ones that weren't set for the longest when updating
+    pub fn with_max_files(max_files: usize) -> Self {
+        assert!(max_files > 0, "A database has to be able to keep at least one file");
+        Self { max_files: Some(max_files), ..Self::default() }
+    }
+    /// Set the contents of a file. Returns false if the file already had
+    /// these contents, in which case none of its results are invalidated
+    pub fn set_source<P: Into<PathBuf>>(&mut self, path: P, data: String) -> bool {
+        let path = path.into();
+        self.clock += 1;
+        if let Some(file) = self.files.get_mut(&path).filter(|f| f.src.data() == data) {
+            file.last_set = self.clock;
+            self.pending.remove(&path);
+            return false;
+        }
+        self.pending.insert(path, (data, self.clock));
+        true
+    }
+    /// Forget a file and everything computed from it
+    pub fn remove_source(&mut self, path: &Path) {
+        self.files.remove(path);
+        self.pending.remove(path);
+    }
+    /// Bring every file up-to-date. Changed files are checked in parallel,
+    /// except for the ones that would be evicted right away
+    pub fn update(&mut self) -> UpdateStats {
+        let mut stats = UpdateStats::default();
+        let mut changed = std::mem::take(&mut self.pending).into_iter().collect::<Vec<_>>();
+        for (path, (_, last_set)) in &changed {
+            if let Some(file) = self.files.get_mut(path) {
+                file.last_set = *last_set;
+            }
+        }
+        if let Some(max_files) = self.max_files {
+            let mut ages = self.files.values().map(|f| f.last_set)
+                .chain(changed.iter()
+                    .filter(|(path, _)| !self.files.contains_key(path))
+                    .map(|(_, (_, last_set))| *last_set)
+                )
+                .collect::<Vec<_>>();
+            if ages.len() > max_files {
+                // Everything set before the oldest file that is kept goes
+                ages.sort_unstable();
+                let oldest_kept = ages[ages.len() - max_files];
+                changed.retain(|(path, (_, last_set))| {
+                    let keep = *last_set >= oldest_kept;
+                    // Files that were checked before are counted below
+                    if !keep && !self.files.contains_key(path) {
+                        stats.evicted += 1;
+                    }
+                    keep
+                });
+                let before = self.files.len();
+                self.files.retain(|_, f| f.last_set >= oldest_kept);
+                stats.evicted += before - self.files.len();
+            }
+        }
+        stats.checked = changed.len();
+        stats.reused = self.files.len() - changed.iter()
+            .filter(|(path, _)| self.files.contains_key(path))
+            .count();
+        let checked = parallel::map(changed, |(path, (data, last_set))| {
+            let state = FileState::check(Src::from_memory(path.clone(), data), last_set);
+            (path, state)
+        });
+        self.files.extend(checked);
+        stats
+    }
+    /// The files in the database, in no particular order
+    pub fn paths(&self) -> impl Iterator<Item = &Path> {
+        self.files.keys().map(PathBuf::as_path)
+    }
+    /// What the compiler logged about a file when it was last checked
+    pub fn diagnostics(&self, path: &Path) -> &[Diagnostic] {
+        self.files.get(path).map(|f| f.diagnostics.as_slice()).unwrap_or_default()
+    }
+    /// The type a file evaluates to, if it could be checked
+    pub fn ty(&self, path: &Path) -> Option<&Ty> {
+        self.files.get(path)?.ty.as_ref()
+    }
+    /// Compile a file into a module image. Returns None if the file has
+    /// errors or can't be compiled yet; the reason is added to its
+    /// diagnostics. Images are only emitted once for every version of a file
+    pub fn image(&mut self, path: &Path) -> Option<&[u8]> {
+        let file = self.files.get_mut(path)?;
+        if file.image.is_none() {
+            file.image = Some(Self::emit(file));
+        }
+        file.image.as_ref().unwrap().as_deref()
+    }
+    fn emit(file: &mut FileState) -> Option<Vec<u8>> {
+        if file.errors > 0 {
+            return None;
+        }
+        let ast = file.ast?;
+        let logger = Logger::buffered();
+        let image = emit_bytecode(&ast, &file.pool, Prelude::std(), logger.clone());
+        file.diagnostics.append(&mut logger.lock().unwrap().take());
+        image
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn stats(checked: usize, reused: usize, evicted: usize) -> UpdateStats {
+        UpdateStats { checked, reused, evicted }
+    }
+
+    #[test]
+    fn unchanged_sources_are_reused() {
+        let mut db = CompileDb::new();
+        assert!(db.set_source("a.dash", String::from("let a = 1;")));
+        assert!(db.set_source("b.dash", String::from("let b = 2;")));
+        assert_eq!(db.update(), stats(2, 0, 0));
+
+        assert!(!db.set_source("a.dash", String::from("let a = 1;")));
+        assert!(!db.set_source("b.dash", String::from("let b = 2;")));
+        assert_eq!(db.update(), stats(0, 2, 0));
+    }
+
+    #[test]
+    fn only_edited_sources_are_checked() {
+        let mut db = CompileDb::new();
+        db.set_source("a.dash", String::from("let a = 1;"));
+        db.set_source("b.dash", String::from("let b = 2;"));
+        db.update();
+
+        assert!(db.set_source("b.dash", String::from("let b = 3;")));
+        assert_eq!(db.update(), stats(1, 1, 0));
+        assert_eq!(db.update(), stats(0, 2, 0));
+    }
+
+    #[test]
+    fn least_recently_set_sources_are_evicted() {
+        let mut db = CompileDb::with_max_files(2);
+        db.set_source("a.dash", String::from("let a = 1;"));
+        db.set_source("b.dash", String::from("let b = 2;"));
+        db.update();
+
+        // Setting `a` again, even without changes, makes `b` the oldest
+        db.set_source("a.dash", String::from("let a = 1;"));
+        db.set_source("c.dash", String::from("let c = 3;"));
+        assert_eq!(db.update(), stats(1, 1, 1));
+        let mut paths = db.paths().map(Path::to_path_buf).collect::<Vec<_>>();
+        paths.sort();
+        assert_eq!(paths, [PathBuf::from("a.dash"), PathBuf::from("c.dash")]);
+
+        // Files that would be evicted right away aren't checked at all
+        db.set_source("d.dash", String::from("let d = 4;"));
+        db.set_source("e.dash", String::from("let e = 5;"));
+        db.set_source("f.dash", String::from("let f = 6;"));
+        assert_eq!(db.update(), stats(2, 0, 3));
+    }
+}
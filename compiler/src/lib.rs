@@ -2,10 +2,12 @@
 #![warn(clippy::todo)]
 
 use checker::coherency::Checker;
+use codegen::emit::Emitter;
 use checker::pool::AST;
 use checker::ty::Ty;
 use parser::parse::NodePool;
-use parser::tokenizer::{Tokenizer, Token};
+use parser::tokenizer::{Tokenizer, Token, TokenKind};
+use prelude::Prelude;
 use shared::logger::LoggerRef;
 use shared::src::Src;
 
@@ -13,11 +15,35 @@ pub mod parser;
 pub mod shared;
 pub mod ast;
 pub mod checker;
+pub mod codegen;
+pub mod ffi;
+pub mod incremental;
+pub mod prelude;
 
 pub fn tokenize<'s, 'g: 's>(src: &'s Src, logger: LoggerRef) -> Vec<Token<'s>> {
     Tokenizer::new(src, logger).collect()
 }
 
-pub fn check_coherency(ast: &mut AST, list: &mut NodePool, logger: LoggerRef) -> Ty {
-    Checker::try_resolve(ast, list, logger)
+/// Tokenize a whole source, including the contents of every parenthesis 
+/// which are otherwise only tokenized once they're parsed, and return the 
+/// number of tokens
+pub fn token_count(src: &Src, logger: LoggerRef) -> usize {
+    fn count<'s>(tokens: impl Iterator<Item = Token<'s>>) -> usize {
+        tokens.map(|token| match token.kind {
+            TokenKind::Parentheses(tree) | TokenKind::Brackets(tree) | TokenKind::Braces(tree) => 1 + count(tree),
+            _ => 1,
+        }).sum()
+    }
+    count(Tokenizer::new(src, logger))
+}
+
+pub fn check_coherency(ast: &mut AST, list: &mut NodePool, prelude: &Prelude, logger: LoggerRef) -> Ty {
+    Checker::try_resolve(ast, list, prelude, logger)
+}
+
+/// Compile a checked AST into a module image that the runtime can load
+/// directly. Returns None if the AST contains something that can't be
+/// compiled yet
+pub fn emit_bytecode(ast: &AST, list: &NodePool, prelude: &Prelude, logger: LoggerRef) -> Option<Vec<u8>> {
+    Emitter::emit_module(ast, list, prelude, logger)
 }
@@ -1,5 +1,5 @@
 
-use std::{sync::Arc, marker::PhantomData, cell::RefCell};
+use std::{sync::Arc, marker::PhantomData, cell::{Cell, RefCell}};
 use crate::{
     shared::{src::{Src, ArcSpan}, logger::LoggerRef},
     checker::{resolve::{ResolveRef, ResolveNode}, coherency::Checker, ty::Ty}
@@ -18,10 +18,10 @@ pub fn calculate_span<S: IntoIterator<Item = Option<ArcSpan>>>(spans: S) -> Opti
             span.1.end = range.end;
         }
     }
-    Some(span.clone())
+    Some(span)
 }
 
-pub trait CompileMessage: 'static {
+pub trait CompileMessage: 'static + Send {
     fn get_msg() -> &'static str;
 }
 
@@ -46,17 +46,21 @@ pub struct FatalParseError;
 // are considered its children
 
 /// A Node that is allocated on the NodePool
-pub trait Node: AsAny {
-    /// Get the children of this Node
-    fn children(&self) -> Vec<&dyn ResolveRef>;
+/// 
+/// Nodes must be `Send`, since each source file's nodes are parsed and checked 
+/// on their own thread
+pub trait Node: AsAny + Send {
+    /// Call `f` with each of the children of this Node, in order. Spans are 
+    /// computed by walking the tree, so this doesn't allocate
+    fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef));
 
     /// Get the span of this Node
     fn span(&self, pool: &NodePool) -> Option<ArcSpan> {
-        calculate_span(
-            self.children().into_iter()
-                .flat_map(|c| c.ids())
-                .map(|id| pool.get(id).span(pool))
-        )
+        let mut span = None;
+        self.for_each_child(&mut |child| child.for_each_id(&mut |id| {
+            span = calculate_span([span.take(), pool.span(id)]);
+        }));
+        span
     }
 
     fn span_or_builtin(&self, pool: &NodePool) -> ArcSpan {
@@ -77,9 +81,9 @@ pub trait ParseNode: Node + Sized {
 }
 
 /// Reference(s) to a Node in the pool
-pub trait Ref: 'static {
-    /// Get the ID(s) of the nodes that this Ref is referencing
-    fn ids(&self) -> Vec<NodeID>;
+pub trait Ref: 'static + Send {
+    /// Call `f` with the ID(s) of the nodes that this Ref is referencing
+    fn for_each_id(&self, f: &mut dyn FnMut(NodeID));
 }
 
 pub trait ParseRef: Ref + Sized {
@@ -140,10 +144,11 @@ impl<F> ParseNodeFn for F
 macro_rules! impl_tuple_parse {
     ($a: ident; $($r: ident);*) => {
         impl<$a: Ref, $($r: Ref),*> Ref for ($a, $($r),*) {
-            fn ids(&self) -> Vec<NodeID> {
+            fn for_each_id(&self, f: &mut dyn FnMut(NodeID)) {
                 #[allow(unused_parens, non_snake_case)]
                 let ($a $(, $r)*) = &self;
-                $a.ids().into_iter() $(.chain($r.ids()))* .collect()
+                $a.for_each_id(f);
+                $($r.for_each_id(f);)*
             }
         }
 
@@ -201,8 +206,8 @@ impl_tuple_parse!(A; B; C; D);
 impl_tuple_parse!(A; B; C; D; E);
 
 // impl<T: Node> Node for Box<T> {
-//     fn children(&self) -> Vec<NodeID> {
-//         self.as_ref().children()
+//     fn for_each_child(&self, f: &mut dyn FnMut(&dyn ResolveRef)) {
+//         self.as_ref().for_each_child(f)
 //     }
 // }
 
@@ -216,8 +221,10 @@ impl_tuple_parse!(A; B; C; D; E);
 // }
 
 impl<T: Ref> Ref for Option<T> {
-    fn ids(&self) -> Vec<NodeID> {
-        self.as_ref().map(|s| s.ids()).unwrap_or_default()
+    fn for_each_id(&self, f: &mut dyn FnMut(NodeID)) {
+        if let Some(s) = self {
+            s.for_each_id(f);
+        }
     }
 }
 
@@ -242,8 +249,10 @@ impl<T: ResolveRef> ResolveRef for Option<T> {
 }
 
 impl<T: Ref> Ref for Vec<T> {
-    fn ids(&self) -> Vec<NodeID> {
-        self.iter().flat_map(|n| n.ids()).collect()
+    fn for_each_id(&self, f: &mut dyn FnMut(NodeID)) {
+        for n in self {
+            n.for_each_id(f);
+        }
     }
 }
 
@@ -291,8 +300,8 @@ impl<T: Ref, S: Ref> Separated<T, S> {
 }
 
 impl<T: Ref, S: Ref> Ref for Separated<T, S> {
-    fn ids(&self) -> Vec<NodeID> {
-        self.items.ids()
+    fn for_each_id(&self, f: &mut dyn FnMut(NodeID)) {
+        self.items.for_each_id(f);
     }
 }
 
@@ -332,16 +341,19 @@ impl<T: Ref, S: Ref> SeparatedWithTrailing<T, S> {
 }
 
 impl<T: Ref, S: Ref> Ref for SeparatedWithTrailing<T, S> {
-    fn ids(&self) -> Vec<NodeID> {
-        self.items.ids().into_iter()
-            .chain(self.trailing.as_ref().map(|c| c.ids()).unwrap_or_default())
-            .collect()
+    fn for_each_id(&self, f: &mut dyn FnMut(NodeID)) {
+        self.items.for_each_id(f);
+        self.trailing.for_each_id(f);
     }
 }
 
 impl<T: ParseRef, S: ParseRef> ParseRef for SeparatedWithTrailing<T, S> {
     fn parse_ref(pool: &mut NodePool, src: Arc<Src>, tokenizer: &mut TokenIterator) -> Result<Self, FatalParseError> {
-        let mut items = Vec::from([T::parse_ref(pool, src.clone(), tokenizer)?]);
+        // Empty lists are allowed, like the parameters of `fun f()`
+        let Some(first) = T::peek_and_parse(pool, src.clone(), tokenizer)? else {
+            return Ok(Self { items: Vec::new(), trailing: None, _phantom: PhantomData });
+        };
+        let mut items = Vec::from([first]);
         let mut trailing = None;
         while let Some(sep) = S::peek_and_parse(pool, src.clone(), tokenizer)? {
             if let Some(item) = T::peek_and_parse(pool, src.clone(), tokenizer)? {
@@ -369,9 +381,7 @@ impl<T: ResolveRef + ParseRef, S: Ref> ResolveRef for SeparatedWithTrailing<T, S
 pub struct DontExpect<T: Ref, M: CompileMessage>(PhantomData<(T, M)>);
 
 impl<T: Ref, M: CompileMessage> Ref for DontExpect<T, M> {
-    fn ids(&self) -> Vec<NodeID> {
-        Default::default()
-    }
+    fn for_each_id(&self, _: &mut dyn FnMut(NodeID)) {}
 }
 
 impl<T: ParseRef, M: CompileMessage> ParseRef for DontExpect<T, M> {
@@ -399,26 +409,47 @@ pub trait IsToken {
 impl<T: IsToken> IsToken for Option<T> {}
 impl<T: IsToken + ResolveNode> IsToken for RefToNode<T> {}
 
-/// An unique ID for a node in the NodePool
-#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
-pub struct NodeID(usize);
+/// An unique ID for a node in the NodePool. Nodes are grouped into segments
+/// (one for each source file), so pools built on different threads can be
+/// joined without renumbering any IDs. IDs are ordered by segment and then 
+/// by the order the nodes were parsed in
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub struct NodeID {
+    segment: u32,
+    index: u32,
+}
 
-struct NodeData {
-    /// The allocated node
-    node: Box<dyn ResolveNode>,
-    /// The type this Node resolved into
-    ty: Option<Ty>,
+impl NodeID {
+    /// The segment of the pool this node was allocated in
+    pub fn segment(&self) -> usize {
+        self.segment as usize
+    }
+}
+
+/// The nodes of one source file. The state the checker keeps for each node 
+/// is stored in separate arrays indexed by the same `NodeID::index`, so 
+/// checking whether nodes have been resolved doesn't have to touch the nodes 
+/// themselves
+#[derive(Default)]
+struct Segment {
+    /// The allocated nodes
+    nodes: Vec<RefCell<Box<dyn ResolveNode>>>,
+    /// The types the nodes resolved into
+    tys: Vec<RefCell<Option<Ty>>>,
     /// Whether the last call to `try_resolve_node` returned Some or None
-    previous_resolve_state: bool,
+    resolve_states: Vec<Cell<bool>>,
 }
 
-impl NodeData {
-    fn new<T: ResolveNode>(node: T) -> Self {
-        Self {
-            node: Box::from(node),
-            ty: None,
-            previous_resolve_state: false,
-        }
+impl Segment {
+    fn is_empty(&self) -> bool {
+        self.nodes.is_empty()
+    }
+    fn push<T: ResolveNode>(&mut self, node: T) -> u32 {
+        let index = self.nodes.len() as u32;
+        self.nodes.push(RefCell::new(Box::new(node)));
+        self.tys.push(RefCell::new(None));
+        self.resolve_states.push(Cell::new(false));
+        index
     }
 }
 
@@ -426,57 +457,133 @@ impl NodeData {
 /// codebase in compilation, and all of that codebase's source files should 
 /// share the same pool - this way we can conserve memory and do some funky 
 /// optimizations later on (such as interning)
-#[derive(Default)]
+/// 
+/// The pool is split into segments, one for each source file. A pool may 
+/// only hold a contiguous range of segments, which lets files be parsed and 
+/// checked on separate threads with their own pools that are then joined
 pub struct NodePool {
-    nodes: Vec<RefCell<NodeData>>,
+    /// The segment number of `segments[0]`
+    first: u32,
+    segments: Vec<Segment>,
+}
+
+impl Default for NodePool {
+    fn default() -> Self {
+        Self::new()
+    }
 }
 
 #[allow(unused)]
 impl NodePool {
     /// Create a new empty pool
     pub fn new() -> Self {
-        Self { nodes: vec![] }
+        Self::new_segment(0)
+    }
+    /// Create a new empty pool whose nodes are allocated in `segment`
+    pub fn new_segment(segment: usize) -> Self {
+        Self { first: segment as u32, segments: vec![Segment::default()] }
+    }
+    /// Join pools holding consecutive segments into one pool. The pools must 
+    /// be given in order of their segments
+    pub fn join<I: IntoIterator<Item = NodePool>>(pools: I) -> Self {
+        let mut pools = pools.into_iter();
+        let Some(mut res) = pools.next() else {
+            return Self::new();
+        };
+        for pool in pools {
+            assert_eq!(
+                pool.first as usize, res.first as usize + res.segments.len(),
+                "Joined pools must hold consecutive segments"
+            );
+            res.segments.extend(pool.segments);
+        }
+        res
+    }
+    /// Split this pool into one pool for each of its segments
+    pub fn split(self) -> Vec<NodePool> {
+        let first = self.first;
+        self.segments.into_iter()
+            .enumerate()
+            .map(|(i, nodes)| Self { first: first + i as u32, segments: vec![nodes] })
+            .collect()
     }
-    /// Add a new Node to this pool. Returns the added node's ID
+    /// Whether this pool has no nodes in any of its segments
+    pub fn is_empty(&self) -> bool {
+        self.segments.iter().all(Segment::is_empty)
+    }
+    /// Add a new Node to this pool. Returns the added node's ID. Nodes are 
+    /// always allocated in the pool's last segment
     pub fn add<N: ResolveNode>(&mut self, t: N) -> NodeID {
-        let id = NodeID(self.nodes.len());
-        self.nodes.push(RefCell::from(NodeData::new(t)));
-        id
+        let segment = self.first + self.segments.len() as u32 - 1;
+        let index = self.segments.last_mut().unwrap().push(t);
+        NodeID { segment, index }
+    }
+    fn segment(&self, id: NodeID) -> &Segment {
+        &self.segments[(id.segment - self.first) as usize]
+    }
+    fn cell(&self, id: NodeID) -> &RefCell<Box<dyn ResolveNode>> {
+        &self.segment(id).nodes[id.index as usize]
+    }
+    fn ty_cell(&self, id: NodeID) -> &RefCell<Option<Ty>> {
+        &self.segment(id).tys[id.index as usize]
     }
     fn get(&self, id: NodeID) -> std::cell::Ref<'_, dyn ResolveNode> {
         std::cell::Ref::map(
-            self.nodes.get(id.0).unwrap().borrow(),
-            |e| e.node.as_ref()
+            self.cell(id).borrow(),
+            |e| e.as_ref()
         )
     }
     fn get_as<T: Node>(&self, id: NodeID) -> std::cell::Ref<'_, T> {
         std::cell::Ref::map(
-            self.nodes.get(id.0).unwrap().borrow(),
-            |e| e.node.as_ref().as_any().downcast_ref().unwrap()
+            self.cell(id).borrow(),
+            |e| e.as_ref().as_any().downcast_ref().unwrap()
         )
     }
-    fn get_data(&self, id: NodeID) -> std::cell::Ref<'_, NodeData> {
-        self.nodes.get(id.0).unwrap().borrow()
-    }
     fn get_mut(&self, id: NodeID) -> std::cell::RefMut<'_, dyn ResolveNode> {
         std::cell::RefMut::map(
-            self.nodes.get(id.0).unwrap().borrow_mut(),
-            |e| e.node.as_mut()
+            self.cell(id).borrow_mut(),
+            |e| e.as_mut()
         )
     }
     fn get_as_mut<T: ResolveNode>(&self, id: NodeID) -> std::cell::RefMut<'_, T> {
         std::cell::RefMut::map(
-            self.nodes.get(id.0).unwrap().borrow_mut(),
-            |e| e.node.as_mut().as_any_mut().downcast_mut().unwrap()
+            self.cell(id).borrow_mut(),
+            |e| e.as_mut().as_any_mut().downcast_mut().unwrap()
         )
     }
-    fn get_data_mut(&self, id: NodeID) -> std::cell::RefMut<'_, NodeData> {
-        self.nodes.get(id.0).unwrap().borrow_mut()
+    /// Get the type a node resolved into, if it has been resolved
+    fn resolved_ty(&self, id: NodeID) -> Option<Ty> {
+        self.ty_cell(id).borrow().clone()
+    }
+    /// Try to resolve a node, or return its type if it has already been 
+    /// resolved
+    pub fn try_resolve(&self, id: NodeID, checker: &mut Checker) -> Option<Ty> {
+        if let Some(ty) = self.resolved_ty(id) {
+            return Some(ty);
+        }
+        if !checker.enter_node(id, self) {
+            return None;
+        }
+        let ty = self.get_mut(id).try_resolve_node(self, checker);
+        checker.leave_node(id, ty.is_some());
+        *self.ty_cell(id).borrow_mut() = ty.clone();
+        self.segment(id).resolve_states[id.index as usize].set(ty.is_some());
+        ty
+    }
+    /// Get the span of a node
+    pub fn span(&self, id: NodeID) -> Option<ArcSpan> {
+        self.get(id).span(self)
+    }
+    /// Whether a node has been resolved
+    pub fn is_resolved(&self, id: NodeID) -> bool {
+        self.ty_cell(id).borrow().is_some()
     }
     pub fn release_unresolved(&self, checker: &Checker, logger: LoggerRef) {
-        for node in &self.nodes {
-            if !node.borrow().previous_resolve_state {
-                node.borrow().node.log_unresolved_reason(self, checker, logger.clone());
+        for segment in &self.segments {
+            for (node, resolved) in segment.nodes.iter().zip(&segment.resolve_states) {
+                if !resolved.get() {
+                    node.borrow().log_unresolved_reason(self, checker, logger.clone());
+                }
             }
         }
     }
@@ -494,11 +601,14 @@ impl<T: ResolveNode> RefToNode<T> {
     pub fn new(pool: &mut NodePool, item: T) -> Self {
         Self(pool.add(item), PhantomData)
     }
+    pub fn id(&self) -> NodeID {
+        self.0
+    }
     pub fn get<'a>(&self, pool: &'a NodePool) -> std::cell::Ref<'a, T> {
         pool.get_as(self.0)
     }
     pub fn resolved_ty(&self, pool: &NodePool) -> Option<Ty> {
-        pool.get_data(self.0).ty.clone()
+        pool.resolved_ty(self.0)
     }
 }
 
@@ -517,8 +627,8 @@ impl<T: ResolveNode> PartialEq for RefToNode<T> {
 impl<T: ResolveNode> Eq for RefToNode<T> {}
 
 impl<T: ResolveNode> Ref for RefToNode<T> {
-    fn ids(&self) -> Vec<NodeID> {
-        vec![self.0]
+    fn for_each_id(&self, f: &mut dyn FnMut(NodeID)) {
+        f(self.0);
     }
 }
 
@@ -533,18 +643,6 @@ impl<T: ResolveNode + ParseNode> ParseRef for RefToNode<T> {
 
 impl<T: ResolveNode> ResolveRef for RefToNode<T> {
     fn try_resolve_ref(&self, pool: &NodePool, checker: &mut Checker) -> Option<Ty> {
-        let result = (|| {
-            if let Some(ty) = pool.get_data(self.0).ty.clone() {
-                return Some(ty);
-            }
-            let ty = pool.get_as_mut::<T>(self.0).try_resolve_node(pool, checker)?;
-            pool.get_data_mut(self.0).ty = Some(ty.clone());
-            Some(ty)
-        })();
-        if pool.get_data(self.0).previous_resolve_state != result.is_some() {
-            checker.mark_some_nodes_resolve_state_changed();
-        }
-        pool.get_data_mut(self.0).previous_resolve_state = result.is_some();
-        result
+        pool.try_resolve(self.0, checker)
     }
 }
@@ -13,14 +13,14 @@ pub(crate) const STRICT_KEYWORDS: &[&str] = &[
     // Constants & special variables
     "this", "super",
     // Declarations
-    "var", "let", "fun", "struct", "enum", "using",
+    "var", "let", "fun", "async", "struct", "enum", "using",
     "macro", "extends", "module", "type",
     // Prepositions
     "in", "is", "as", "where", "from",
     // Loops & conditionals
     "if", "else", "for", "while",
     // Control flow
-    "try", "return", "break", "continue",
+    "try", "return", "yield", "break", "continue",
     // Visibility
     "extern", "public", "private",
     // Types
@@ -32,7 +32,7 @@ pub(crate) const RESERVED_KEYWORDS: &[&str] = &[
     // Declarations
     "trait", "class", "interface",
     // Control flow
-    "unwrap", "yield", "match", "switch",
+    "unwrap", "match", "switch",
     // Visibility
     "export", "import",
     // Reactivity
@@ -118,6 +118,9 @@ impl std::fmt::Debug for Token<'_> {
 pub struct Tokenizer<'s> {
     src: &'s Src,
     iter: CharIter<'s>,
+    /// Offset where tokenizing stops, which is the closing parenthesis for 
+    /// the contents of a token tree
+    end: usize,
     logger: LoggerRef,
 }
 
@@ -129,7 +132,12 @@ impl std::fmt::Debug for Tokenizer<'_> {
 
 impl<'s> Tokenizer<'s> {
     pub fn new(src: &'s Src, logger: LoggerRef) -> Self {
-        Self { src, iter: src.iter(), logger, }
+        Self { src, iter: src.iter(), end: src.data().len(), logger, }
+    }
+    /// Tokenize only `range` of the source. The iterator still runs over 
+    /// the rest of the source so offsets at the end of the range are right
+    fn new_range(src: &'s Src, range: Range<usize>, logger: LoggerRef) -> Self {
+        Self { src, iter: CharIter::new_at(src.data(), range.start), end: range.end, logger }
     }
     fn skip_ws(&mut self) {
         loop {
@@ -157,6 +165,67 @@ impl<'s> Tokenizer<'s> {
     fn offset(&self) -> usize {
         self.iter.offset() - 1
     }
+    /// Skip over the rest of a token tree whose opening parenthesis has
+    /// already been consumed, without making any tokens. Token boundaries 
+    /// are found exactly like `next` finds them, so comments, strings and 
+    /// operators that happen to contain parentheses or slashes are skipped 
+    /// the same way. Returns the offset of the closing parenthesis, or None 
+    /// if the tree is never closed
+    fn skip_tree(&mut self, opening: char) -> Option<usize> {
+        let mut closing = vec![closing_paren(opening)];
+        loop {
+            self.skip_ws();
+            let offset = self.offset();
+            let c = self.iter.next()?;
+            match c {
+                '(' | '[' | '{' => closing.push(closing_paren(c)),
+                ')' | ']' | '}' if closing.last() == Some(&c) => {
+                    closing.pop();
+                    if closing.is_empty() {
+                        return Some(offset);
+                    }
+                }
+                '"' => loop {
+                    match self.iter.next() {
+                        Some('"') | None => break,
+                        Some('\\') => { self.iter.next(); }
+                        Some(_) => {}
+                    }
+                }
+                c if c.is_xid_start() => {
+                    while self.iter.peek().is_some_and(|c| c.is_xid_continue()) {
+                        self.iter.next();
+                    }
+                }
+                c if c.is_ascii_digit() => {
+                    while self.iter.peek().is_some_and(|c| c.is_ascii_digit()) {
+                        self.iter.next();
+                    }
+                    if self.iter.peek() == Some('.') && self.iter.peek1().is_some_and(|c| c.is_ascii_digit()) {
+                        self.iter.next();
+                        while self.iter.peek().is_some_and(|c| c.is_ascii_digit()) {
+                            self.iter.next();
+                        }
+                    }
+                }
+                '.' | ':' => {
+                    while self.iter.peek() == Some(c) {
+                        self.iter.next();
+                    }
+                }
+                '-' | '=' if self.iter.peek() == Some('>') => {
+                    self.iter.next();
+                }
+                c if c.is_op_char() => {
+                    while self.iter.peek().is_some_and(|c| c.is_op_char()) {
+                        self.iter.next();
+                    }
+                }
+                // Everything else is a single character token
+                _ => {}
+            }
+        }
+    }
 }
 
 impl<'s> Iterator for Tokenizer<'s> {
@@ -224,6 +293,9 @@ impl<'s> Iterator for Tokenizer<'s> {
         // Skip whitespace & check for EOF
         self.skip_ws();
         self.iter.peek()?;
+        if self.offset() >= self.end {
+            return None;
+        }
 
         // Store first non-WS position for range of token
         let start = self.offset();
@@ -336,28 +408,19 @@ impl<'s> Iterator for Tokenizer<'s> {
             return make_token!(TokenKind::Punct);
         }
 
-        // Parentheses
+        // Parentheses. The contents are only tokenized once the tree is 
+        // iterated, so the parser can consume them as they're produced
         let opening = self.iter.peek().unwrap();
         if parse!(next '(' | '[' | '{') {
-            let mut items = vec![];
-            'find_closing: loop {
-                // skip whitespace
-                self.skip_ws();
-                match self.iter.peek() {
-                    Some(c @ (')' | ']' | '}')) if c == closing_paren(opening) => {
-                        self.iter.next();
-                        break 'find_closing;
-                    },
-                    Some(_) => {}
-                    None => return make_token!(TokenKind::Error("unclosed parenthesis".to_string())),
-                }
-                items.push(self.next().unwrap());
-            }
+            let contents = self.offset();
+            let Some(closing) = self.skip_tree(opening) else {
+                return make_token!(TokenKind::Error("unclosed parenthesis".to_string()));
+            };
             let tree = TokenTree {
                 src: self.src,
-                items: items.into_iter(),
+                tokens: Tokenizer::new_range(self.src, contents..closing, self.logger.clone()),
                 start_offset: start,
-                eof: self.offset() - 1..self.offset(),
+                eof: closing..closing + 1,
                 logger: self.logger.clone(),
             };
             return make_token!(match opening {
@@ -375,7 +438,7 @@ impl<'s> Iterator for Tokenizer<'s> {
 
 pub struct TokenTree<'s> {
     src: &'s Src,
-    items: std::vec::IntoIter<Token<'s>>,
+    tokens: Tokenizer<'s>,
     start_offset: usize,
     eof: Range<usize>,
     logger: LoggerRef,
@@ -384,7 +447,7 @@ pub struct TokenTree<'s> {
 impl<'s> Iterator for TokenTree<'s> {
     type Item = Token<'s>;
     fn next(&mut self) -> Option<Self::Item> {
-        self.items.next()
+        self.tokens.next()
     }
 }
 
@@ -474,7 +537,7 @@ impl<'s> TokenIterator<'s> {
     pub(crate) fn empty_tree(&self) -> TokenTree<'s> {
         TokenTree {
             src: self.src,
-            items: vec![].into_iter(),
+            tokens: Tokenizer::new_range(self.src, 0..0, self.logger.clone()),
             start_offset: 0,
             eof: 0..0,
             logger: self.logger.clone()
@@ -0,0 +1,150 @@
+use std::{collections::HashMap, sync::OnceLock};
+use crate::{
+    checker::{path::{FullIdentPath, Ident}, pool::ASTPool, ty::Ty},
+    codegen::{bytecode::{Instr, Op}, image::{self, FunctionProto, ImageBuilder}},
+    parser::parse::NodePool,
+    shared::{logger::{LoggerRef, Logger}, src::{Src, SrcPool}},
+};
+
+// Every source file implicitly imports the standard library. Std is checked
+// once and compiled into a module image with a symbol table of everything
+// it exports, and files are checked against that symbol table instead of
+// the Std sources. The runtime ships the image precompiled, so usually the
+// Std sources aren't even checked once
+
+/// The parts of Std that the compiler can check so far. The rest of
+/// lang/Std relies on macros and extern structs
+pub const STD_SOURCES: &[(&str, &str)] = &[
+    ("Std/IO.dash", include_str!("../../lang/Std/IO.dash")),
+    ("Std/Math.dash", include_str!("../../lang/Std/Math.dash")),
+    ("Std/Nodes.dash", include_str!("../../lang/Std/Nodes.dash")),
+];
+
+/// An item the prelude declares
+#[derive(Debug, Clone)]
+pub struct PreludeItem {
+    pub name: FullIdentPath,
+    pub ty: Ty,
+    /// Name of the native function that implements the item
+    pub native: String,
+}
+
+impl PreludeItem {
+    pub fn param_count(&self) -> u8 {
+        match &self.ty {
+            Ty::Function { params, ret_ty: _ } => params.len() as u8,
+            _ => 0,
+        }
+    }
+}
+
+/// The items every source file can use without declaring them
+#[derive(Debug, Default)]
+pub struct Prelude {
+    items: Vec<PreludeItem>,
+    by_name: HashMap<FullIdentPath, usize>,
+}
+
+static STD: OnceLock<Prelude> = OnceLock::new();
+
+impl Prelude {
+    /// A prelude that doesn't declare anything
+    pub fn empty() -> Self {
+        Self::default()
+    }
+
+    fn from_items(items: Vec<PreludeItem>) -> Self {
+        let by_name = items.iter().enumerate().map(|(i, item)| (item.name.clone(), i)).collect();
+        Self { items, by_name }
+    }
+
+    /// The standard library. Unless a precompiled image was provided with
+    /// `load_std` first, this checks the Std sources on first use
+    pub fn std() -> &'static Prelude {
+        STD.get_or_init(|| {
+            let logger = Logger::default();
+            let srcs = SrcPool::new_from_srcs(
+                STD_SOURCES.iter().map(|(name, data)| Src::from_memory(*name, data.to_string())).collect()
+            );
+            let std = Self::check(&srcs, logger.clone());
+            if logger.lock().unwrap().errors() > 0 {
+                crate::ice!("the standard library has errors");
+            }
+            std
+        })
+    }
+    /// Use a precompiled Std image as the standard library. This must happen
+    /// before anything is checked, and only once
+    pub fn load_std(image: &[u8]) -> Result<&'static Prelude, String> {
+        let std = Self::from_image(image)?;
+        STD.set(std).map_err(|_| "The standard library has already been loaded".to_string())?;
+        Ok(STD.get().unwrap())
+    }
+
+    /// Check the sources of a library and collect what it exports, which is
+    /// every public extern function at the top level of its files
+    pub fn check(srcs: &SrcPool, logger: LoggerRef) -> Self {
+        let mut pool = NodePool::new();
+        let mut asts = ASTPool::parse_src_pool(&mut pool, srcs, logger.clone());
+        asts.check_all(&mut pool, &Prelude::empty(), logger);
+
+        let mut items = Vec::new();
+        for ast in &asts {
+            for expr in ast.get(&pool).exprs() {
+                let Some(fun) = expr.get(&pool).as_extern_fun_decl(&pool) else { continue };
+                let (name, public) = fun.get(&pool).name(&pool);
+                let Some(ty) = fun.resolved_ty(&pool) else { continue };
+                if public && ty.signature().is_some() {
+                    items.push(PreludeItem { native: name.to_string(), name: name.to_full(), ty });
+                }
+            }
+        }
+        Self::from_items(items)
+    }
+
+    /// Read the symbol table of a compiled library
+    pub fn from_image(image: &[u8]) -> Result<Self, String> {
+        let items = image::read_exports(image)?
+            .into_iter()
+            .map(|export| {
+                let ty = Ty::from_signature(&export.signature)
+                    .ok_or_else(|| format!("Export {} has an invalid signature", export.name))?;
+                Ok(PreludeItem {
+                    name: FullIdentPath::new(export.name.split("::").map(Ident::from).collect::<Vec<_>>()),
+                    ty,
+                    native: export.native,
+                })
+            })
+            .collect::<Result<_, String>>()?;
+        Ok(Self::from_items(items))
+    }
+    /// Compile the prelude into a module image with its symbol table. Std
+    /// only declares natives so far, so the image has no code of its own
+    pub fn to_image(&self) -> Vec<u8> {
+        let mut builder = ImageBuilder::new();
+        let entry = builder.reserve_function("<module>").unwrap();
+        builder.define_function(entry, FunctionProto {
+            code: vec![Instr::abc(Op::ReturnVoid, 0, 0, 0)],
+            register_count: 0,
+            param_count: 0,
+            flags: 0,
+            spans: vec![],
+        });
+        for item in &self.items {
+            let native = builder.native(&item.native, item.param_count()).unwrap();
+            builder.export(&Self::export_name(&item.name), &item.ty.signature().unwrap(), native);
+        }
+        builder.write(entry, 0)
+    }
+    /// The name of an item in a symbol table, without the leading `::`
+    pub fn export_name(name: &FullIdentPath) -> String {
+        name.to_string().trim_start_matches("::").to_string()
+    }
+
+    pub fn items(&self) -> &[PreludeItem] {
+        &self.items
+    }
+    pub fn find(&self, name: &FullIdentPath) -> Option<&PreludeItem> {
+        self.by_name.get(name).map(|i| &self.items[*i])
+    }
+}
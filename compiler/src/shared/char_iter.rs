@@ -31,15 +31,18 @@ impl<I: Iterator, const SIZE: usize> Iterator for CachedLookahead<I, SIZE> {
 struct CharIndicesWithOffset<'s> {
     src: &'s str,
     iter: CharIndices<'s>,
+    /// Offset of `iter` in `src`
+    base: usize,
     offset: usize,
 }
 
 impl<'s> CharIndicesWithOffset<'s> {
-    pub fn new(src: &'s str) -> Self {
+    pub fn new(src: &'s str, start: usize) -> Self {
         Self {
             src,
-            iter: src.char_indices(),
-            offset: 0,
+            iter: src[start..].char_indices(),
+            base: start,
+            offset: start,
         }
     }
 }
@@ -51,7 +54,7 @@ impl<'s> Iterator for CharIndicesWithOffset<'s> {
             self.offset = self.src.len();
             return None;
         };
-        self.offset = i;
+        self.offset = self.base + i;
         Some(n)
     }
 }
@@ -60,7 +63,12 @@ pub struct CharIter<'s>(CachedLookahead<CharIndicesWithOffset<'s>, 2>);
 
 impl<'s> CharIter<'s> {
     pub fn new(src: &'s str) -> Self {
-        Self(CachedLookahead::new(CharIndicesWithOffset::new(src)))
+        Self::new_at(src, 0)
+    }
+    /// Iterate `src` starting from a byte offset. Offsets are still relative 
+    /// to the start of `src`
+    pub fn new_at(src: &'s str, start: usize) -> Self {
+        Self(CachedLookahead::new(CharIndicesWithOffset::new(src, start)))
     }
     pub fn offset(&self) -> usize {
         self.0.iter.offset
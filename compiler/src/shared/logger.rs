@@ -1,5 +1,5 @@
 
-use std::{sync::{Arc, Mutex}, fmt::{Display, Write}};
+use std::{sync::{Arc, Mutex}, fmt::{Display, Write}, ops::Range};
 use crate::shared::src::Span;
 use colored::Colorize;
 
@@ -112,6 +112,12 @@ impl<'s> Message<'s> {
         self.notes.push(note);
         self
     }
+    pub fn level(&self) -> Level {
+        self.level
+    }
+    pub fn span(&self) -> &Span<'s> {
+        &self.span
+    }
 }
 
 impl Display for Message<'_> {
@@ -142,8 +148,29 @@ impl Display for Message<'_> {
     }
 }
 
+/// A message rendered the way the compiler prints it. Diagnostics don't 
+/// borrow the sources they're about, so they can be kept around and passed 
+/// between threads
+#[derive(Debug, Clone)]
+pub struct Diagnostic {
+    pub level: Level,
+    /// The byte range in the file the message is about
+    pub range: Range<usize>,
+    /// The message rendered like the compiler prints it
+    pub text: String,
+}
+
+impl From<&Message<'_>> for Diagnostic {
+    fn from(msg: &Message<'_>) -> Self {
+        Self { level: msg.level, range: msg.span.1.clone(), text: msg.to_string() }
+    }
+}
+
 pub struct Logger {
-    logger: Box<dyn FnMut(Message)>,
+    /// Where messages go as soon as they're logged. Buffered loggers don't 
+    /// have one and keep their messages in `buffer` instead
+    sink: Option<Box<dyn FnMut(Diagnostic) + Send>>,
+    buffer: Vec<Diagnostic>,
     error_count: usize,
     warn_count: usize,
 }
@@ -155,9 +182,21 @@ impl std::fmt::Debug for Logger {
 }
 
 impl Logger {
-    pub fn new<F: FnMut(Message) + 'static>(logger: F) -> LoggerRef {
+    pub fn new<F: FnMut(Diagnostic) + Send + 'static>(logger: F) -> LoggerRef {
+        Self::with_sink(Some(Box::from(logger)))
+    }
+    /// Create a logger that keeps every message until they're taken with 
+    /// `take`. Work on each source file logs into its own buffered logger, 
+    /// so threads working on different files never wait for each other, 
+    /// and their messages are `merge`d into the shared logger in a fixed 
+    /// order once all of them are done
+    pub fn buffered() -> LoggerRef {
+        Self::with_sink(None)
+    }
+    fn with_sink(sink: Option<Box<dyn FnMut(Diagnostic) + Send>>) -> LoggerRef {
         Arc::from(Mutex::from(Self {
-            logger: Box::from(logger),
+            sink,
+            buffer: vec![],
             error_count: 0,
             warn_count: 0,
         }))
@@ -167,12 +206,32 @@ impl Logger {
         Self::new(default_console_logger)
     }
     pub fn log(&mut self, msg: Message) {
-        match msg.level {
+        self.emit(Diagnostic::from(&msg));
+    }
+    fn emit(&mut self, diagnostic: Diagnostic) {
+        match diagnostic.level {
             Level::Info => {}
             Level::Warning => self.warn_count += 1,
             Level::Error => self.error_count += 1,
         }
-        (self.logger)(msg);
+        match self.sink {
+            Some(ref mut sink) => sink(diagnostic),
+            None => self.buffer.push(diagnostic),
+        }
+    }
+    /// Take the messages a buffered logger has collected
+    pub fn take(&mut self) -> Vec<Diagnostic> {
+        std::mem::take(&mut self.buffer)
+    }
+    /// Log the messages of several files. Files are logged in order, and 
+    /// each file's messages are sorted by where they are in the file
+    pub fn merge<I: IntoIterator<Item = Vec<Diagnostic>>>(&mut self, files: I) {
+        for mut diagnostics in files {
+            diagnostics.sort_by_key(|d| d.range.start);
+            for diagnostic in diagnostics {
+                self.emit(diagnostic);
+            }
+        }
     }
     pub fn errors(&self) -> usize {
         self.error_count
@@ -184,6 +243,6 @@ impl Logger {
 
 pub(crate) type LoggerRef = Arc<Mutex<Logger>>;
 
-pub fn default_console_logger(msg: Message) {
-    println!("{msg}");
+pub fn default_console_logger(diagnostic: Diagnostic) {
+    println!("{}", diagnostic.text);
 }
@@ -1,4 +1,5 @@
 
 pub(crate) mod char_iter;
 pub mod logger;
+pub(crate) mod parallel;
 pub mod src;
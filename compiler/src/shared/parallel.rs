@@ -0,0 +1,45 @@
+use std::{
+    sync::{Mutex, atomic::{AtomicUsize, Ordering}},
+    thread,
+};
+
+/// Run `f` on every item on as many threads as there are cores, returning 
+/// the results in the same order as the items. Small inputs are run on the 
+/// calling thread, since spawning threads would cost more than it saves
+pub fn map<T, R, F>(items: Vec<T>, f: F) -> Vec<R>
+    where T: Send, R: Send, F: Fn(T) -> R + Sync
+{
+    let threads = thread::available_parallelism()
+        .map(|n| n.get())
+        .unwrap_or(1)
+        .min(items.len());
+    if threads <= 1 {
+        return items.into_iter().map(f).collect();
+    }
+
+    // Items are handed out one at a time, so threads that get small files 
+    // pick up the remaining work instead of idling
+    let count = items.len();
+    let items = items.into_iter().map(|i| Mutex::new(Some(i))).collect::<Vec<_>>();
+    let next = AtomicUsize::new(0);
+    let mut results = thread::scope(|scope| {
+        let workers = (0..threads)
+            .map(|_| scope.spawn(|| {
+                let mut results = vec![];
+                loop {
+                    let i = next.fetch_add(1, Ordering::Relaxed);
+                    let Some(item) = items.get(i) else { break };
+                    let item = item.lock().unwrap().take().unwrap();
+                    results.push((i, f(item)));
+                }
+                results
+            }))
+            .collect::<Vec<_>>();
+        workers.into_iter()
+            .flat_map(|w| w.join().unwrap_or_else(|e| std::panic::resume_unwind(e)))
+            .collect::<Vec<_>>()
+    });
+    debug_assert_eq!(results.len(), count);
+    results.sort_unstable_by_key(|(i, _)| *i);
+    results.into_iter().map(|(_, r)| r).collect()
+}
@@ -1,7 +1,7 @@
 
 use std::{
     path::PathBuf,
-    sync::Arc,
+    sync::{Arc, OnceLock},
     fs,
     fmt::{Debug, Display},
     ops::Range,
@@ -9,7 +9,6 @@ use std::{
     cmp::max,
     hash::Hash
 };
-use line_col::LineColLookup;
 use colored::{Color, Colorize};
 
 use crate::shared::char_iter::CharIter;
@@ -47,13 +46,10 @@ impl<'s> Span<'s> {
     pub fn underlined(&self, style: Underline) -> String {
         // Get the starting and ending linecols as 0-based indices
         let sub_tuple = |a: (usize, usize)| { (a.0 - 1, a.1 - 1) };
-        let lookup = LineColLookup::new(self.0.data());
-        let start = sub_tuple(lookup.get(self.1.start));
-        let end = sub_tuple(lookup.get(self.1.end));
+        let start = sub_tuple(self.0.line_col(self.1.start));
+        let end = sub_tuple(self.0.line_col(self.1.end));
 
-        let mut lines = self.0
-            .data().lines()
-            .skip(start.0).take(end.0 - start.0 + 1);
+        let mut lines = (start.0..=end.0).map(|line| self.0.line(line));
 
         let padding = (end.0 + 1).to_string().len();
         let output_line = |line: usize, content, range| {
@@ -99,13 +95,12 @@ impl<'s> Clone for Span<'s> {
 
 impl Display for Span<'_> {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        let lookup = LineColLookup::new(self.0.data());
-        let start = lookup.get(self.1.start);
+        let start = self.0.line_col(self.1.start);
         if self.1.is_empty() {
             write!(f, "{}:{}:{}", self.0.name(), start.0, start.1)
         }
         else {
-            let end = lookup.get(self.1.end);
+            let end = self.0.line_col(self.1.end);
             write!(f, "{}:{}:{}-{}:{}", self.0.name(), start.0, start.1, end.0, end.1)
         }
     }
@@ -138,7 +133,12 @@ pub enum Src {
     Builtin,
     File {
         path: PathBuf,
-        data: String,
+        /// The contents of the file, or why it couldn't be read. Read the 
+        /// first time they're needed
+        data: OnceLock<Result<String, String>>,
+        /// Byte offset of the start of each line, built the first time a 
+        /// location in the file is looked up
+        lines: OnceLock<Vec<usize>>,
     }
 }
 
@@ -148,34 +148,85 @@ impl Src {
     }
 
     pub fn from_file<P: Into<PathBuf>>(path: P) -> Result<Arc<Self>, String> {
-        let path = path.into();
-        Ok(Arc::from(Src::File {
-            data: fs::read_to_string(&path).map_err(|e| format!("Can't read file: {}", e))?,
-            path,
-        }))
+        let src = Self::lazy(path);
+        src.load()?;
+        Ok(src)
+    }
+    /// Create a source whose file is only read once its contents are 
+    /// needed, for example by the thread that parses it
+    pub fn lazy<P: Into<PathBuf>>(path: P) -> Arc<Self> {
+        Arc::from(Src::File { path: path.into(), data: OnceLock::new(), lines: OnceLock::new() })
+    }
+    /// Create a source from text that has already been read into memory
+    pub fn from_memory<P: Into<PathBuf>>(path: P, data: String) -> Arc<Self> {
+        Arc::from(Src::File { path: path.into(), data: OnceLock::from(Ok(data)), lines: OnceLock::new() })
+    }
+    /// Read the source's file if it hasn't been read yet
+    pub fn load(&self) -> Result<(), String> {
+        match self {
+            Src::Builtin => Ok(()),
+            Src::File { path, data, .. } => data
+                .get_or_init(|| fs::read_to_string(path).map_err(|e| format!("Can't read file: {}", e)))
+                .as_ref()
+                .map(|_| ())
+                .map_err(Clone::clone),
+        }
     }
     pub fn name(&self) -> String {
         match self {
             Src::Builtin => String::from("<compiler built-in>"),
-            Src::File { path, data: _ } => path.to_string_lossy().to_string(),
+            Src::File { path, .. } => path.to_string_lossy().to_string(),
         }
     }
+    /// The source's contents. Files that can't be read are empty; `load` 
+    /// tells why
     pub fn data(&self) -> &str {
+        let _ = self.load();
         match self {
             Src::Builtin => "",
-            Src::File { path: _, data } => data.as_str(),
+            Src::File { data, .. } => data.get().and_then(|d| d.as_deref().ok()).unwrap_or(""),
         }
     }
     pub fn iter(&self) -> CharIter {
         CharIter::new(self.data())
     }
+    fn line_starts(&self) -> &[usize] {
+        match self {
+            Src::Builtin => &[0],
+            Src::File { lines, .. } => lines.get_or_init(|| {
+                std::iter::once(0)
+                    .chain(self.data().match_indices('\n').map(|(i, _)| i + 1))
+                    .collect()
+            }),
+        }
+    }
+    /// Get the 1-based line and column of a byte offset. Columns are 
+    /// counted in characters
+    pub fn line_col(&self, offset: usize) -> (usize, usize) {
+        let data = self.data();
+        let offset = offset.min(data.len());
+        let starts = self.line_starts();
+        let line = starts.partition_point(|&s| s <= offset) - 1;
+        let column = data.get(starts[line]..offset)
+            .map(|s| s.chars().count())
+            .unwrap_or(offset - starts[line]);
+        (line + 1, column + 1)
+    }
+    /// Get the contents of a 0-based line without its line ending
+    pub fn line(&self, line: usize) -> &str {
+        let data = self.data();
+        let starts = self.line_starts();
+        let Some(&start) = starts.get(line) else { return "" };
+        let end = starts.get(line + 1).map(|&s| s - 1).unwrap_or(data.len());
+        data[start..end].strip_suffix('\r').unwrap_or(&data[start..end])
+    }
 }
 
 impl Debug for Src {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
         match self {
             Self::Builtin => f.write_str("Builtin"),
-            Self::File { path, data: _ } => f.write_fmt(format_args!("File({path:?})")),
+            Self::File { path, .. } => f.write_fmt(format_args!("File({path:?})")),
         }
     }
 }
@@ -190,7 +241,7 @@ impl PartialEq for Src {
     fn eq(&self, other: &Self) -> bool {
         match (self, other) {
             (Src::Builtin, Src::Builtin) => true,
-            (Src::File { path: a, data: _ }, Self::File { path: b, data: _ }) => a == b,
+            (Src::File { path: a, .. }, Self::File { path: b, .. }) => a == b,
             (_, _) => false
         }
     }
@@ -202,7 +253,7 @@ impl Hash for Src {
     fn hash<H: std::hash::Hasher>(&self, state: &mut H) {
         match self {
             Src::Builtin => 0.hash(state),
-            Src::File { path, data: _ } => path.hash(state),
+            Src::File { path, .. } => path.hash(state),
         }
     }
 }
@@ -218,9 +269,17 @@ impl SrcPool {
             srcs: files.into_iter().map(Src::from_file).collect::<Result<_, _>>()?
         })
     }
+    /// Create a pool of sources that are only read when they're parsed, so 
+    /// reading files is spread over the threads that parse them
+    pub fn new_lazy(files: Vec<PathBuf>) -> Self {
+        Self { srcs: files.into_iter().map(Src::lazy).collect() }
+    }
+    pub fn new_from_srcs(srcs: Vec<Arc<Src>>) -> Self {
+        Self { srcs }
+    }
     pub fn new_from_dir(dir: PathBuf) -> Result<Self, String> {
         if dir.is_file() {
-            return Self::new(vec![dir]);
+            return Ok(Self::new_lazy(vec![dir]));
         }
         if !dir.exists() {
             Err("Directory does not exist".to_string())?;
@@ -230,10 +289,11 @@ impl SrcPool {
             Err("Directory is empty".to_string())
         }
         else {
-            Self::new(srcs)
+            Ok(Self::new_lazy(srcs))
         }
     }
-    fn find_src_files(dir: PathBuf) -> Vec<PathBuf> {
+    /// Find every Dash source file in a directory and its subdirectories
+    pub fn find_src_files(dir: PathBuf) -> Vec<PathBuf> {
         let mut res = vec![];
         if let Ok(entries) = std::fs::read_dir(dir) { 
             for entry in entries {
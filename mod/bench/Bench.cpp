@@ -0,0 +1,138 @@
+#include "Bench.hpp"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <fstream>
+#include <unordered_map>
+
+#ifdef _WIN32
+    #define popen _popen
+    #define pclose _pclose
+    #define NULL_DEVICE "nul"
+#else
+    #define NULL_DEVICE "/dev/null"
+#endif
+
+using namespace dash::bench;
+
+static std::string formatNs(double ns) {
+    if (ns < 1e3) return fmt::format("{:.1f} ns", ns);
+    if (ns < 1e6) return fmt::format("{:.2f} µs", ns / 1e3);
+    if (ns < 1e9) return fmt::format("{:.2f} ms", ns / 1e6);
+    return fmt::format("{:.2f} s", ns / 1e9);
+}
+
+/// The commit the benchmarks were built from. `DASH_BENCH_LABEL` can be set
+/// to tell apart runs of uncommitted changes
+static std::string currentCommit() {
+    if (auto label = std::getenv("DASH_BENCH_LABEL")) {
+        return label;
+    }
+    std::string commit;
+    if (auto git = popen("git rev-parse --short HEAD 2>" NULL_DEVICE, "r")) {
+        char buf[64];
+        while (std::fgets(buf, sizeof(buf), git)) {
+            commit += buf;
+        }
+        if (pclose(git) != 0) {
+            commit.clear();
+        }
+    }
+    while (!commit.empty() && std::isspace(static_cast<unsigned char>(commit.back()))) {
+        commit.pop_back();
+    }
+    return commit.empty() ? "unknown" : commit;
+}
+
+/// Find the value of a field in a line of the history file. The file is
+/// only ever written by the benchmark runners, so the lines don't need to
+/// be fully parsed
+static std::optional<std::string_view> field(std::string_view line, std::string_view name) {
+    auto key = fmt::format("\"{}\":", name);
+    auto pos = line.find(key);
+    if (pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+    auto value = line.substr(pos + key.size());
+    if (value.starts_with('"')) {
+        auto end = value.find('"', 1);
+        return end == std::string_view::npos ? std::nullopt : std::optional(value.substr(1, end - 1));
+    }
+    return value.substr(0, value.find_first_of(",}"));
+}
+
+Bench::Bench(int argc, char** argv) {
+    for (int i = 1; i < argc; i += 1) {
+        std::string_view arg = argv[i];
+        if (arg == "--history" && i + 1 < argc) {
+            m_history = argv[++i];
+        }
+        else if (arg == "--threshold" && i + 1 < argc) {
+            m_threshold = std::atof(argv[++i]);
+        }
+        else {
+            m_filter = arg;
+        }
+    }
+}
+
+bool Bench::skips(std::string_view name) const {
+    return m_filter && name.find(*m_filter) == std::string_view::npos;
+}
+
+void Bench::record(std::string_view name, std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    auto ns = samples[samples.size() / 2];
+    fmt::print("{:<40} {:>14}\n", name, formatNs(ns));
+    std::fflush(stdout);
+    m_results.push_back(Result { std::string(name), ns });
+}
+
+int Bench::finish() {
+    if (!m_history) {
+        return 0;
+    }
+    auto commit = currentCommit();
+
+    std::unordered_map<std::string, std::pair<std::string, double>> baseline;
+    std::ifstream previous(*m_history);
+    for (std::string line; std::getline(previous, line);) {
+        auto name = field(line, "name");
+        auto ns = field(line, "ns");
+        auto from = field(line, "commit");
+        if (name && ns && from && *from != commit) {
+            baseline[std::string(*name)] = { std::string(*from), std::atof(std::string(*ns).c_str()) };
+        }
+    }
+    previous.close();
+
+    int regressions = 0;
+    for (auto const& result : m_results) {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end()) {
+            continue;
+        }
+        auto const& [from, ns] = it->second;
+        auto change = (result.nsPerIter / ns - 1) * 100;
+        if (change > m_threshold) {
+            fmt::print("REGRESSION {:<40} {:+.1f}% since {}\n", result.name, change, from);
+            regressions += 1;
+        }
+        else if (change < -m_threshold) {
+            fmt::print("improved   {:<40} {:+.1f}% since {}\n", result.name, change, from);
+        }
+    }
+
+    std::ofstream history(*m_history, std::ios::app);
+    for (auto const& result : m_results) {
+        history << fmt::format(
+            "{{\"commit\":\"{}\",\"name\":\"{}\",\"ns\":{}}}\n", commit, result.name, result.nsPerIter
+        );
+    }
+    if (!history) {
+        fmt::print(stderr, "Unable to write {}\n", m_history->string());
+        return 1;
+    }
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dash::bench {
+    /// Keep the compiler from optimizing away a value that a benchmark
+    /// computes but never uses
+    template <class T>
+    inline void doNotOptimize(T const& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /// A minimal benchmark runner. Results can be appended to a history file
+    /// with `--history FILE`, and every run is compared against the last run
+    /// from a different commit in that file. The format is the same as the
+    /// compiler benchmarks', so both can share one history file
+    class Bench final {
+    private:
+        struct Result {
+            std::string name;
+            double nsPerIter;
+        };
+
+        std::optional<std::string> m_filter;
+        std::optional<std::filesystem::path> m_history;
+        /// How much slower than the previous run a benchmark may get before
+        /// it counts as a regression, in percent
+        double m_threshold = 10;
+        std::vector<Result> m_results;
+
+        bool skips(std::string_view name) const;
+        void record(std::string_view name, std::vector<double>& samples);
+
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// How long a single sample of a benchmark should take
+        static constexpr auto SAMPLE_TIME = std::chrono::milliseconds(20);
+        static constexpr size_t SAMPLES = 10;
+
+        /// Parse `[FILTER] [--history FILE] [--threshold PERCENT]`
+        Bench(int argc, char** argv);
+
+        /// Time `func`, which should do one iteration of the benchmark.
+        /// `func` is called in batches long enough to be timed reliably, and
+        /// the median time of a batch is reported
+        template <class F>
+        void run(std::string_view name, F&& func) {
+            if (this->skips(name)) {
+                return;
+            }
+            // Warm up and find out how many iterations fill a sample
+            auto start = Clock::now();
+            func();
+            auto once = std::max<Clock::duration>(Clock::now() - start, std::chrono::nanoseconds(1));
+            auto iters = std::clamp<int64_t>(SAMPLE_TIME / once, 1, 1 << 24);
+
+            std::vector<double> samples;
+            for (size_t i = 0; i < SAMPLES; i += 1) {
+                auto start = Clock::now();
+                for (int64_t j = 0; j < iters; j += 1) {
+                    func();
+                }
+                auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start);
+                samples.push_back(elapsed.count() / iters);
+            }
+            this->record(name, samples);
+        }
+
+        /// Compare the results against the history file and add them to it.
+        /// Returns the process exit code, which is non-zero if any benchmark
+        /// regressed
+        int finish();
+    };
+}
@@ -0,0 +1,237 @@
+#include "Bench.hpp"
+#include <Bind.hpp>
+#include <Compiler.hpp>
+#include <NativeClass.hpp>
+#include <PropertyBatch.hpp>
+#include <Reactive.hpp>
+#include <VM.hpp>
+#include <fmt/format.h>
+#include <memory>
+
+using namespace dash::bench;
+using namespace dash::lang;
+
+// Benchmarks of the runtime. Scripts are compiled with the embedded compiler
+// when the benchmarks start, so they always test the current compiler's
+// output, and are run without Geode
+
+static int64_t identity(int64_t value) {
+    return value;
+}
+
+/// A stand-in for CCNode with a few plain and grouped properties, so trees
+/// can be built the same way the runtime builds them without the game
+struct BenchNode {
+    std::vector<std::unique_ptr<BenchNode>> children;
+    std::string id;
+    std::string text;
+    float x = 0, y = 0;
+
+    std::string const& getID() const {
+        return id;
+    }
+    void setID(std::string value) {
+        id = std::move(value);
+    }
+    std::string const& getText() const {
+        return text;
+    }
+    void setText(std::string value) {
+        text = std::move(value);
+    }
+    float getX() const {
+        return x;
+    }
+    float getY() const {
+        return y;
+    }
+};
+
+static PropertyGroup const POSITION_GROUP {
+    .load = +[](void* obj, Value* values) {
+        auto node = static_cast<BenchNode*>(obj);
+        values[0] = Value::fromFloat(node->x);
+        values[1] = Value::fromFloat(node->y);
+    },
+    .apply = +[](void* obj, Value const* values) {
+        auto node = static_cast<BenchNode*>(obj);
+        node->x = values[0].asNumber();
+        node->y = values[1].asNumber();
+    },
+    .componentCount = 2,
+};
+
+static NativeClass& registerBenchNode() {
+    auto& cls = registerNativeClass("BenchNode", nullptr, +[](void*) { return true; });
+    cls.setFactory(+[]() -> void* { return new BenchNode(); });
+    addProperty<&BenchNode::getID, &BenchNode::setID>(cls, "id");
+    addProperty<&BenchNode::getText, &BenchNode::setText>(cls, "text");
+    addGroupedProperty<&BenchNode::getX>(cls, "x", POSITION_GROUP, 0);
+    addGroupedProperty<&BenchNode::getY>(cls, "y", POSITION_GROUP, 1);
+    return cls;
+}
+
+static Module compileModule(std::string_view name, std::string const& source) {
+    std::vector<uint8_t> image;
+    if (auto err = compile(std::string(name), source, image)) {
+        fmt::print(stderr, "Unable to compile {}:\n{}\n", name, *err);
+        std::exit(1);
+    }
+    Module module;
+    if (auto err = module.load(std::move(image))) {
+        fmt::print(stderr, "Unable to load {}: {}\n", name, *err);
+        std::exit(1);
+    }
+    return module;
+}
+
+/// Compile a script and run its entry point in every iteration
+static void benchScript(Bench& bench, std::string_view name, std::string const& source) {
+    auto module = compileModule(name, source);
+    VM vm(module);
+    if (auto err = vm.link()) {
+        fmt::print(stderr, "Unable to link {}: {}\n", name, *err);
+        std::exit(1);
+    }
+    bench.run(name, [&] {
+        auto result = vm.run({});
+        if (!result) {
+            fmt::print(stderr, "Error running {}: {}\n", name, vm.formatError(*vm.error()));
+            std::exit(1);
+        }
+        doNotOptimize(*result);
+    });
+}
+
+/// A long function of integer arithmetic, so nearly all of its time is
+/// spent dispatching instructions. Every variable takes a register, so
+/// there can only be so many of them
+static std::string dispatchScript() {
+    std::string src = "fun step(x: int) -> int {\n    let v0 = x;\n";
+    for (int i = 1; i < 200; i += 1) {
+        src += fmt::format("    let v{} = v{} * 3 - v{} + {};\n", i, i - 1, i / 2, i);
+    }
+    src += "    v199\n}\n";
+    for (int i = 0; i < 25; i += 1) {
+        src += fmt::format("step({}) + ", i);
+    }
+    src += "0\n";
+    return src;
+}
+
+/// A chain of script functions that each call the next one
+static std::string callScript() {
+    std::string src;
+    for (int i = 0; i < 100; i += 1) {
+        src += fmt::format("fun f{}(x: int) -> int {{\n    f{}(x) + 1\n}}\n", i, i + 1);
+    }
+    src += "fun f100(x: int) -> int {\n    x\n}\nf0(1)\n";
+    return src;
+}
+
+/// A function that calls a native that does nothing
+static std::string externScript() {
+    std::string src = "extern fun bench_id(x: int) -> int;\nfun calls(x: int) -> int {\n    0";
+    for (int i = 0; i < 200; i += 1) {
+        src += fmt::format(" + bench_id(x + {})", i);
+    }
+    src += "\n}\ncalls(1)\n";
+    return src;
+}
+
+/// One signal observed by `count` effects
+static void benchFanOut(Bench& bench, size_t count) {
+    auto& graph = ReactiveGraph::get();
+    Signal<int64_t> source(0);
+    int64_t sum = 0;
+    std::vector<std::unique_ptr<Effect>> effects;
+    for (size_t i = 0; i < count; i += 1) {
+        effects.push_back(std::make_unique<Effect>([&] { sum += source.get(); }));
+    }
+    bench.run(fmt::format("reactive/fan_out_{}", count), [&] {
+        source.set(source.peek() + 1);
+        graph.flush();
+    });
+    doNotOptimize(sum);
+}
+
+/// One signal read by `count` derived values, which are all read by one
+/// effect
+static void benchFanOutIn(Bench& bench, size_t count) {
+    auto& graph = ReactiveGraph::get();
+    Signal<int64_t> source(0);
+    std::vector<std::unique_ptr<Derived<int64_t>>> derived;
+    for (size_t i = 0; i < count; i += 1) {
+        derived.push_back(std::make_unique<Derived<int64_t>>([&, i] { return source.get() + int64_t(i); }));
+    }
+    int64_t sum = 0;
+    Effect total([&] {
+        sum = 0;
+        for (auto const& value : derived) {
+            sum += value->get();
+        }
+    });
+    bench.run(fmt::format("reactive/fan_out_in_{}", count), [&] {
+        source.set(source.peek() + 1);
+        graph.flush();
+    });
+    doNotOptimize(sum);
+}
+
+/// Build a tree of about 1000 nodes the way the runtime builds a `decl`
+/// tree: every node is created through its class's factory and has its
+/// properties looked up by name and assigned, with grouped properties
+/// staged and applied in one flush at the end
+static void benchDeclTree(Bench& bench, NativeClass const& cls) {
+    static Module empty;
+    VM vm(empty);
+    auto id = intern("id");
+    auto text = intern("text");
+    auto x = intern("x");
+    auto y = intern("y");
+
+    // Strings made outside of calls into the VM live until its arena is
+    // reset, which is done between iterations
+    String const* label = nullptr;
+    auto build = [&](int index) {
+        auto node = static_cast<BenchNode*>(cls.create());
+        auto name = fmt::format("node-{}", index);
+        cls.findProperty(id)->setter(vm, node, Value::fromString(vm.makeString(name)));
+        cls.findProperty(text)->setter(vm, node, Value::fromString(label));
+        PropertyBatch::get().stage(node, *cls.findProperty(x), Value::fromFloat(index));
+        PropertyBatch::get().stage(node, *cls.findProperty(y), Value::fromFloat(index * 2));
+        return std::unique_ptr<BenchNode>(node);
+    };
+    bench.run("decl_tree/1000_nodes", [&] {
+        vm.arena().reset();
+        label = vm.makeString("Hello");
+        int index = 0;
+        auto root = build(index++);
+        for (int i = 0; i < 10; i += 1) {
+            auto& row = root->children.emplace_back(build(index++));
+            for (int j = 0; j < 10; j += 1) {
+                auto& cell = row->children.emplace_back(build(index++));
+                for (int k = 0; k < 9; k += 1) {
+                    cell->children.emplace_back(build(index++));
+                }
+            }
+        }
+        PropertyBatch::get().flush();
+        doNotOptimize(root);
+    });
+}
+
+int main(int argc, char** argv) {
+    Bench bench(argc, argv);
+    registerNative("bench_id", bind<&identity>());
+    auto& node = registerBenchNode();
+
+    benchScript(bench, "vm/dispatch", dispatchScript());
+    benchScript(bench, "vm/calls", callScript());
+    benchScript(bench, "vm/extern_calls", externScript());
+    benchFanOut(bench, 1000);
+    benchFanOutIn(bench, 1000);
+    benchDeclTree(bench, node);
+
+    return bench.finish();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Geode/DefaultInclude.hpp>
+#include <future>
 
 #ifdef GEODE_IS_WINDOWS
     #ifdef HJFOD_Dash_EXPORTING
@@ -14,4 +15,19 @@
 
 namespace dash {
     Dash_DLL void loadDashFromFile(cocos2d::CCNode* node, ghc::filesystem::path const& path);
+    /// Like `loadDashFromFile`, but reading, compiling and verifying the file
+    /// happens on a worker thread, and only building the nodes is done on
+    /// the main thread, on a later frame. The future is ready once the nodes
+    /// have been built, with whether the file ran. It's fulfilled on the main
+    /// thread, so never wait for it there
+    Dash_DLL std::future<bool> loadDashFromFileAsync(cocos2d::CCNode* node, ghc::filesystem::path const& path);
+    /// Watch every file loaded with `loadDashFromFile` and patch the nodes it
+    /// built in place whenever the file changes. Meant for development
+    Dash_DLL void setHotReloadEnabled(bool enabled);
+    /// Start recording where script time goes, in every VM
+    Dash_DLL void startProfiling();
+    /// Stop recording, log a summary, and write a Chrome trace
+    /// (`trace.json`) and sampled stacks for flamegraphs (`stacks.folded`)
+    /// into a directory
+    Dash_DLL void stopProfiling(ghc::filesystem::path const& dir);
 }
@@ -1,8 +1,741 @@
-#include <Dash.hpp>
+#include <GDML.hpp>
+#include "HotReload.hpp"
+#include "Hooks.hpp"
+#include "LayoutBatch.hpp"
+#include "NodeTemplate.hpp"
+#include "VirtualList.hpp"
+#include <Geode/binding/MenuLayer.hpp>
+#include "lang/Bind.hpp"
+#include "lang/BytecodeCache.hpp"
+#include "lang/Jit.hpp"
+#include "lang/Profiler.hpp"
+#include "lang/PropertyBatch.hpp"
+#include "lang/Reactive.hpp"
+#include "lang/Std.hpp"
+#include "lang/TaskScheduler.hpp"
+#include "lang/VM.hpp"
+#include "lang/WorkerPool.hpp"
+#include <algorithm>
+#include <cmath>
 
 using namespace dash;
 using namespace dash::lang;
 using namespace geode::prelude;
 
-void dash::loadDashFromFile(CCNode* node, Path const& path) {
+static void print(std::string_view msg) {
+    log::info("{}", msg);
+}
+
+static double sine(double value) {
+    return std::sin(value);
+}
+static double cosine(double value) {
+    return std::cos(value);
+}
+static double tangent(double value) {
+    return std::tan(value);
+}
+
+namespace dash::lang {
+    /// Colors are packed into a single Value, so they never need to be
+    /// allocated
+    template <>
+    struct Marshal<ccColor3B> {
+        static constexpr char const* NAME = "color";
+        static bool check(Value const& value) {
+            return value.is(ValueType::Color);
+        }
+        static ccColor3B from(Value const& value) {
+            auto rgba = value.asColor();
+            return ccc3(rgba >> 24, (rgba >> 16) & 0xff, (rgba >> 8) & 0xff);
+        }
+        static Value to(VM&, ccColor3B const& value) {
+            return Value::fromColor(uint32_t(value.r) << 24 | uint32_t(value.g) << 16 | uint32_t(value.b) << 8 | 0xff);
+        }
+    };
+}
+
+// Natives that let files build their UI. See lang/Std/Nodes.dash
+
+static Value rootNode(VM& vm, std::span<const Value>) {
+    if (!vm.root()) {
+        vm.raise("This module isn't being run into a node, or the node is gone");
+        return Value();
+    }
+    return Value::fromObject(vm.root());
+}
+
+static Value createObject(VM& vm, std::span<const Value> args) {
+    auto name = args[0].asString()->view();
+    auto cls = findNativeClass(name);
+    auto object = cls ? cls->create() : nullptr;
+    if (!object) {
+        vm.raise(fmt::format("Objects of class '{}' can't be created by scripts", name));
+        return Value();
+    }
+    return Value::fromObject(object);
+}
+
+static Value addChild(VM& vm, std::span<const Value> args) {
+    auto parent = typeinfo_cast<CCNode*>(args[0].asObject<CCObject>());
+    auto child = typeinfo_cast<CCNode*>(args[1].asObject<CCObject>());
+    if (!parent || !child) {
+        vm.raise("Only nodes can be added as children of nodes");
+        return Value();
+    }
+    parent->addChild(child);
+    markBuilt(child);
+    LayoutBatch::get().invalidate(parent);
+    return Value();
+}
+
+/// Templates are keyed by where the function building them is declared as
+/// well as by the script's key, so files can't use each other's templates
+static std::string templateKey(VM& vm, FunctionID build, std::string_view key) {
+    auto const& module = vm.module();
+    auto const& fun = module.function(build);
+    if (auto span = module.debugSpan(fun, 0)) {
+        return fmt::format("{}:{}:{}/{}", module.string(span->file)->view(), span->line, span->column, key);
+    }
+    return fmt::format("{}/{}", module.string(fun.name)->view(), key);
+}
+
+static Value instantiate(VM& vm, std::span<const Value> args) {
+    auto build = args[1].asFunction();
+    auto node = TemplateCache::get().instantiate(
+        vm, templateKey(vm, build, args[0].asString()->view()),
+        [&]() -> CCNode* {
+            auto result = vm.call(build, {});
+            if (!result) {
+                return nullptr;
+            }
+            auto node = typeinfo_cast<CCNode*>(result->asObject<CCObject>());
+            if (!node) {
+                vm.raise("Templates can only be built from nodes");
+            }
+            return node;
+        }
+    );
+    // Errors have already been raised
+    return node ? Value::fromObject(node) : Value();
+}
+
+static void logListError(VM& vm) {
+    log::error("Error in list item: {}", vm.formatError(*vm.error()));
+}
+
+static Value setListItems(VM& vm, std::span<const Value> args) {
+    auto list = typeinfo_cast<VirtualList*>(args[0].asObject<CCObject>());
+    if (!list) {
+        vm.raise("Only lists have items");
+        return Value();
+    }
+    // Items are created and bound long after this call returns, so the
+    // list keeps the script alive
+    auto script = vm.script() ? vm.script()->weak_from_this().lock() : nullptr;
+    if (!script) {
+        vm.raise("List items can only be given by scripts run from files");
+        return Value();
+    }
+    auto create = args[1].asFunction();
+    auto bind = args[2].asFunction();
+    list->setItems(
+        [script, create]() -> CCNode* {
+            auto& vm = script->vm();
+            auto result = vm.call(create, {});
+            if (!result) {
+                logListError(vm);
+                return nullptr;
+            }
+            auto node = typeinfo_cast<CCNode*>(result->asObject<CCObject>());
+            if (!node) {
+                log::error("List items have to be nodes");
+            }
+            return node;
+        },
+        [script, bind](CCNode* node, size_t index) {
+            auto& vm = script->vm();
+            Value args[] = { Value::fromObject(node), Value::fromInt(static_cast<int64_t>(index)) };
+            if (!vm.call(bind, args)) {
+                logListError(vm);
+            }
+        }
+    );
+    return Value();
+}
+
+// Reactive values are owned by the script that created them, and effects
+// by the node they're attached to. Effects keep their script alive, so the
+// values they read stay around for as long as anything depends on them.
+// Unloading a script stops its effects, even on nodes that are still around
+
+static void logReactiveError(VM& vm) {
+    log::error("Error in reactive update: {}", vm.formatError(*vm.error()));
+}
+
+static std::string functionName(VM& vm, FunctionID id) {
+    return std::string(vm.module().string(vm.module().function(id).name)->view());
+}
+
+static SignalTable* scriptSignals(VM& vm) {
+    if (!vm.script()) {
+        vm.raise("Signals can only be used by scripts run from files");
+        return nullptr;
+    }
+    return &vm.script()->signals();
+}
+
+static std::optional<SignalTable::Handle> signalHandle(VM& vm, Value const& arg) {
+    auto signals = scriptSignals(vm);
+    if (!signals) {
+        return std::nullopt;
+    }
+    auto handle = arg.asInt();
+    if (handle < 0 || !signals->contains(static_cast<SignalTable::Handle>(handle))) {
+        vm.raise(fmt::format("There is no signal {}", handle));
+        return std::nullopt;
+    }
+    return static_cast<SignalTable::Handle>(handle);
+}
+
+static bool matchSignalType(ValueType type, Value& value) {
+    if (type == ValueType::Float && value.is(ValueType::Int)) {
+        value = Value::fromFloat(value.asNumber());
+    }
+    return value.is(type);
+}
+
+static Value createSignal(VM& vm, std::span<const Value> args) {
+    auto signals = scriptSignals(vm);
+    return signals ? Value::fromInt(signals->createSignal(args[0])) : Value();
+}
+
+static Value createDerived(VM& vm, std::span<const Value> args) {
+    auto signals = scriptSignals(vm);
+    if (!signals) {
+        return Value();
+    }
+    auto compute = args[0].asFunction();
+    // The table is owned by the script, so the VM outlives it
+    auto handle = signals->createDerived([&vm, compute]() -> std::optional<Value> {
+        auto nested = vm.isRunning();
+        auto result = vm.call(compute, {});
+        if (!result && !nested) {
+            logReactiveError(vm);
+        }
+        return result;
+    });
+    signals->setLabel(handle, "derived " + functionName(vm, compute));
+    return Value::fromInt(handle);
+}
+
+template <ValueType Type>
+static Value readSignal(VM& vm, std::span<const Value> args) {
+    auto handle = signalHandle(vm, args[0]);
+    if (!handle) {
+        return Value();
+    }
+    auto value = vm.script()->signals().get(*handle);
+    if (!matchSignalType(Type, value)) {
+        vm.raise(fmt::format("Signal {} doesn't hold a {}", *handle, valueTypeName(Type)));
+        return Value();
+    }
+    return value;
+}
+
+static Value writeSignal(VM& vm, std::span<const Value> args) {
+    auto handle = signalHandle(vm, args[0]);
+    if (!handle) {
+        return Value();
+    }
+    auto& signals = vm.script()->signals();
+    if (signals.isDerived(*handle)) {
+        vm.raise(fmt::format("Signal {} is derived, so it can't be written", *handle));
+        return Value();
+    }
+    auto value = args[1];
+    if (!matchSignalType(signals.peek(*handle).type(), value)) {
+        vm.raise(fmt::format("Signal {} can't be given a value of a different type", *handle));
+        return Value();
+    }
+    signals.set(*handle, value);
+    return Value();
+}
+
+/// Destroy an effect unless its script has already been unloaded, in which
+/// case it's gone and its ID may belong to another effect by now
+static void destroyEffect(Script& script, ReactiveID id) {
+    auto& effects = script.effects();
+    auto it = std::find(effects.begin(), effects.end(), id);
+    if (it != effects.end()) {
+        effects.erase(it);
+        ReactiveGraph::get().destroy(id);
+    }
+}
+
+namespace {
+    /// The effects attached to a node, destroyed along with it
+    class NodeEffects : public CCObject {
+    public:
+        struct Entry {
+            std::weak_ptr<Script> script;
+            ReactiveID id;
+        };
+        std::vector<Entry> effects;
+
+        ~NodeEffects() override {
+            for (auto const& [weak, id] : effects) {
+                // Effects keep their script alive, so the script is only
+                // gone if it has been unloaded
+                if (auto script = weak.lock()) {
+                    destroyEffect(*script, id);
+                }
+            }
+        }
+    };
+}
+
+static NodeEffects* getNodeEffects(CCNode* node) {
+    auto effects = typeinfo_cast<NodeEffects*>(node->getUserObject("dash.effects"));
+    if (!effects) {
+        effects = new NodeEffects();
+        effects->autorelease();
+        node->setUserObject("dash.effects", effects);
+    }
+    return effects;
+}
+
+static Value createEffect(VM& vm, std::span<const Value> args) {
+    auto owner = typeinfo_cast<CCNode*>(args[0].asObject<CCObject>());
+    if (!owner) {
+        vm.raise("Effects can only be attached to nodes");
+        return Value();
+    }
+    auto script = vm.script() ? vm.script()->weak_from_this().lock() : nullptr;
+    if (!script) {
+        vm.raise("Effects can only be created by scripts run from files");
+        return Value();
+    }
+    auto effects = getNodeEffects(owner);
+    auto run = args[1].asFunction();
+    auto id = ReactiveGraph::get().createEffect([script, run] {
+        auto& vm = script->vm();
+        auto nested = vm.isRunning();
+        if (!vm.call(run, {}) && !nested) {
+            logReactiveError(vm);
+        }
+    });
+    ReactiveGraph::get().setLabel(id, "effect " + functionName(vm, run));
+    script->effects().push_back(id);
+    effects->effects.push_back({ script, id });
+    return Value();
+}
+
+static Value overrideNative(VM& vm, std::span<const Value> args) {
+    // The game may call the native at any time, so the override keeps the
+    // script alive until it's unloaded
+    auto script = vm.script() ? vm.script()->weak_from_this().lock() : nullptr;
+    if (!script) {
+        vm.raise("Natives can only be overridden by scripts run from files");
+        return Value();
+    }
+    if (auto err = overrideHookable(args[0].asString()->view(), ScriptOverride { script, args[1].asFunction() })) {
+        vm.raise(*err);
+    }
+    return Value();
+}
+
+static Layout* getLayout(CCNode* node) {
+    return node->getLayout();
+}
+static void setLayout(CCNode* node, Layout* layout) {
+    node->setLayout(layout, false);
+    LayoutBatch::get().invalidate(node);
+}
+
+// Text changes usually change the label's width, which its parent's layout
+// depends on
+static void setText(CCLabelBMFont* label, std::string_view text) {
+    if (text == label->getString()) {
+        return;
+    }
+    label->setString(std::string(text).c_str());
+    LayoutBatch::get().invalidateSize(label);
+}
+
+static float getWidth(CCNode* node) {
+    return node->getContentSize().width;
+}
+static float getHeight(CCNode* node) {
+    return node->getContentSize().height;
+}
+
+// Position and size are applied as a whole, so setting both x and y only
+// updates the node's transform once
+static PropertyGroup const POSITION_GROUP {
+    .load = +[](void* obj, Value* values) {
+        auto pos = static_cast<CCNode*>(obj)->getPosition();
+        values[0] = Value::fromFloat(pos.x);
+        values[1] = Value::fromFloat(pos.y);
+    },
+    .apply = +[](void* obj, Value const* values) {
+        static_cast<CCNode*>(obj)->setPosition(ccp(values[0].asNumber(), values[1].asNumber()));
+    },
+    .componentCount = 2,
+    .update = +[](void* obj, uint8_t component, Value const& value) {
+        auto node = static_cast<CCNode*>(obj);
+        if (component == 0) {
+            node->setPositionX(value.asNumber());
+        }
+        else {
+            node->setPositionY(value.asNumber());
+        }
+    },
+};
+static PropertyGroup const SIZE_GROUP {
+    .load = +[](void* obj, Value* values) {
+        auto size = static_cast<CCNode*>(obj)->getContentSize();
+        values[0] = Value::fromFloat(size.width);
+        values[1] = Value::fromFloat(size.height);
+    },
+    .apply = +[](void* obj, Value const* values) {
+        auto node = static_cast<CCNode*>(obj);
+        node->setContentSize(CCSize(values[0].asNumber(), values[1].asNumber()));
+        LayoutBatch::get().invalidateSize(node);
+    },
+    .componentCount = 2,
+};
+
+template <class T>
+static bool isInstance(void* object) {
+    return typeinfo_cast<T*>(static_cast<CCObject*>(object)) != nullptr;
+}
+
+static void registerCocosClasses() {
+    // Objects of the same concrete class always resolve to the same
+    // properties, so the class's type info is a good cache key
+    setClassKeyResolver(+[](void* object) -> ClassKey {
+        return &typeid(*static_cast<CCObject*>(object));
+    });
+
+    auto& node = registerNativeClass("CCNode", nullptr, &isInstance<CCNode>);
+    node.setFactory(+[]() -> void* { return CCNode::create(); });
+    addProperty<&CCNode::getID, &CCNode::setID>(node, "id");
+    addGroupedProperty<&CCNode::getPositionX>(node, "x", POSITION_GROUP, 0);
+    addGroupedProperty<&CCNode::getPositionY>(node, "y", POSITION_GROUP, 1);
+    addGroupedProperty<&getWidth>(node, "width", SIZE_GROUP, 0);
+    addGroupedProperty<&getHeight>(node, "height", SIZE_GROUP, 1);
+    addProperty<&getLayout, &setLayout>(node, "layout");
+
+    auto& layout = registerNativeClass("Layout", nullptr, &isInstance<Layout>);
+    registerNativeClass("RowLayout", &layout, &isInstance<RowLayout>)
+        .setFactory(+[]() -> void* { return RowLayout::create(); });
+    registerNativeClass("ColumnLayout", &layout, &isInstance<ColumnLayout>)
+        .setFactory(+[]() -> void* { return ColumnLayout::create(); });
+
+    auto& label = registerNativeClass("CCLabelBMFont", &node, &isInstance<CCLabelBMFont>);
+    label.setFactory(+[]() -> void* { return CCLabelBMFont::create("", "bigFont.fnt"); });
+    addProperty<&CCLabelBMFont::getString, &setText>(label, "text");
+    addProperty<&CCLabelBMFont::getFntFile, &CCLabelBMFont::setFntFile>(label, "font");
+    addProperty<&CCLabelBMFont::getColor, &CCLabelBMFont::setColor>(label, "color");
+
+    // Scripts give lists their items with setListItems
+    auto& list = registerNativeClass("VirtualList", &node, &isInstance<VirtualList>);
+    list.setFactory(+[]() -> void* { return VirtualList::create(CCSizeZero, 1.f, nullptr, nullptr); });
+    addProperty<&VirtualList::getCount, &VirtualList::setCount>(list, "count");
+    addProperty<&VirtualList::getItemHeight, &VirtualList::setItemHeight>(list, "itemHeight");
+    addProperty<&VirtualList::getScroll, &VirtualList::setScroll>(list, "scroll");
+}
+
+static void scheduleFrameFlush() {
+    static bool scheduled = false;
+    if (scheduled) {
+        return;
+    }
+    scheduled = true;
+    Loader::get()->queueInMainThread([] {
+        scheduled = false;
+        // Effects write properties, so they have to run first, and sizes
+        // have to be applied before anything is laid out
+        ReactiveGraph::get().flush();
+        PropertyBatch::get().flush();
+        LayoutBatch::get().flush();
+    });
+}
+
+namespace {
+    /// Resumes script tasks on every frame for as long as there are any
+    class TaskTicker : public CCObject {
+    public:
+        static TaskTicker* get() {
+            static auto ticker = new TaskTicker();
+            return ticker;
+        }
+
+        void tick(float) {
+            if (!TaskScheduler::get().tick()) {
+                CCDirector::get()->getScheduler()->unscheduleSelector(schedule_selector(TaskTicker::tick), this);
+            }
+        }
+    };
+}
+
+static void scheduleTaskTicks() {
+    CCDirector::get()->getScheduler()->scheduleSelector(
+        schedule_selector(TaskTicker::tick), TaskTicker::get(), 0.f, false
+    );
+}
+
+$execute {
+    registerCocosClasses();
+    registerNative("print", bind<&print>());
+    registerNative("sin", bind<&sine>());
+    registerNative("cos", bind<&cosine>());
+    registerNative("tan", bind<&tangent>());
+    // The checker has already made sure the arguments have the declared
+    // types, so these don't check them again
+    registerNative("rootNode", &rootNode);
+    registerNative("createObject", &createObject);
+    registerNative("addChild", &addChild);
+    registerNative("instantiate", &instantiate);
+    registerNative("setListItems", &setListItems);
+    registerNative("signalInt", &createSignal);
+    registerNative("signalFloat", &createSignal);
+    registerNative("signalString", &createSignal);
+    registerNative("derivedInt", &createDerived);
+    registerNative("derivedFloat", &createDerived);
+    registerNative("derivedString", &createDerived);
+    registerNative("readInt", &readSignal<ValueType::Int>);
+    registerNative("readFloat", &readSignal<ValueType::Float>);
+    registerNative("readString", &readSignal<ValueType::String>);
+    registerNative("writeInt", &writeSignal);
+    registerNative("writeFloat", &writeSignal);
+    registerNative("writeString", &writeSignal);
+    registerNative("effect", &createEffect);
+    registerNative("overrideBool", &overrideNative);
+    // Std has to be loaded before anything is compiled
+    auto stdImage = std::filesystem::path((Mod::get()->getResourcesDir() / "Std.dashc").native());
+    if (auto err = StdLibrary::get().load(stdImage)) {
+        log::warn("Unable to load the precompiled standard library, checking it from source: {}", *err);
+    }
+    // Hooks are only installed once a script actually overrides them
+    registerHookable<&MenuLayer::init>(
+        "MenuLayer::init", reinterpret_cast<void*>(addresser::getVirtual(&MenuLayer::init))
+    );
+    // Coalesce all writes to reactive values and grouped properties made
+    // and layouts during a frame into a single update at the start of the
+    // next one
+    ReactiveGraph::get().setFlushScheduler(&scheduleFrameFlush);
+    PropertyBatch::get().setFlushScheduler(&scheduleFrameFlush);
+    LayoutBatch::get().setFlushScheduler(&scheduleFrameFlush);
+    TaskScheduler::get().setFrameBudget(
+        std::chrono::milliseconds(Mod::get()->getSettingValue<int64_t>("task-frame-budget"))
+    );
+    TaskScheduler::get().setTickScheduler(&scheduleTaskTicks);
+    TaskScheduler::get().setErrorHandler([](Script& script, RuntimeError const& error) {
+        log::error("Error in script task: {}", script.vm().formatError(error));
+    });
+    PropertyBatch::get().setObjectHooks(
+        +[](void* obj) { static_cast<CCObject*>(obj)->retain(); },
+        +[](void* obj) { static_cast<CCObject*>(obj)->release(); }
+    );
+    setHotReloadEnabled(Mod::get()->getSettingValue<bool>("hot-reload"));
+    setJitEnabled(Mod::get()->getSettingValue<bool>("jit"));
+}
+
+static BytecodeCache& getBytecodeCache() {
+    static BytecodeCache cache(std::filesystem::path((Mod::get()->getSaveDir() / "bytecode").native()));
+    return cache;
+}
+
+/// Read, compile and verify a file. This doesn't touch any nodes, so it can
+/// be done on any thread
+static std::optional<std::string> loadModule(
+    BytecodeCache& cache, std::filesystem::path const& file, Module& module
+) {
+    // Precompiled images are loaded as-is; sources go through the cache so
+    // they only need to be compiled when they change
+    return file.extension() == ".dashc" ?
+        module.loadFromFile(file) :
+        cache.load(file, module);
+}
+
+void dash::unloadScript(Script& script) {
+    script.vm().setRoot(nullptr);
+    TaskScheduler::get().cancel(script);
+    removeAllOverrides(&script);
+    // Destroying an effect may release the last reference to the script
+    // besides the caller's, but never the caller's
+    auto effects = std::move(script.effects());
+    script.effects().clear();
+    for (auto id : effects) {
+        ReactiveGraph::get().destroy(id);
+    }
+}
+
+namespace {
+    /// The scripts run into a node, unloaded when it's destroyed. Scripts
+    /// are held weakly, so a script nothing else needs is still freed as
+    /// soon as it has run
+    class NodeScripts : public CCObject {
+    public:
+        std::vector<std::weak_ptr<Script>> scripts;
+
+        ~NodeScripts() override {
+            for (auto const& weak : scripts) {
+                if (auto script = weak.lock()) {
+                    unloadScript(*script);
+                }
+            }
+        }
+    };
+}
+
+static void attachScript(CCNode* node, std::shared_ptr<Script> const& script) {
+    auto scripts = typeinfo_cast<NodeScripts*>(node->getUserObject("dash.scripts"));
+    if (!scripts) {
+        scripts = new NodeScripts();
+        scripts->autorelease();
+        node->setUserObject("dash.scripts", scripts);
+    }
+    std::erase_if(scripts->scripts, [](auto const& weak) { return weak.expired(); });
+    scripts->scripts.push_back(script);
+}
+
+void dash::moveScript(std::shared_ptr<Script> const& script, std::unordered_map<CCNode*, CCNode*> const& replaced) {
+    std::unordered_map<void*, void*> objects;
+    for (auto [from, to] : replaced) {
+        objects.emplace(from, to);
+        if (auto effects = typeinfo_cast<NodeEffects*>(from->getUserObject("dash.effects"))) {
+            auto& moved = getNodeEffects(to)->effects;
+            moved.insert(moved.end(), effects->effects.begin(), effects->effects.end());
+            effects->effects.clear();
+        }
+        if (auto scripts = typeinfo_cast<NodeScripts*>(from->getUserObject("dash.scripts"))) {
+            std::erase_if(scripts->scripts, [&](auto const& weak) { return weak.lock() == script; });
+        }
+    }
+    auto& vm = script->vm();
+    vm.replaceObjects(objects);
+    if (auto root = static_cast<CCNode*>(vm.root())) {
+        attachScript(root, script);
+    }
+}
+
+/// Link and run a loaded module into a node. Must be called on the main
+/// thread
+static std::shared_ptr<Script> runModule(CCNode* node, std::filesystem::path const& file, Module&& module) {
+    auto script = std::make_shared<Script>(std::move(module));
+    auto& vm = script->vm();
+    if (auto err = vm.link()) {
+        log::error("Unable to link {}: {}", file.string(), *err);
+        return nullptr;
+    }
+    // Tasks may run long after this returns, so they have to stop before
+    // the node they build into is freed
+    vm.setRoot(node);
+    attachScript(node, script);
+    auto ok = vm.run({}).has_value();
+    if (!ok) {
+        log::error("Error running {}: {}", file.string(), vm.formatError(*vm.error()));
+    }
+    else {
+        // Async functions the file started keep running over the next frames
+        TaskScheduler::get().add(script);
+    }
+    // The nodes the entry point constructed should be fully set up and laid
+    // out once this returns
+    PropertyBatch::get().flush();
+    LayoutBatch::get().flush();
+    return ok ? script : nullptr;
+}
+
+std::shared_ptr<Script> dash::runFile(CCNode* node, std::filesystem::path const& file) {
+    Module module;
+    if (auto err = loadModule(getBytecodeCache(), file, module)) {
+        log::error("Unable to load {}: {}", file.string(), *err);
+        return nullptr;
+    }
+    return runModule(node, file, std::move(module));
+}
+
+/// Run a file into a node with `run`, and watch it if hot reloading is on
+template <class F>
+static bool runWatched(CCNode* node, std::filesystem::path const& file, F&& run) {
+    if (!isHotReloadEnabled()) {
+        return run() != nullptr;
+    }
+    // Remember which children the file builds so reloads only touch those
+    auto before = node->getChildrenCount();
+    auto script = run();
+    std::vector<CCNode*> built;
+    if (auto children = node->getChildren()) {
+        for (auto i = before; i < node->getChildrenCount(); i += 1) {
+            built.push_back(static_cast<CCNode*>(children->objectAtIndex(i)));
+        }
+    }
+    // Files are watched even if they failed to run, so fixing them reloads
+    watchForHotReload(node, file, built, script);
+    return script != nullptr;
+}
+
+void dash::loadDashFromFile(CCNode* node, ghc::filesystem::path const& path) {
+    auto file = std::filesystem::path(path.native());
+    runWatched(node, file, [&] { return runFile(node, file); });
+}
+
+std::future<bool> dash::loadDashFromFileAsync(CCNode* node, ghc::filesystem::path const& path) {
+    auto file = std::filesystem::path(path.native());
+    auto done = std::make_shared<std::promise<bool>>();
+    auto future = done->get_future();
+    // The node has to stay alive until it has been built into, and the
+    // cache has to be created on the main thread since it asks Geode for
+    // its directory
+    node->retain();
+    auto& cache = getBytecodeCache();
+    WorkerPool::get().post([node, file, done, &cache] {
+        auto module = std::make_shared<Module>();
+        auto err = loadModule(cache, file, *module);
+        Loader::get()->queueInMainThread([node, file, done, module, err] {
+            auto ok = runWatched(node, file, [&]() -> std::shared_ptr<Script> {
+                if (err) {
+                    log::error("Unable to load {}: {}", file.string(), *err);
+                    return nullptr;
+                }
+                return runModule(node, file, std::move(*module));
+            });
+            node->release();
+            done->set_value(ok);
+        });
+    });
+    return future;
+}
+
+static Profiler& getProfiler() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void dash::startProfiling() {
+    if (!getProfiler().start()) {
+        log::warn("Unable to start profiling: the profiler is already running");
+    }
+}
+
+void dash::stopProfiling(ghc::filesystem::path const& path) {
+    auto& profiler = getProfiler();
+    if (!profiler.isRunning()) {
+        return;
+    }
+    profiler.stop();
+    log::info("Script profile:\n{}", profiler.report());
+    auto dir = std::filesystem::path(path.native());
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (auto err = profiler.writeChromeTrace(dir / "trace.json")) {
+        log::error("Unable to write the trace: {}", *err);
+    }
+    if (auto err = profiler.writeFoldedStacks(dir / "stacks.folded")) {
+        log::error("Unable to write the sampled stacks: {}", *err);
+    }
 }
@@ -0,0 +1,35 @@
+#include "Hooks.hpp"
+#include <unordered_map>
+
+using namespace dash;
+using namespace dash::lang;
+
+namespace {
+    struct Hookable {
+        OverrideInstaller install;
+        OverrideRemover remove;
+    };
+}
+
+static std::unordered_map<std::string, Hookable>& hookables() {
+    static std::unordered_map<std::string, Hookable> hookables;
+    return hookables;
+}
+
+void dash::registerHookable(std::string_view name, OverrideInstaller install, OverrideRemover remove) {
+    hookables().insert_or_assign(std::string(name), Hookable { install, remove });
+}
+
+std::optional<std::string> dash::overrideHookable(std::string_view name, ScriptOverride override) {
+    auto it = hookables().find(std::string(name));
+    if (it == hookables().end()) {
+        return fmt::format("{} can not be overridden", name);
+    }
+    return it->second.install(std::move(override));
+}
+
+void dash::removeAllOverrides(Script const* script) {
+    for (auto const& [_, hookable] : hookables()) {
+        hookable.remove(script);
+    }
+}
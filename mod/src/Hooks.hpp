@@ -0,0 +1,167 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include <Geode/loader/Mod.hpp>
+#include "lang/Bind.hpp"
+#include "lang/TaskScheduler.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dash {
+    /// A script function that replaces a hooked native function, like an
+    /// `@override fun init()` in a `@modify struct MenuLayer`. Scripts
+    /// install them with `overrideBool`
+    struct ScriptOverride {
+        /// Keeps the overriding script alive for as long as the override is
+        /// installed
+        std::shared_ptr<lang::Script> script;
+        lang::FunctionID function;
+        /// Only instances of this class are overridden, or every instance if
+        /// this is null
+        lang::ClassKey cls = nullptr;
+    };
+
+    namespace detail {
+        /// Hooked member functions are thiscall on Windows, but the detour is
+        /// a free function taking the object first, so the hook has to
+        /// convert between the two
+    #ifdef GEODE_IS_WINDOWS
+        constexpr auto MEMBER_CONVENTION = tulip::hook::TulipConvention::Thiscall;
+    #else
+        constexpr auto MEMBER_CONVENTION = tulip::hook::TulipConvention::Default;
+    #endif
+
+        /// Per-hook state. Every hookable function gets its own instance, so
+        /// the trampoline reaches its overrides without any lookup
+        template <auto Fn>
+        struct HookSlot {
+            static inline geode::Hook* hook = nullptr;
+            static inline std::vector<ScriptOverride> overrides;
+        };
+
+        template <auto Fn, class F = decltype(Fn)>
+        struct Trampoline;
+
+        template <auto Fn, class R, class C, class... A>
+        struct Trampoline<Fn, R(C::*)(A...)> {
+            /// Overrides take the object the function is called on first
+            static constexpr size_t PARAM_COUNT = sizeof...(A) + 1;
+
+            static ScriptOverride const* find(C* self) {
+                auto key = lang::classKeyOf(self);
+                for (auto const& o : HookSlot<Fn>::overrides) {
+                    if (!o.cls || o.cls == key) {
+                        return &o;
+                    }
+                }
+                return nullptr;
+            }
+
+            static R callScript(ScriptOverride const& o, C* self, A... args) {
+                // The script may remove its overrides while it runs, which
+                // would free the override and possibly the script
+                auto script = o.script;
+                auto& vm = script->vm();
+                lang::Value values[] = {
+                    lang::Value::fromObject(self), lang::MarshalFor<A>::to(vm, args)...
+                };
+                auto result = vm.call(o.function, values);
+                if (!result) {
+                    geode::log::error("Error in script override: {}", vm.formatError(*vm.error()));
+                }
+                else if constexpr (std::is_void_v<R>) {
+                    return;
+                }
+                else if (lang::MarshalFor<R>::check(*result)) {
+                    return lang::MarshalFor<R>::from(*result);
+                }
+                else {
+                    geode::log::error(
+                        "Script override returned {}, expected {}",
+                        lang::valueTypeName(result->type()), lang::MarshalFor<R>::NAME
+                    );
+                }
+                // Fall back to the original so the game keeps working
+                return (self->*Fn)(args...);
+            }
+
+            /// The detour installed for the hook. Calling the function from
+            /// inside the detour reaches the original
+            static R detour(C* self, A... args) {
+                if (HookSlot<Fn>::overrides.empty()) [[likely]] {
+                    return (self->*Fn)(args...);
+                }
+                if (auto o = find(self)) {
+                    return callScript(*o, self, args...);
+                }
+                return (self->*Fn)(args...);
+            }
+        };
+    }
+
+    /// Install a script override for a native function. The hook itself is
+    /// only created once the function is first overridden, so functions
+    /// nothing overrides don't go through a detour at all. `address` is the
+    /// function's address in the game
+    template <auto Fn>
+    std::optional<std::string> addOverride(void* address, std::string_view name, ScriptOverride override) {
+        using Slot = detail::HookSlot<Fn>;
+        constexpr auto paramCount = detail::Trampoline<Fn>::PARAM_COUNT;
+        auto const& fun = override.script->module().function(override.function);
+        if (fun.paramCount != paramCount) {
+            return fmt::format(
+                "{} is overridden with a function taking {} arguments, expected {}",
+                name, fun.paramCount, paramCount
+            );
+        }
+        if (!Slot::hook) {
+            auto res = geode::Mod::get()->hook(
+                address, &detail::Trampoline<Fn>::detour, std::string(name),
+                detail::MEMBER_CONVENTION
+            );
+            if (!res) {
+                return res.unwrapErr();
+            }
+            Slot::hook = res.unwrap();
+        }
+        Slot::overrides.push_back(std::move(override));
+        return std::nullopt;
+    }
+
+    /// Remove every override of a function that was installed by a script.
+    /// The hook stays in place, but passes straight through to the original
+    template <auto Fn>
+    void removeOverrides(lang::Script const* script) {
+        std::erase_if(detail::HookSlot<Fn>::overrides, [script](ScriptOverride const& o) {
+            return o.script.get() == script;
+        });
+    }
+
+    using OverrideInstaller = std::optional<std::string>(*)(ScriptOverride override);
+    using OverrideRemover = void(*)(lang::Script const* script);
+
+    /// Make a native function overridable by scripts under a name like
+    /// `MenuLayer::init`. The original is also registered as a native of the
+    /// same name, so overrides can call it
+    void registerHookable(std::string_view name, OverrideInstaller install, OverrideRemover remove);
+    template <auto Fn>
+    void registerHookable(std::string_view name, void* address) {
+        static void* s_address = address;
+        static std::string s_name = std::string(name);
+        lang::registerNative(name, lang::bind<Fn>());
+        registerHookable(
+            name,
+            +[](ScriptOverride override) { return addOverride<Fn>(s_address, s_name, std::move(override)); },
+            &removeOverrides<Fn>
+        );
+    }
+
+    /// Install a script override by the name it was registered under
+    std::optional<std::string> overrideHookable(std::string_view name, ScriptOverride override);
+    /// Remove every override installed by a script, for example when it's
+    /// unloaded
+    void removeAllOverrides(lang::Script const* script);
+}
@@ -0,0 +1,260 @@
+#include <GDML.hpp>
+#include "HotReload.hpp"
+#include "LayoutBatch.hpp"
+#include "NodeTemplate.hpp"
+#include "lang/NativeClass.hpp"
+#include "lang/SourceWatcher.hpp"
+#include "lang/VM.hpp"
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace dash;
+using namespace dash::lang;
+using namespace geode::prelude;
+
+static std::vector<CCNode*> childrenOf(CCNode* node) {
+    std::vector<CCNode*> children;
+    if (auto arr = node->getChildren()) {
+        for (auto child : CCArrayExt<CCNode*>(arr)) {
+            children.push_back(child);
+        }
+    }
+    return children;
+}
+
+static bool isBuilt(CCNode* node) {
+    return node->getUserObject("dash.built") != nullptr;
+}
+
+/// The children of a node that a script built, leaving out the ones natives
+/// created for themselves
+static std::vector<CCNode*> builtChildrenOf(CCNode* node) {
+    auto children = childrenOf(node);
+    std::erase_if(children, [](CCNode* child) { return !isBuilt(child); });
+    return children;
+}
+
+/// Copy every property that differs between a freshly built node and its
+/// live counterpart onto the live node
+static void patchProperties(VM& vm, CCNode* live, CCNode* fresh) {
+    auto cls = nativeClassOf(classKeyOf(live), live);
+    if (!cls) {
+        return;
+    }
+    std::unordered_set<PropertyGroup const*> groups;
+    for (auto const& [_, prop] : cls->allProperties()) {
+        if (prop->group) {
+            groups.insert(prop->group);
+            continue;
+        }
+        if (!prop->setter) {
+            continue;
+        }
+        auto value = prop->getter(vm, fresh);
+        if (!(prop->getter(vm, live) == value)) {
+            prop->setter(vm, live, value);
+        }
+    }
+    for (auto group : groups) {
+        Value liveValues[PropertyGroup::MAX_COMPONENTS];
+        Value freshValues[PropertyGroup::MAX_COMPONENTS];
+        group->load(live, liveValues);
+        group->load(fresh, freshValues);
+        if (!std::equal(liveValues, liveValues + group->componentCount, freshValues)) {
+            group->apply(live, freshValues);
+        }
+    }
+}
+
+/// Reconcile a list of live nodes with the nodes a reload built. Nodes are
+/// matched by ID, or by position and class if they have no ID. Matched
+/// nodes are patched in place, so only nodes that were actually added or
+/// removed in the source are created or destroyed. Only children the script
+/// built are matched and removed. Matched fresh nodes are recorded in
+/// `replaced` along with the live nodes that took their place. Returns the
+/// new list of live nodes
+static std::vector<CCNode*> patchChildren(
+    VM& vm, CCNode* parent, std::vector<CCNode*> const& live, std::vector<CCNode*> const& fresh,
+    std::unordered_map<CCNode*, CCNode*>& replaced
+) {
+    std::vector<bool> matched(live.size(), false);
+    auto findMatch = [&](CCNode* node, size_t index) -> CCNode* {
+        for (size_t i = 0; i < live.size(); i += 1) {
+            if (matched[i] || typeid(*live[i]) != typeid(*node)) {
+                continue;
+            }
+            bool match = node->getID().empty() ?
+                (i == index && live[i]->getID().empty()) :
+                live[i]->getID() == node->getID();
+            if (match) {
+                matched[i] = true;
+                return live[i];
+            }
+        }
+        return nullptr;
+    };
+
+    std::vector<CCNode*> result;
+    for (size_t i = 0; i < fresh.size(); i += 1) {
+        auto node = fresh[i];
+        if (auto target = findMatch(node, i)) {
+            patchProperties(vm, target, node);
+            patchChildren(vm, target, builtChildrenOf(target), builtChildrenOf(node), replaced);
+            replaced.emplace(node, target);
+            target->setZOrder(node->getZOrder());
+            result.push_back(target);
+        }
+        else {
+            // Take over the freshly built node as-is
+            node->retain();
+            node->removeFromParentAndCleanup(false);
+            parent->addChild(node);
+            node->release();
+            result.push_back(node);
+        }
+    }
+    for (size_t i = 0; i < live.size(); i += 1) {
+        if (!matched[i]) {
+            live[i]->removeFromParent();
+        }
+    }
+    LayoutBatch::get().invalidate(parent);
+    return result;
+}
+
+namespace {
+    class HotReloader : public CCObject {
+    private:
+        struct Target {
+            std::filesystem::path file;
+            Ref<CCNode> root;
+            std::vector<Ref<CCNode>> built;
+            /// The script that built the live nodes
+            std::weak_ptr<Script> script;
+        };
+
+        SourceWatcher m_watcher;
+        std::vector<Target> m_targets;
+        bool m_enabled = false;
+        /// Getters and setters need a VM, but patching doesn't run any script
+        /// code, so every reload shares one without a module
+        Module m_scratchModule;
+        VM m_scratch { m_scratchModule };
+
+        void reload(Target& target) {
+            // Templates may have been built by the code that changed
+            TemplateCache::get().clear();
+            // The new version builds into a scratch node, and is moved over
+            // to the live nodes once they've been patched
+            auto fresh = CCNode::create();
+            fresh->setContentSize(target.root->getContentSize());
+            auto script = runFile(fresh, target.file);
+            if (!script) {
+                log::warn("Keeping the previous version of {}", target.file.string());
+                return;
+            }
+            // Otherwise the previous version's effects and tasks would keep
+            // writing into the nodes that are patched
+            if (auto old = target.script.lock()) {
+                unloadScript(*old);
+            }
+
+            std::vector<CCNode*> live;
+            for (auto const& node : target.built) {
+                // Skip nodes that something else has removed since
+                if (node->getParent() == target.root) {
+                    live.push_back(node);
+                }
+            }
+            std::unordered_map<CCNode*, CCNode*> replaced { { fresh, target.root } };
+            auto patched = patchChildren(m_scratch, target.root, live, childrenOf(fresh), replaced);
+            // Strings the getters made were only needed for comparing
+            m_scratch.arena().reset();
+            target.built.assign(patched.begin(), patched.end());
+            moveScript(script, replaced);
+            target.script = script;
+            log::info("Reloaded {}", target.file.string());
+        }
+
+        void poll(float) {
+            for (auto const& file : m_watcher.poll()) {
+                for (auto& target : m_targets) {
+                    if (target.file == file) {
+                        this->reload(target);
+                    }
+                }
+            }
+            // Stop watching roots that only we are keeping alive anymore
+            std::vector<std::filesystem::path> dropped;
+            std::erase_if(m_targets, [&](Target const& target) {
+                if (target.root->retainCount() > 1) {
+                    return false;
+                }
+                dropped.push_back(target.file);
+                return true;
+            });
+            for (auto const& file : dropped) {
+                if (std::none_of(m_targets.begin(), m_targets.end(), [&](Target const& t) { return t.file == file; })) {
+                    m_watcher.unwatch(file);
+                }
+            }
+        }
+
+    public:
+        static HotReloader* get() {
+            static auto reloader = new HotReloader();
+            return reloader;
+        }
+
+        bool isEnabled() const {
+            return m_enabled;
+        }
+        void setEnabled(bool enabled) {
+            if (enabled == m_enabled) {
+                return;
+            }
+            m_enabled = enabled;
+            auto scheduler = CCDirector::get()->getScheduler();
+            if (enabled) {
+                scheduler->scheduleSelector(schedule_selector(HotReloader::poll), this, 0.5f, false);
+            }
+            else {
+                scheduler->unscheduleSelector(schedule_selector(HotReloader::poll), this);
+                m_targets.clear();
+                m_watcher = SourceWatcher();
+            }
+        }
+
+        void watch(
+            CCNode* root, std::filesystem::path const& file,
+            std::vector<CCNode*> const& built, std::shared_ptr<Script> const& script
+        ) {
+            m_watcher.watch(file);
+            m_targets.push_back(Target { file, root, { built.begin(), built.end() }, script });
+        }
+    };
+}
+
+bool dash::isHotReloadEnabled() {
+    return HotReloader::get()->isEnabled();
+}
+
+void dash::setHotReloadEnabled(bool enabled) {
+    HotReloader::get()->setEnabled(enabled);
+}
+
+void dash::watchForHotReload(
+    CCNode* root, std::filesystem::path const& file,
+    std::vector<CCNode*> const& built, std::shared_ptr<Script> const& script
+) {
+    HotReloader::get()->watch(root, file, built, script);
+}
+
+void dash::markBuilt(CCNode* node) {
+    if (!isHotReloadEnabled()) {
+        return;
+    }
+    // Every built node shares one marker, so marking doesn't allocate
+    static auto marker = new CCObject();
+    node->setUserObject("dash.built", marker);
+}
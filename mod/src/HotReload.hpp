@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include "lang/TaskScheduler.hpp"
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace dash {
+    /// Load, link and run a Dash file into a node, logging any errors.
+    /// Returns the script, or null if the file could not be run
+    std::shared_ptr<lang::Script> runFile(cocos2d::CCNode* node, std::filesystem::path const& file);
+    /// Stop a script's tasks, overrides and effects, and forget the node it
+    /// was run into. This happens on its own once that node is destroyed
+    void unloadScript(lang::Script& script);
+    /// Point a script at the nodes that replaced the ones it built, moving
+    /// their effects over. `replaced` maps each built node to its
+    /// replacement, and may include the node the script was run into
+    void moveScript(
+        std::shared_ptr<lang::Script> const& script,
+        std::unordered_map<cocos2d::CCNode*, cocos2d::CCNode*> const& replaced
+    );
+
+    bool isHotReloadEnabled();
+    /// Start watching a file that was run into `root`. `built` are the children
+    /// of `root` that the file created; only those are patched on reload.
+    /// `script` is stopped once the file is reloaded
+    void watchForHotReload(
+        cocos2d::CCNode* root, std::filesystem::path const& file,
+        std::vector<cocos2d::CCNode*> const& built, std::shared_ptr<lang::Script> const& script
+    );
+    /// Mark a node as built by a script, so reloads may patch and remove it.
+    /// Nodes that natives create for themselves, like the cells of a list,
+    /// are left alone. Does nothing unless hot reloading is on
+    void markBuilt(cocos2d::CCNode* node);
+}
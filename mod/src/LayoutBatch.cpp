@@ -0,0 +1,78 @@
+#include "LayoutBatch.hpp"
+#include <algorithm>
+
+using namespace dash;
+using namespace geode::prelude;
+
+static size_t depthOf(CCNode* node) {
+    size_t depth = 0;
+    for (auto parent = node->getParent(); parent; parent = parent->getParent()) {
+        depth += 1;
+    }
+    return depth;
+}
+
+LayoutBatch& LayoutBatch::get() {
+    static LayoutBatch batch;
+    return batch;
+}
+
+void LayoutBatch::setFlushScheduler(std::function<void()> scheduler) {
+    m_scheduler = std::move(scheduler);
+}
+
+void LayoutBatch::invalidate(CCNode* node) {
+    if (!node || !node->getLayout() || !m_queued.insert(node).second) {
+        return;
+    }
+    node->retain();
+    // Nodes are often invalidated before they're added to their parents, so
+    // depths are only computed once the flush starts. Nodes invalidated
+    // during the flush are already in place
+    if (m_flushing) {
+        m_pending.push_back(Pending { node, depthOf(node) });
+        std::push_heap(m_pending.begin(), m_pending.end());
+    }
+    else {
+        m_pending.push_back(Pending { node, 0 });
+    }
+    if (m_scheduler && !m_flushScheduled) {
+        m_flushScheduled = true;
+        m_scheduler();
+    }
+}
+
+void LayoutBatch::invalidateSize(CCNode* node) {
+    this->invalidate(node);
+    this->invalidate(node->getParent());
+}
+
+void LayoutBatch::flush() {
+    if (m_flushing) {
+        return;
+    }
+    m_flushing = true;
+    for (auto& pending : m_pending) {
+        pending.depth = depthOf(pending.node);
+    }
+    std::make_heap(m_pending.begin(), m_pending.end());
+    // Parents are always shallower than their children, so parents that
+    // get invalidated by a child's new size are still laid out after every
+    // one of their children in this pass
+    while (!m_pending.empty()) {
+        std::pop_heap(m_pending.begin(), m_pending.end());
+        auto node = m_pending.back().node;
+        m_pending.pop_back();
+        m_queued.erase(node);
+
+        auto size = node->getContentSize();
+        node->updateLayout();
+        if (!node->getContentSize().equals(size)) {
+            this->invalidate(node->getParent());
+        }
+        node->release();
+    }
+    // Cleared last so nothing invalidated during the pass schedules another
+    m_flushScheduled = false;
+    m_flushing = false;
+}
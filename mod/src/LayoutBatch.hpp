@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+namespace dash {
+    /// Pending relayouts of nodes with a `layout`. Adding children, resizing
+    /// nodes or changing a label's text only marks the affected layouts as
+    /// dirty; once per frame every dirty layout is updated in one pass, from
+    /// the deepest nodes up, so a node whose children changed many times
+    /// during a frame is only laid out once. If laying out a node changes
+    /// its size, its parent's layout is updated in the same pass
+    class LayoutBatch final {
+    private:
+        struct Pending {
+            cocos2d::CCNode* node;
+            size_t depth;
+
+            /// Deepest nodes first
+            bool operator<(Pending const& other) const {
+                return depth < other.depth;
+            }
+        };
+
+        /// A max-heap on depth while flushing. Before that, depths aren't
+        /// known yet
+        std::vector<Pending> m_pending;
+        std::unordered_set<cocos2d::CCNode*> m_queued;
+        std::function<void()> m_scheduler;
+        bool m_flushScheduled = false;
+        bool m_flushing = false;
+
+        LayoutBatch() = default;
+
+    public:
+        LayoutBatch(LayoutBatch const&) = delete;
+        LayoutBatch& operator=(LayoutBatch const&) = delete;
+
+        static LayoutBatch& get();
+
+        /// Install a function that arranges for `flush` to be called later,
+        /// for example on the next frame. Without a scheduler, layouts are
+        /// only updated when `flush` is called explicitly
+        void setFlushScheduler(std::function<void()> scheduler);
+
+        bool empty() const {
+            return m_pending.empty();
+        }
+
+        /// Mark a node's layout as dirty, for example because its children
+        /// changed. Does nothing if the node has no layout
+        void invalidate(cocos2d::CCNode* node);
+        /// Mark the layouts that depend on a node's size as dirty: its own,
+        /// and its parent's
+        void invalidateSize(cocos2d::CCNode* node);
+        /// Update every dirty layout
+        void flush();
+    };
+}
@@ -0,0 +1,174 @@
+#include "NodeTemplate.hpp"
+#include "HotReload.hpp"
+#include "LayoutBatch.hpp"
+#include <algorithm>
+
+using namespace dash;
+using namespace dash::lang;
+using namespace geode::prelude;
+
+/// Template values outlive the VM call they were read in, so strings are
+/// replaced with their interned copies
+static Value persistent(Value value) {
+    if (value.is(ValueType::String)) {
+        auto& symbols = SymbolTable::get();
+        return Value::fromString(symbols.string(symbols.intern(value.asString()->view())));
+    }
+    return value;
+}
+
+std::optional<std::string> NodeTemplate::capture(VM& vm, CCNode* prototype) {
+    auto cls = nativeClassOf(classKeyOf(prototype), prototype);
+    if (!cls) {
+        return fmt::format("Class {} is not registered", typeid(*prototype).name());
+    }
+    if (!cls->canCreate()) {
+        return fmt::format("{} can not be created by the runtime", cls->name());
+    }
+    m_class = cls;
+    m_zOrder = prototype->getZOrder();
+    m_properties.clear();
+    m_groups.clear();
+    m_children.clear();
+
+    for (auto const& [name, prop] : cls->allProperties()) {
+        if (prop->group) {
+            auto seen = std::any_of(m_groups.begin(), m_groups.end(), [&](Group const& g) {
+                return g.group == prop->group;
+            });
+            if (!seen) {
+                auto& group = m_groups.emplace_back(Group { prop->group, {} });
+                prop->group->load(prototype, group.values);
+            }
+            continue;
+        }
+        if (!prop->setter) {
+            continue;
+        }
+        auto value = prop->getter(vm, prototype);
+        if (vm.error()) {
+            return vm.formatError(*vm.error());
+        }
+        // References to other objects can't be shared between instances, so
+        // objects like layouts are created again for every instance
+        if (value.is(ValueType::Object)) {
+            auto object = value.asObject();
+            if (!object) {
+                continue;
+            }
+            auto objectClass = nativeClassOf(classKeyOf(object), object);
+            if (!objectClass || !objectClass->canCreate()) {
+                return fmt::format(
+                    "The {} of {} can not be created by the runtime",
+                    SymbolTable::get().string(name)->view(), cls->name()
+                );
+            }
+            m_properties.push_back(Property { prop, Value(), objectClass });
+            continue;
+        }
+        m_properties.push_back(Property { prop, persistent(value) });
+    }
+
+    if (auto arr = prototype->getChildren()) {
+        for (auto child : CCArrayExt<CCNode*>(arr)) {
+            if (auto err = m_children.emplace_back().capture(vm, child)) {
+                return err;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+CCNode* NodeTemplate::build(VM& vm) const {
+    auto node = static_cast<CCNode*>(m_class->create());
+    for (auto const& [prop, value, objectClass] : m_properties) {
+        prop->setter(vm, node, objectClass ? Value::fromObject(objectClass->create()) : value);
+    }
+    for (auto const& group : m_groups) {
+        group.group->apply(node, group.values);
+    }
+    for (auto const& child : m_children) {
+        auto built = child.build(vm);
+        node->addChild(built, child.m_zOrder);
+        markBuilt(built);
+    }
+    if (!m_children.empty()) {
+        LayoutBatch::get().invalidate(node);
+    }
+    return node;
+}
+
+CCNode* NodeTemplate::instantiate(VM& vm, std::span<const TemplateDiff> diffs) const {
+    auto node = this->build(vm);
+    node->setZOrder(m_zOrder);
+    for (auto const& diff : diffs) {
+        applyTemplateDiff(vm, node, diff);
+    }
+    return node;
+}
+
+void dash::applyTemplateDiff(VM& vm, CCNode* root, TemplateDiff const& diff) {
+    auto node = diff.node.empty() ? root : root->getChildByIDRecursive(std::string(diff.node));
+    if (!node) {
+        log::error("Template has no node with ID '{}'", diff.node);
+        return;
+    }
+    auto cls = nativeClassOf(classKeyOf(node), node);
+    auto prop = cls ? cls->findProperty(diff.property) : nullptr;
+    if (!prop) {
+        log::error(
+            "{} has no property '{}'", cls ? cls->name() : "Node",
+            SymbolTable::get().string(diff.property)->view()
+        );
+        return;
+    }
+    if (prop->group) {
+        if (!prop->check(vm, diff.value)) {
+            log::error("{}", vm.formatError(*vm.error()));
+            return;
+        }
+        prop->group->write(node, prop->component, diff.value);
+    }
+    else if (prop->setter) {
+        prop->setter(vm, node, diff.value);
+    }
+    else {
+        log::error("Property '{}' is read-only", SymbolTable::get().string(diff.property)->view());
+    }
+}
+
+TemplateCache& TemplateCache::get() {
+    static TemplateCache cache;
+    return cache;
+}
+
+CCNode* TemplateCache::instantiate(
+    VM& vm, std::string_view key,
+    std::function<CCNode*()> const& build,
+    std::span<const TemplateDiff> diffs
+) {
+    auto it = m_templates.find(std::string(key));
+    if (it != m_templates.end()) {
+        return it->second.instantiate(vm, diffs);
+    }
+    auto prototype = build();
+    if (!prototype) {
+        return nullptr;
+    }
+    NodeTemplate tmpl;
+    if (auto err = tmpl.capture(vm, prototype)) {
+        // The tree still works, it just has to be built every time
+        log::warn("Unable to make a template of {}: {}", key, *err);
+    }
+    else {
+        m_templates.insert({ std::string(key), std::move(tmpl) });
+    }
+    for (auto const& diff : diffs) {
+        applyTemplateDiff(vm, prototype, diff);
+    }
+    return prototype;
+}
+
+void TemplateCache::clear() {
+    m_templates.clear();
+}
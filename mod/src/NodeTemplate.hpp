@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include "lang/NativeClass.hpp"
+#include "lang/Symbol.hpp"
+#include "lang/VM.hpp"
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dash {
+    /// A per-instance change to a node created from a template
+    struct TemplateDiff {
+        /// ID of the node in the template to change, or empty for the root
+        std::string_view node;
+        lang::Symbol property;
+        lang::Value value;
+    };
+
+    /// A captured node tree that can be instanced any number of times without
+    /// running the code that originally built it. Instancing creates every
+    /// node through its class's factory and assigns the captured property
+    /// values directly, so no names are looked up and nothing is interpreted
+    ///
+    /// Only properties registered on the nodes' native classes are captured,
+    /// along with the tree structure and z-order. Objects assigned to
+    /// properties, like layouts, are captured by class: every instance gets
+    /// a new object created through the class's factory
+    class NodeTemplate final {
+    private:
+        struct Property {
+            lang::NativeProperty const* property;
+            lang::Value value;
+            /// For object properties, the class of the object to create for
+            /// each instance instead of using `value`
+            lang::NativeClass const* objectClass = nullptr;
+        };
+        struct Group {
+            lang::PropertyGroup const* group;
+            lang::Value values[lang::PropertyGroup::MAX_COMPONENTS];
+        };
+
+        lang::NativeClass const* m_class = nullptr;
+        int m_zOrder = 0;
+        std::vector<Property> m_properties;
+        /// Grouped properties are applied a whole group at a time
+        std::vector<Group> m_groups;
+        std::vector<NodeTemplate> m_children;
+
+        cocos2d::CCNode* build(lang::VM& vm) const;
+
+    public:
+        /// Capture a node and its children. Returns an error if the tree
+        /// contains a node that the runtime can't create
+        std::optional<std::string> capture(lang::VM& vm, cocos2d::CCNode* prototype);
+
+        /// Create a new instance of the tree, then apply `diffs` to it. The
+        /// returned node is autoreleased
+        cocos2d::CCNode* instantiate(lang::VM& vm, std::span<const TemplateDiff> diffs = {}) const;
+    };
+
+    /// Apply a change to a node or its descendant, logging an error if the
+    /// property does not exist
+    void applyTemplateDiff(lang::VM& vm, cocos2d::CCNode* root, TemplateDiff const& diff);
+
+    /// Templates of repeated UI elements, so they're only built by running
+    /// their code once. Scripts use it through Std's `instantiate`
+    class TemplateCache final {
+    private:
+        std::unordered_map<std::string, NodeTemplate> m_templates;
+
+        TemplateCache() = default;
+
+    public:
+        static TemplateCache& get();
+
+        /// Create an instance of the template for `key`. The first time a key
+        /// is used the tree is built with `build` and captured as the key's
+        /// template. `key` should identify the code that builds the tree
+        cocos2d::CCNode* instantiate(
+            lang::VM& vm, std::string_view key,
+            std::function<cocos2d::CCNode*()> const& build,
+            std::span<const TemplateDiff> diffs = {}
+        );
+        /// Forget all templates, for example because the code that built
+        /// them has changed
+        void clear();
+    };
+}
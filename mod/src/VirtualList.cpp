@@ -0,0 +1,163 @@
+#include "VirtualList.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace dash;
+using namespace geode::prelude;
+
+bool VirtualList::init(CCSize const& size, float itemHeight, CreateItem create, BindItem bind) {
+    if (!CCLayer::init()) {
+        return false;
+    }
+    m_create = std::move(create);
+    m_bind = std::move(bind);
+    m_itemHeight = std::max(itemHeight, 1.f);
+    this->setContentSize(size);
+    this->setTouchEnabled(true);
+    this->setMouseEnabled(true);
+    return true;
+}
+
+VirtualList* VirtualList::create(CCSize const& size, float itemHeight, CreateItem create, BindItem bind) {
+    auto ret = new VirtualList();
+    if (ret->init(size, itemHeight, std::move(create), std::move(bind))) {
+        ret->autorelease();
+        return ret;
+    }
+    delete ret;
+    return nullptr;
+}
+
+void VirtualList::updateItems() {
+    if (!m_create || !m_bind) {
+        return;
+    }
+    auto height = this->getContentSize().height;
+    auto first = static_cast<size_t>(std::max(std::floor(m_scroll / m_itemHeight), 0.f));
+    auto last = std::min(m_count, static_cast<size_t>(std::ceil((m_scroll + height) / m_itemHeight)));
+
+    // Recycle the items that have left the viewport
+    std::erase_if(m_items, [&](Item const& item) {
+        if (item.index >= first && item.index < last) {
+            return false;
+        }
+        item.node->setVisible(false);
+        m_recycled.push_back(item.node);
+        return true;
+    });
+
+    for (auto index = first; index < last; index += 1) {
+        auto it = std::find_if(m_items.begin(), m_items.end(), [&](Item const& item) {
+            return item.index == index;
+        });
+        CCNode* node;
+        if (it != m_items.end()) {
+            node = it->node;
+        }
+        else {
+            if (!m_recycled.empty()) {
+                node = m_recycled.back();
+                m_recycled.pop_back();
+                node->setVisible(true);
+            }
+            else {
+                node = m_create();
+                if (!node) {
+                    continue;
+                }
+                this->addChild(node);
+            }
+            m_items.push_back(Item { node, index });
+            m_bind(node, index);
+        }
+        // Items are laid out from the top down
+        node->setPosition(ccp(0, height - (index + 1) * m_itemHeight + m_scroll));
+    }
+}
+
+void VirtualList::setContentSize(CCSize const& size) {
+    CCLayer::setContentSize(size);
+    m_scroll = std::min(m_scroll, this->getMaxScroll());
+    this->updateItems();
+}
+
+size_t VirtualList::getCount() const {
+    return m_count;
+}
+
+void VirtualList::setCount(size_t count) {
+    m_count = count;
+    m_scroll = std::min(m_scroll, this->getMaxScroll());
+    this->reload();
+}
+
+float VirtualList::getItemHeight() const {
+    return m_itemHeight;
+}
+
+void VirtualList::setItemHeight(float height) {
+    m_itemHeight = std::max(height, 1.f);
+    m_scroll = std::min(m_scroll, this->getMaxScroll());
+    this->updateItems();
+}
+
+float VirtualList::getScroll() const {
+    return m_scroll;
+}
+
+void VirtualList::setScroll(float scroll) {
+    m_scroll = std::clamp(scroll, 0.f, this->getMaxScroll());
+    this->updateItems();
+}
+
+float VirtualList::getMaxScroll() const {
+    return std::max(m_count * m_itemHeight - this->getContentSize().height, 0.f);
+}
+
+void VirtualList::setItems(CreateItem create, BindItem bind) {
+    for (auto const& item : m_items) {
+        item.node->removeFromParent();
+    }
+    for (auto const& node : m_recycled) {
+        node->removeFromParent();
+    }
+    m_items.clear();
+    m_recycled.clear();
+    m_create = std::move(create);
+    m_bind = std::move(bind);
+    this->updateItems();
+}
+
+void VirtualList::reload() {
+    for (auto const& item : m_items) {
+        item.node->setVisible(false);
+        m_recycled.push_back(item.node);
+    }
+    m_items.clear();
+    this->updateItems();
+}
+
+void VirtualList::registerWithTouchDispatcher() {
+    CCDirector::sharedDirector()->getTouchDispatcher()->addTargetedDelegate(this, 0, true);
+}
+
+bool VirtualList::ccTouchBegan(CCTouch* touch, CCEvent*) {
+    auto pos = this->convertToNodeSpace(touch->getLocation());
+    auto size = this->getContentSize();
+    if (pos.x < 0 || pos.y < 0 || pos.x > size.width || pos.y > size.height) {
+        return false;
+    }
+    m_lastTouch = touch->getLocation();
+    return true;
+}
+
+void VirtualList::ccTouchMoved(CCTouch* touch, CCEvent*) {
+    // Dragging up scrolls further down the list
+    auto delta = touch->getLocation().y - m_lastTouch.y;
+    m_lastTouch = touch->getLocation();
+    this->setScroll(m_scroll + delta);
+}
+
+void VirtualList::scrollWheel(float y, float) {
+    this->setScroll(m_scroll + y);
+}
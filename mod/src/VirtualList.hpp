@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Geode/DefaultInclude.hpp>
+#include <functional>
+#include <vector>
+
+namespace dash {
+    /// A vertical list that only creates nodes for the items currently in
+    /// its viewport. Nodes that scroll out of view are recycled for the items
+    /// scrolling in, so a list of thousands of items only ever has a
+    /// screenful of nodes. Items that are only partly in view overflow the
+    /// list, so it should usually be put in a clipping node. A list without
+    /// item callbacks is empty
+    class VirtualList : public cocos2d::CCLayer {
+    public:
+        /// Create a node for an item. Its contents are filled by `BindItem`
+        using CreateItem = std::function<cocos2d::CCNode*()>;
+        /// Fill a node with the contents of an item. The node may have shown
+        /// a different item before
+        using BindItem = std::function<void(cocos2d::CCNode* item, size_t index)>;
+
+    protected:
+        struct Item {
+            geode::Ref<cocos2d::CCNode> node;
+            size_t index;
+        };
+
+        CreateItem m_create;
+        BindItem m_bind;
+        size_t m_count = 0;
+        float m_itemHeight = 0;
+        float m_scroll = 0;
+        std::vector<Item> m_items;
+        /// Nodes that have scrolled out of view, ready to be rebound
+        std::vector<geode::Ref<cocos2d::CCNode>> m_recycled;
+        cocos2d::CCPoint m_lastTouch;
+
+        bool init(cocos2d::CCSize const& size, float itemHeight, CreateItem create, BindItem bind);
+        /// Make the materialized items match the items in view
+        void updateItems();
+
+        void registerWithTouchDispatcher() override;
+        bool ccTouchBegan(cocos2d::CCTouch* touch, cocos2d::CCEvent* event) override;
+        void ccTouchMoved(cocos2d::CCTouch* touch, cocos2d::CCEvent* event) override;
+        void scrollWheel(float y, float x) override;
+
+    public:
+        static VirtualList* create(cocos2d::CCSize const& size, float itemHeight, CreateItem create, BindItem bind);
+
+        /// Resizing changes which items are in view
+        void setContentSize(cocos2d::CCSize const& size) override;
+
+        size_t getCount() const;
+        /// Change the number of items. Items that stay in view are bound
+        /// again, since their contents may have changed
+        void setCount(size_t count);
+        float getItemHeight() const;
+        void setItemHeight(float height);
+        /// How far the list is scrolled from the top
+        float getScroll() const;
+        void setScroll(float scroll);
+        float getMaxScroll() const;
+        /// Change how items are created and filled in. Existing item nodes
+        /// are thrown away
+        void setItems(CreateItem create, BindItem bind);
+        /// Bind every item in view again, for example after the data source
+        /// has changed
+        void reload();
+    };
+}
@@ -0,0 +1,59 @@
+#include "Arena.hpp"
+#include <algorithm>
+
+using namespace dash::lang;
+
+void* Arena::allocateSlow(size_t size, size_t align) {
+    auto needed = size + align - 1;
+    // Chunks after the current one are left over from before the last reset
+    auto next = m_chunks.empty() ? 0 : m_current + 1;
+    auto it = std::find_if(m_chunks.begin() + next, m_chunks.end(), [&](Chunk const& chunk) {
+        return chunk.size >= needed;
+    });
+    if (it == m_chunks.end()) {
+        auto chunkSize = m_chunks.empty() ? CHUNK_SIZE : m_chunks.back().size * 2;
+        chunkSize = std::max(chunkSize, needed);
+        m_chunks.push_back(Chunk { std::make_unique_for_overwrite<uint8_t[]>(chunkSize), chunkSize });
+        it = m_chunks.end() - 1;
+    }
+    // Keep the chunks that are in use in front of the free ones
+    std::iter_swap(m_chunks.begin() + next, it);
+    m_current = next;
+    m_ptr = m_chunks[next].data.get();
+    m_end = m_ptr + m_chunks[next].size;
+    return this->allocate(size, align);
+}
+
+void Arena::reset() {
+    m_current = 0;
+    if (m_chunks.empty()) {
+        m_ptr = m_end = nullptr;
+    }
+    else {
+        m_ptr = m_chunks.front().data.get();
+        m_end = m_ptr + m_chunks.front().size;
+    }
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (auto const& chunk : m_chunks) {
+        total += chunk.size;
+    }
+    return total;
+}
+
+bool Arena::owns(void const* ptr) const {
+    auto p = static_cast<uint8_t const*>(ptr);
+    return std::any_of(m_chunks.begin(), m_chunks.end(), [p](Chunk const& chunk) {
+        return p >= chunk.data.get() && p < chunk.data.get() + chunk.size;
+    });
+}
+
+std::span<const uint8_t> Arena::currentChunk() const {
+    if (m_chunks.empty()) {
+        return {};
+    }
+    auto const& chunk = m_chunks[m_current];
+    return std::span(chunk.data.get(), chunk.size);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dash::lang {
+    /// A bump allocator for short-lived runtime state. Allocations are never
+    /// freed individually; instead the whole arena is rewound with `reset`
+    /// once nothing allocated from it is referenced anymore. Rewinding keeps
+    /// the arena's memory around, so a warmed-up arena doesn't allocate at all
+    class Arena final {
+    public:
+        /// Size of the first chunk; later chunks double in size
+        static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    private:
+        struct Chunk {
+            std::unique_ptr<uint8_t[]> data;
+            size_t size;
+        };
+
+        std::vector<Chunk> m_chunks;
+        /// Index of the chunk currently being allocated from
+        size_t m_current = 0;
+        uint8_t* m_ptr = nullptr;
+        uint8_t* m_end = nullptr;
+
+        void* allocateSlow(size_t size, size_t align);
+
+    public:
+        Arena() = default;
+
+        Arena(Arena const&) = delete;
+        Arena& operator=(Arena const&) = delete;
+
+        /// Allocate uninitialized memory. `align` must be a power of two
+        void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+            auto addr = reinterpret_cast<uintptr_t>(m_ptr);
+            auto aligned = (addr + align - 1) & ~(align - 1);
+            if (m_ptr && aligned + size <= reinterpret_cast<uintptr_t>(m_end)) {
+                m_ptr = reinterpret_cast<uint8_t*>(aligned + size);
+                return reinterpret_cast<void*>(aligned);
+            }
+            return this->allocateSlow(size, align);
+        }
+        /// Construct an object in the arena. Destructors are never run, so
+        /// only trivially destructible types can be allocated
+        template <class T, class... Args>
+        T* make(Args&&... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+            return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /// Invalidate everything allocated from the arena, keeping its memory
+        /// for reuse
+        void reset();
+
+        /// Total amount of memory owned by the arena, in bytes
+        size_t capacity() const;
+        /// Whether a pointer points into memory owned by the arena
+        bool owns(void const* ptr) const;
+        /// The chunk that is currently being allocated from, or an empty
+        /// span if nothing has been allocated yet
+        std::span<const uint8_t> currentChunk() const;
+    };
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "NativeClass.hpp"
+#include "VM.hpp"
+#include <concepts>
+#include <fmt/format.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Compile-time bindings of C++ functions to natives and native properties.
+// `bind<&print>()` generates a NativeFunction that type checks and unpacks
+// its arguments straight from the VM's registers and calls `print` directly;
+// there is no type erasure or boxing between the script and the function.
+//
+//     registerNative("print", bind<&print>());
+//     addProperty<&CCLabelBMFont::getString, &CCLabelBMFont::setString>(label, "text");
+
+namespace dash::lang {
+    /// Converts between Values and a C++ type. Specialize this to make more
+    /// types usable in bindings
+    template <class T>
+    struct Marshal;
+
+    template <>
+    struct Marshal<bool> {
+        static constexpr char const* NAME = "bool";
+        static bool check(Value const& value) {
+            return value.is(ValueType::Bool);
+        }
+        static bool from(Value const& value) {
+            return value.asBool();
+        }
+        static Value to(VM&, bool value) {
+            return Value::fromBool(value);
+        }
+    };
+
+    template <class T>
+        requires std::integral<T> && (!std::same_as<T, bool>)
+    struct Marshal<T> {
+        static constexpr char const* NAME = "int";
+        static bool check(Value const& value) {
+            return value.is(ValueType::Int);
+        }
+        static T from(Value const& value) {
+            return static_cast<T>(value.asInt());
+        }
+        static Value to(VM&, T value) {
+            return Value::fromInt(static_cast<int64_t>(value));
+        }
+    };
+
+    template <std::floating_point T>
+    struct Marshal<T> {
+        static constexpr char const* NAME = "float";
+        // Ints are implicitly converted to floats, like in arithmetic
+        static bool check(Value const& value) {
+            return value.is(ValueType::Float) || value.is(ValueType::Int);
+        }
+        static T from(Value const& value) {
+            return static_cast<T>(value.asNumber());
+        }
+        static Value to(VM&, T value) {
+            return Value::fromFloat(static_cast<double>(value));
+        }
+    };
+
+    /// Strings are passed as views into the VM's strings without copying.
+    /// Arguments are only valid until the native returns
+    template <>
+    struct Marshal<std::string_view> {
+        static constexpr char const* NAME = "string";
+        static bool check(Value const& value) {
+            return value.is(ValueType::String);
+        }
+        static std::string_view from(Value const& value) {
+            return value.asString()->view();
+        }
+        static Value to(VM& vm, std::string_view value) {
+            return Value::fromString(vm.makeString(value));
+        }
+    };
+
+    /// VM strings are always NUL-terminated, so they can be passed to C APIs
+    /// without copying
+    template <>
+    struct Marshal<char const*> {
+        static constexpr char const* NAME = "string";
+        static bool check(Value const& value) {
+            return value.is(ValueType::String);
+        }
+        static char const* from(Value const& value) {
+            return value.asString()->data;
+        }
+        static Value to(VM& vm, char const* value) {
+            return Value::fromString(vm.makeString(value ? value : ""));
+        }
+    };
+
+    template <>
+    struct Marshal<std::string> {
+        static constexpr char const* NAME = "string";
+        static bool check(Value const& value) {
+            return value.is(ValueType::String);
+        }
+        static std::string from(Value const& value) {
+            return std::string(value.asString()->view());
+        }
+        static Value to(VM& vm, std::string const& value) {
+            return Value::fromString(vm.makeString(value));
+        }
+    };
+
+    /// Native objects. The object's class is not checked, since Values don't
+    /// know what they point to
+    template <class T>
+        requires std::is_class_v<T>
+    struct Marshal<T*> {
+        static constexpr char const* NAME = "object";
+        static bool check(Value const& value) {
+            return value.is(ValueType::Object);
+        }
+        static T* from(Value const& value) {
+            return value.asObject<T>();
+        }
+        static Value to(VM&, T* value) {
+            return Value::fromObject(const_cast<std::remove_const_t<T>*>(value));
+        }
+    };
+
+    template <class T>
+    using MarshalFor = Marshal<std::remove_cvref_t<T>>;
+
+    namespace detail {
+        /// Decomposes function and member function pointers. Member functions
+        /// are treated as functions taking the object as their first argument
+        template <class F>
+        struct FunctionTraits;
+
+        template <class R, class... A>
+        struct FunctionTraits<R(*)(A...)> {
+            using Return = R;
+            using Args = std::tuple<A...>;
+        };
+        template <class R, class... A>
+        struct FunctionTraits<R(*)(A...) noexcept> : FunctionTraits<R(*)(A...)> {};
+        template <class R, class C, class... A>
+        struct FunctionTraits<R(C::*)(A...)> {
+            using Return = R;
+            using Args = std::tuple<C*, A...>;
+        };
+        template <class R, class C, class... A>
+        struct FunctionTraits<R(C::*)(A...) const> {
+            using Return = R;
+            using Args = std::tuple<C const*, A...>;
+        };
+        template <class R, class C, class... A>
+        struct FunctionTraits<R(C::*)(A...) noexcept> : FunctionTraits<R(C::*)(A...)> {};
+        template <class R, class C, class... A>
+        struct FunctionTraits<R(C::*)(A...) const noexcept> : FunctionTraits<R(C::*)(A...) const> {};
+
+        template <auto Fn>
+        using Args = typename FunctionTraits<decltype(Fn)>::Args;
+        template <auto Fn>
+        using Return = typename FunctionTraits<decltype(Fn)>::Return;
+
+        template <auto Fn, class... A>
+        decltype(auto) invoke(A&&... args) {
+            return std::invoke(Fn, std::forward<A>(args)...);
+        }
+
+        /// Call `Fn` with `args` unpacked into its parameters, returning the
+        /// result as a Value
+        template <auto Fn, size_t... I>
+        Value call(VM& vm, Value const* args, std::index_sequence<I...>) {
+            using A = Args<Fn>;
+            if constexpr (std::is_void_v<Return<Fn>>) {
+                invoke<Fn>(MarshalFor<std::tuple_element_t<I, A>>::from(args[I])...);
+                return Value();
+            }
+            else {
+                return MarshalFor<Return<Fn>>::to(
+                    vm, invoke<Fn>(MarshalFor<std::tuple_element_t<I, A>>::from(args[I])...)
+                );
+            }
+        }
+
+        /// Check that `args` have the types `Fn` expects
+        template <auto Fn, size_t... I>
+        bool check(VM& vm, Value const* args, std::index_sequence<I...>) {
+            using A = Args<Fn>;
+            size_t failed = 0;
+            bool ok = ((MarshalFor<std::tuple_element_t<I, A>>::check(args[I]) || (failed = I, false)) && ...);
+            if (!ok) {
+                char const* expected = nullptr;
+                ((failed == I ? (expected = MarshalFor<std::tuple_element_t<I, A>>::NAME) : nullptr), ...);
+                vm.raise(fmt::format(
+                    "Argument {} has type {}, expected {}",
+                    failed + 1, valueTypeName(args[failed].type()), expected
+                ));
+            }
+            return ok;
+        }
+    }
+
+    /// Generate a native that calls `Fn`. `Fn` can be a function pointer or
+    /// a member function pointer, in which case the object is the native's
+    /// first argument
+    template <auto Fn>
+    constexpr NativeFunction bind() {
+        return +[](VM& vm, std::span<const Value> args) {
+            constexpr auto ARITY = std::tuple_size_v<detail::Args<Fn>>;
+            if (args.size() != ARITY) {
+                vm.raise(fmt::format("Expected {} arguments, got {}", ARITY, args.size()));
+                return Value();
+            }
+            if (!detail::check<Fn>(vm, args.data(), std::make_index_sequence<ARITY>())) {
+                return Value();
+            }
+            return detail::call<Fn>(vm, args.data(), std::make_index_sequence<ARITY>());
+        };
+    }
+
+    /// Generate a property getter that calls `Fn` on the object. `Fn` must
+    /// take only the object, like `&CCNode::getPositionX`
+    template <auto Fn>
+    constexpr PropertyGetter bindGetter() {
+        static_assert(std::tuple_size_v<detail::Args<Fn>> == 1, "Getters only take the object");
+        using Object = std::tuple_element_t<0, detail::Args<Fn>>;
+        return +[](VM& vm, void* object) {
+            return MarshalFor<detail::Return<Fn>>::to(
+                vm, detail::invoke<Fn>(static_cast<Object>(object))
+            );
+        };
+    }
+
+    /// Generate a check that a value can be assigned to a property of type T
+    template <class T>
+    constexpr PropertyCheck bindCheck() {
+        return +[](VM& vm, Value const& value) {
+            if (!MarshalFor<T>::check(value)) {
+                vm.raise(fmt::format(
+                    "Cannot assign a value of type {} to a property of type {}",
+                    valueTypeName(value.type()), MarshalFor<T>::NAME
+                ));
+                return false;
+            }
+            return true;
+        };
+    }
+
+    /// Generate a property setter that calls `Fn` on the object with the new
+    /// value, like `&CCNode::setPositionX`
+    template <auto Fn>
+    constexpr PropertySetter bindSetter() {
+        static_assert(std::tuple_size_v<detail::Args<Fn>> == 2, "Setters take the object and the value");
+        using Object = std::tuple_element_t<0, detail::Args<Fn>>;
+        using Arg = MarshalFor<std::tuple_element_t<1, detail::Args<Fn>>>;
+        return +[](VM& vm, void* object, Value value) {
+            if (!bindCheck<std::tuple_element_t<1, detail::Args<Fn>>>()(vm, value)) {
+                return;
+            }
+            detail::invoke<Fn>(static_cast<Object>(object), Arg::from(value));
+        };
+    }
+
+    /// Add a property that is written through a group, like a node's `x`
+    /// through its position. Its type is the return type of `Getter`
+    template <auto Getter>
+    NativeClass& addGroupedProperty(NativeClass& cls, std::string_view name, PropertyGroup const& group, uint8_t component) {
+        using T = std::remove_cvref_t<detail::Return<Getter>>;
+        static_assert(
+            std::is_arithmetic_v<T>,
+            "Grouped properties are staged across calls, so they can't be strings or objects"
+        );
+        return cls.addGroupedProperty(name, bindGetter<Getter>(), bindCheck<T>(), group, component);
+    }
+
+    /// Add a property whose getter and setter are bound at compile time
+    template <auto Getter, auto Setter = nullptr>
+    NativeClass& addProperty(NativeClass& cls, std::string_view name) {
+        if constexpr (std::is_null_pointer_v<decltype(Setter)>) {
+            return cls.addProperty(name, bindGetter<Getter>());
+        }
+        else {
+            return cls.addProperty(name, bindGetter<Getter>(), bindSetter<Setter>());
+        }
+    }
+}
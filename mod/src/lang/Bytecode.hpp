@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dash::lang {
+    // The opcode list and encodings must be kept in sync with the compiler's
+    // bytecode emitter
+
+    /// Register-based opcodes. `R[x]` is register x of the current frame,
+    /// `K[x]` is constant x of the module and `G[x]` is global x
+    enum class Op : uint8_t {
+        /// Do nothing
+        Nop,
+        /// R[A] = R[B]
+        Move,
+        /// R[A] = K[Bx]
+        LoadConst,
+        /// R[A] = sBx
+        LoadInt,
+        /// R[A] = (B != 0)
+        LoadBool,
+        /// R[A] = void
+        LoadVoid,
+        /// R[A] = function Bx
+        LoadFunction,
+        /// R[A] = G[Bx]
+        GetGlobal,
+        /// G[Bx] = R[A]
+        SetGlobal,
+        /// R[A] = R[A].P[Bx], where P[Bx] is property access site Bx of the
+        /// module. Every site has its own inline cache
+        GetProp,
+        /// R[A].P[Bx] = R[A + 1]
+        SetProp,
+
+        /// R[A] = R[B] + R[C]
+        Add,
+        /// R[A] = R[B] - R[C]
+        Sub,
+        /// R[A] = R[B] * R[C]
+        Mul,
+        /// R[A] = R[B] / R[C]
+        Div,
+        /// R[A] = R[B] % R[C]
+        Mod,
+        /// R[A] = -R[B]
+        Neg,
+        /// R[A] = !R[B]
+        Not,
+
+        /// R[A] = R[B] == R[C]
+        Eq,
+        /// R[A] = R[B] != R[C]
+        Neq,
+        /// R[A] = R[B] < R[C]
+        Less,
+        /// R[A] = R[B] <= R[C]
+        Leq,
+        /// R[A] = R[B] > R[C]
+        Grt,
+        /// R[A] = R[B] >= R[C]
+        Geq,
+
+        // Typed arithmetic, emitted when the checker has already resolved
+        // both operands to the same primitive type. These skip all type
+        // tests; an operand of the wrong type gives a wrong result, but can
+        // never read outside the value
+
+        /// R[A] = R[B] + R[C] for ints
+        AddInt,
+        /// R[A] = R[B] - R[C] for ints
+        SubInt,
+        /// R[A] = R[B] * R[C] for ints
+        MulInt,
+        /// R[A] = R[B] < R[C] for ints
+        LessInt,
+        /// R[A] = R[B] <= R[C] for ints
+        LeqInt,
+        /// R[A] = R[B] + R[C] for floats
+        AddFloat,
+        /// R[A] = R[B] - R[C] for floats
+        SubFloat,
+        /// R[A] = R[B] * R[C] for floats
+        MulFloat,
+        /// R[A] = R[B] / R[C] for floats
+        DivFloat,
+        /// R[A] = R[B] < R[C] for floats
+        LessFloat,
+        /// R[A] = R[B] <= R[C] for floats
+        LeqFloat,
+
+        /// ip += sBx
+        Jump,
+        /// if R[A] then ip += sBx
+        JumpIf,
+        /// if !R[A] then ip += sBx
+        JumpIfNot,
+
+        /// Call function Bx with the arguments in R[A]..; the result is
+        /// written to R[A]. The callee's register window starts at R[A], so
+        /// arguments are never copied
+        Call,
+        /// Like Call, but the function is read from R[B]
+        CallValue,
+        /// Call native import Bx with the arguments in R[A]..; the result is
+        /// written to R[A]
+        CallNative,
+        /// Return R[A] to the caller
+        Return,
+        /// Return void to the caller
+        ReturnVoid,
+        /// Start async function Bx as a new task with the arguments in
+        /// R[A]..; R[A] is set to void
+        Spawn,
+        /// Suspend the current task until the next frame
+        Yield,
+    };
+
+    /// A single fixed-width instruction. Layout, from the lowest bits:
+    ///  - `op`: 8 bits
+    ///  - `A`: 8 bits
+    ///  - `B`: 8 bits, `C`: 8 bits, or alternatively `Bx`: 16 bits
+    class Instr final {
+    private:
+        uint32_t m_bits;
+
+    public:
+        constexpr Instr() : m_bits(0) {}
+        constexpr explicit Instr(uint32_t bits) : m_bits(bits) {}
+
+        static constexpr Instr abc(Op op, uint8_t a, uint8_t b, uint8_t c) {
+            return Instr(
+                static_cast<uint32_t>(op) |
+                static_cast<uint32_t>(a) << 8 |
+                static_cast<uint32_t>(b) << 16 |
+                static_cast<uint32_t>(c) << 24
+            );
+        }
+        static constexpr Instr abx(Op op, uint8_t a, uint16_t bx) {
+            return Instr(
+                static_cast<uint32_t>(op) |
+                static_cast<uint32_t>(a) << 8 |
+                static_cast<uint32_t>(bx) << 16
+            );
+        }
+        static constexpr Instr asbx(Op op, uint8_t a, int16_t sbx) {
+            return abx(op, a, static_cast<uint16_t>(sbx));
+        }
+
+        constexpr Op op() const {
+            return static_cast<Op>(m_bits & 0xff);
+        }
+        constexpr uint8_t a() const {
+            return (m_bits >> 8) & 0xff;
+        }
+        constexpr uint8_t b() const {
+            return (m_bits >> 16) & 0xff;
+        }
+        constexpr uint8_t c() const {
+            return (m_bits >> 24) & 0xff;
+        }
+        constexpr uint16_t bx() const {
+            return static_cast<uint16_t>(m_bits >> 16);
+        }
+        constexpr int16_t sbx() const {
+            return static_cast<int16_t>(m_bits >> 16);
+        }
+        constexpr uint32_t bits() const {
+            return m_bits;
+        }
+    };
+
+    static_assert(sizeof(Instr) == 4);
+
+    enum class ConstantType : uint8_t {
+        Int,
+        Float,
+        String,
+    };
+
+    /// An entry in a module's constant pool. Strings are stored as offsets
+    /// into the module's string table
+    struct Constant {
+        ConstantType type;
+        uint8_t _pad[7];
+        union {
+            int64_t intValue;
+            double floatValue;
+            uint64_t stringOffset;
+        };
+    };
+
+    static_assert(sizeof(Constant) == 16);
+
+    struct FunctionProto {
+        /// Index of the function's first instruction in the module's code
+        uint32_t codeOffset;
+        /// Number of instructions in the function
+        uint32_t codeSize;
+        /// Offset of the function's name in the string table
+        uint32_t name;
+        /// Number of registers the function's frame needs, including
+        /// parameters
+        uint16_t registerCount;
+        uint8_t paramCount;
+        /// `FUNCTION_*` flags
+        uint8_t flags;
+    };
+
+    static_assert(sizeof(FunctionProto) == 16);
+
+    /// Register operands are 8 bits, so no frame can address more registers
+    /// than this
+    constexpr uint16_t MAX_REGISTERS = 256;
+
+    /// Calling the function starts a task instead of running it on the
+    /// caller's stack
+    constexpr uint8_t FUNCTION_ASYNC = 1 << 0;
+
+    /// A native function the module calls into, resolved by name on load
+    struct NativeImport {
+        /// Offset of the function's name in the string table
+        uint32_t name;
+        uint8_t paramCount;
+        uint8_t _pad[3];
+    };
+
+    static_assert(sizeof(NativeImport) == 8);
+}
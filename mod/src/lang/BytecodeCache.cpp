@@ -0,0 +1,90 @@
+#include "BytecodeCache.hpp"
+#include "Compiler.hpp"
+#include <fstream>
+#include <fmt/format.h>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+using namespace dash::lang;
+
+// 64-bit FNV-1a. The cache only needs to tell sources apart, not resist
+// anyone crafting collisions
+static uint64_t hashBytes(std::string_view data, uint64_t hash = 0xcbf29ce484222325) {
+    for (auto c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+static std::string entryPrefix(std::filesystem::path const& source) {
+    auto path = std::filesystem::absolute(source).lexically_normal().u8string();
+    return fmt::format("{:016x}-", hashBytes(std::string_view(
+        reinterpret_cast<char const*>(path.data()), path.size()
+    )));
+}
+
+BytecodeCache::BytecodeCache(std::filesystem::path dir) : m_dir(std::move(dir)) {}
+
+std::filesystem::path BytecodeCache::entryPath(std::filesystem::path const& source, std::string_view data) const {
+    // The source path is part of the key too since it ends up in the
+    // image's debug info
+    auto hash = hashBytes(data, hashBytes(compilerVersion()));
+    return m_dir / fmt::format("{}{:016x}.dashc", entryPrefix(source), hash);
+}
+
+std::optional<std::string> BytecodeCache::load(std::filesystem::path const& source, Module& module) {
+    std::ifstream file(source, std::ios::binary);
+    if (!file) {
+        return fmt::format("Unable to read {}", source.string());
+    }
+    std::string data { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    auto entry = this->entryPath(source, data);
+    std::error_code ec;
+    if (std::filesystem::exists(entry, ec)) {
+        if (!module.loadFromFile(entry)) {
+            return std::nullopt;
+        }
+        // The entry is corrupted, so just compile the source again
+    }
+
+    std::vector<uint8_t> image;
+    if (auto err = compile(source, data, image)) {
+        return err;
+    }
+
+    // Failing to update the cache only makes the next load slower, so
+    // errors from here on are ignored
+    std::filesystem::create_directories(m_dir, ec);
+    // Drop images of older versions of this source
+    auto prefix = entryPrefix(source);
+    std::vector<std::filesystem::path> stale;
+    for (auto const& old : std::filesystem::directory_iterator(m_dir, ec)) {
+        if (old.path().filename().string().starts_with(prefix)) {
+            stale.push_back(old.path());
+        }
+    }
+    for (auto const& old : stale) {
+        std::filesystem::remove(old, ec);
+    }
+    // Write to a temporary file first so a partially written image is never
+    // picked up by a later load. Sources may be loaded on several threads at
+    // once, so every thread writes its own
+    auto tmp = std::filesystem::path(entry).concat(fmt::format(
+        ".{:x}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id())
+    ));
+    if (std::ofstream out { tmp, std::ios::binary }) {
+        out.write(reinterpret_cast<char const*>(image.data()), image.size());
+        out.close();
+        if (out) {
+            std::filesystem::rename(tmp, entry, ec);
+        }
+        else {
+            std::filesystem::remove(tmp, ec);
+        }
+    }
+
+    return module.load(std::move(image));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Module.hpp"
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace dash::lang {
+    /// An on-disk cache of compiled module images. Images are keyed by the
+    /// path and contents of their source file and the version of the
+    /// compiler that produced them, so an unchanged source is mapped straight
+    /// from the cache without running the compiler at all
+    class BytecodeCache final {
+    private:
+        std::filesystem::path m_dir;
+
+        std::filesystem::path entryPath(std::filesystem::path const& source, std::string_view data) const;
+
+    public:
+        BytecodeCache(std::filesystem::path dir);
+
+        std::filesystem::path const& dir() const {
+            return m_dir;
+        }
+
+        /// Load the module for a source file, compiling it and storing the
+        /// result in the cache if there is no up-to-date image for it yet.
+        /// Returns an error if the source could not be read or compiled
+        std::optional<std::string> load(std::filesystem::path const& source, Module& module);
+    };
+}
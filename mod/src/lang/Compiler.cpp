@@ -0,0 +1,31 @@
+#include "Compiler.hpp"
+
+using namespace dash::lang;
+
+std::string_view dash::lang::compilerVersion() {
+    return dash_compiler_version();
+}
+
+std::optional<std::string> dash::lang::compile(
+    std::filesystem::path const& path, std::string_view source,
+    std::vector<uint8_t>& image
+) {
+    auto pathStr = path.u8string();
+    auto result = dash_compile(
+        reinterpret_cast<uint8_t const*>(pathStr.data()), pathStr.size(),
+        reinterpret_cast<uint8_t const*>(source.data()), source.size()
+    );
+    std::optional<std::string> err;
+    if (result.image) {
+        image.assign(result.image, result.image + result.imageSize);
+    }
+    else {
+        err = result.messages ? result.messages : "Compilation failed";
+    }
+    dash_free_compile_result(result);
+    return err;
+}
+
+bool dash::lang::loadCompilerStd(std::span<const uint8_t> image) {
+    return dash_load_std(image.data(), image.size());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The C interface of the Rust compiler, which is linked into the runtime as
+// a static library. Must be kept in sync with compiler/src/ffi.rs
+extern "C" {
+    struct DashCompileResult {
+        uint8_t* image;
+        size_t imageSize;
+        char* messages;
+    };
+
+    char const* dash_compiler_version();
+    DashCompileResult dash_compile(
+        uint8_t const* path, size_t pathLen,
+        uint8_t const* data, size_t dataLen
+    );
+    void dash_free_compile_result(DashCompileResult result);
+    bool dash_load_std(uint8_t const* image, size_t imageSize);
+}
+
+namespace dash::lang {
+    /// Identifies the embedded compiler. Images compiled by a different
+    /// compiler version must not be reused
+    std::string_view compilerVersion();
+
+    /// Compile a source file into a module image using the embedded
+    /// compiler. `path` is only used for diagnostics and debug info. Returns
+    /// the compiler's diagnostics if compilation failed
+    std::optional<std::string> compile(
+        std::filesystem::path const& path, std::string_view source,
+        std::vector<uint8_t>& image
+    );
+
+    /// Check sources against a precompiled standard library image instead
+    /// of the Std sources built into the compiler. Must be called before
+    /// anything is compiled. Returns false if the image is invalid
+    bool loadCompilerStd(std::span<const uint8_t> image);
+}
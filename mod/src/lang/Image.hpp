@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Value.hpp"
+#include <bit>
+#include <cstdint>
+
+namespace dash::lang {
+    // The layout of compiled module images must be kept in sync with the
+    // compiler's image writer
+
+    static_assert(
+        std::endian::native == std::endian::little,
+        "Module images are little-endian and mapped as-is"
+    );
+
+    /// Magic bytes at the start of every compiled module (`.dashc`) image
+    constexpr char IMAGE_MAGIC[4] = { 'D', 'S', 'H', 'C' };
+    /// Bumped whenever the layout of images or the bytecode changes. Images
+    /// with a different version are rejected instead of being migrated
+    constexpr uint32_t IMAGE_VERSION = 6;
+    /// Every section starts at an offset aligned to this many bytes
+    constexpr uint32_t IMAGE_SECTION_ALIGN = 16;
+
+    enum class ImageSection : uint32_t {
+        /// Length-prefixed, NUL-terminated `String`s, each aligned to 4
+        /// bytes. Everything else refers to strings by their offset in here
+        Strings,
+        /// Array of `Constant`
+        Constants,
+        /// Array of `FunctionProto`
+        Functions,
+        /// Array of `NativeImport`
+        Natives,
+        /// Array of `Instr` for all functions
+        Code,
+        /// Array of `DebugSpan`, sorted by instruction. May be empty
+        DebugSpans,
+        /// Array of `PropertySite`
+        Properties,
+        /// Array of `ExportedSymbol`. May be empty
+        Exports,
+    };
+    constexpr size_t IMAGE_SECTION_COUNT = 8;
+
+    struct ImageSectionEntry {
+        /// Offset of the section from the start of the image in bytes
+        uint32_t offset;
+        /// Size of the section in bytes
+        uint32_t size;
+    };
+
+    /// Header at the very start of an image. An image is designed to be
+    /// mapped into memory and executed directly; all the tables a Module
+    /// needs are laid out exactly as they are used
+    struct ImageHeader {
+        char magic[4];
+        uint32_t version;
+        /// Total size of the image in bytes
+        uint32_t size;
+        FunctionID entry;
+        uint32_t globalCount;
+        uint32_t flags;
+        ImageSectionEntry sections[IMAGE_SECTION_COUNT];
+
+        ImageSectionEntry const& section(ImageSection section) const {
+            return sections[static_cast<size_t>(section)];
+        }
+    };
+
+    static_assert(sizeof(ImageHeader) == 88);
+
+    /// Source location of the instructions starting at `pc` until the next
+    /// span
+    struct DebugSpan {
+        /// Index of the first instruction in the module's code
+        uint32_t pc;
+        /// Offset of the source file's name in the string table
+        uint32_t file;
+        /// 1-based line and column
+        uint32_t line;
+        uint32_t column;
+    };
+
+    static_assert(sizeof(DebugSpan) == 16);
+
+    /// The type of value a property get expects. Native properties aren't
+    /// typed for the checker, so the value read is checked at runtime
+    enum class PropertyType : uint8_t {
+        Any,
+        Int,
+        String,
+        /// Ints are read as floats
+        Float,
+        Object,
+    };
+
+    /// A property get or set in the code. Sites aren't shared between
+    /// instructions, even if they access the same property, since each one
+    /// caches what it resolved to at runtime
+    struct PropertySite {
+        /// Offset of the property's name in the string table
+        uint32_t name;
+        /// What a get expects to read. Always `Any` for sets, since setters
+        /// check the values they're given themselves
+        PropertyType type;
+        uint8_t _pad[3];
+    };
+
+    static_assert(sizeof(PropertySite) == 8);
+
+    /// A native import that other modules can import from this one. This is
+    /// how the standard library's symbol table is shipped, so the compiler
+    /// can check against Std without checking its sources
+    struct ExportedSymbol {
+        /// Offset of the symbol's name in the string table
+        uint32_t name;
+        /// Offset of the symbol's encoded type in the string table
+        uint32_t signature;
+        /// Index of the native import that implements the symbol
+        uint16_t native;
+        uint16_t _pad;
+    };
+
+    static_assert(sizeof(ExportedSymbol) == 12);
+}
@@ -0,0 +1,441 @@
+#include "Jit.hpp"
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if DASH_JIT_SUPPORTED
+    #ifdef _WIN32
+        #define WIN32_LEAN_AND_MEAN
+        #include <Windows.h>
+    #else
+        #include <sys/mman.h>
+        #include <unistd.h>
+    #endif
+#endif
+
+using namespace dash::lang;
+
+static std::atomic<bool> s_enabled = true;
+/// Cleared the first time the system refuses to make memory executable
+static std::atomic<bool> s_available = DASH_JIT_SUPPORTED;
+
+bool dash::lang::isJitAvailable() {
+    return s_available;
+}
+
+void dash::lang::setJitEnabled(bool enabled) {
+    s_enabled = enabled;
+}
+
+bool dash::lang::isJitEnabled() {
+    return s_enabled && s_available;
+}
+
+#if DASH_JIT_SUPPORTED
+
+namespace {
+    /// Bit patterns of the Values the templates build
+    uint64_t bitsOf(Value const& value) {
+        return std::bit_cast<uint64_t>(value);
+    }
+    uint64_t const FALSE_BITS = bitsOf(Value::fromBool(false));
+    uint64_t const TRUE_BITS = bitsOf(Value::fromBool(true));
+    uint64_t const INT_BITS = bitsOf(Value::fromInt(0));
+    uint64_t const PAYLOAD_MASK = (uint64_t(1) << 48) - 1;
+    uint64_t const NAN_BITS = bitsOf(Value::fromFloat(std::numeric_limits<double>::quiet_NaN()));
+
+    /// Emits x86-64 machine code. While a function runs, r8 points to its
+    /// registers, and r9, r10 and r11 hold constants the templates use: the
+    /// bits of `false`, the payload mask and the bits of the int 0. Only
+    /// rax, rcx and xmm0 are used as scratch registers. All of these
+    /// are caller-saved on both the System V and Windows ABIs, and the code
+    /// never touches the stack, so it needs no unwind info
+    class Assembler final {
+    private:
+        std::vector<uint8_t> m_code;
+
+    public:
+        size_t size() const {
+            return m_code.size();
+        }
+        std::vector<uint8_t> const& code() const {
+            return m_code;
+        }
+
+        void bytes(std::initializer_list<uint8_t> bytes) {
+            m_code.insert(m_code.end(), bytes);
+        }
+        void u32(uint32_t value) {
+            for (int i = 0; i < 4; i += 1) {
+                m_code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+            }
+        }
+        void u64(uint64_t value) {
+            this->u32(static_cast<uint32_t>(value));
+            this->u32(static_cast<uint32_t>(value >> 32));
+        }
+        void patch32(size_t at, uint32_t value) {
+            std::memcpy(m_code.data() + at, &value, sizeof(value));
+        }
+        /// Patch a rel32 operand that ends at `at + 4` to point to `target`
+        void patchRel32(size_t at, size_t target) {
+            this->patch32(at, static_cast<uint32_t>(
+                static_cast<int64_t>(target) - static_cast<int64_t>(at + 4)
+            ));
+        }
+
+        /// Operand for register `reg` of the frame, as [r8 + disp32]
+        void slot(uint8_t modrmReg, uint8_t reg) {
+            this->bytes({ static_cast<uint8_t>(0x80 | (modrmReg << 3)) });
+            this->u32(uint32_t(reg) * sizeof(Value));
+        }
+
+        // mov rax, [slot]
+        void loadRax(uint8_t reg) {
+            this->bytes({ 0x49, 0x8b });
+            this->slot(0, reg);
+        }
+        // mov rcx, [slot]
+        void loadRcx(uint8_t reg) {
+            this->bytes({ 0x49, 0x8b });
+            this->slot(1, reg);
+        }
+        // mov [slot], rax
+        void storeRax(uint8_t reg) {
+            this->bytes({ 0x49, 0x89 });
+            this->slot(0, reg);
+        }
+        // movabs rax, imm64
+        void movRax(uint64_t value) {
+            this->bytes({ 0x48, 0xb8 });
+            this->u64(value);
+        }
+        // movabs rcx, imm64
+        void movRcx(uint64_t value) {
+            this->bytes({ 0x48, 0xb9 });
+            this->u64(value);
+        }
+        // mov eax, pc; ret
+        void exit(uint32_t pc) {
+            this->bytes({ 0xb8 });
+            this->u32(pc);
+            this->bytes({ 0xc3 });
+        }
+        /// Emit a jcc rel32 or jmp rel32 and return the position of its
+        /// operand, to be patched once the target is known
+        size_t jump(std::initializer_list<uint8_t> opcode) {
+            this->bytes(opcode);
+            auto at = this->size();
+            this->u32(0);
+            return at;
+        }
+
+        /// Box the low 48 bits of rax as an int and store them
+        void storeIntRax(uint8_t reg) {
+            this->bytes({ 0x4c, 0x21, 0xd0 }); // and rax, r10
+            this->bytes({ 0x4c, 0x09, 0xd8 }); // or rax, r11
+            this->storeRax(reg);
+        }
+        /// Box the flag set by `setcc` as a bool and store it
+        void storeBool(uint8_t setcc, uint8_t reg) {
+            this->bytes({ 0x0f, setcc, 0xc0 }); // setcc al
+            this->bytes({ 0x0f, 0xb6, 0xc0 });  // movzx eax, al
+            this->bytes({ 0x4c, 0x09, 0xc8 });  // or rax, r9
+            this->storeRax(reg);
+        }
+        /// Store xmm0 as a float, canonicalizing NaNs like Value::fromFloat
+        void storeFloatXmm0(uint8_t reg) {
+            this->bytes({ 0x66, 0x48, 0x0f, 0x7e, 0xc0 }); // movq rax, xmm0
+            this->bytes({ 0x66, 0x0f, 0x2e, 0xc0 });       // ucomisd xmm0, xmm0
+            this->bytes({ 0x7b, 10 });                     // jnp +10
+            this->movRax(NAN_BITS);
+            this->storeRax(reg);
+        }
+        // An SSE2 instruction on xmm0 and [slot], like `addsd xmm0, [slot]`
+        void sse(uint8_t prefix, uint8_t op, uint8_t reg) {
+            this->bytes({ prefix, 0x41, 0x0f, op });
+            this->slot(0, reg);
+        }
+    };
+
+    /// Whether an instruction has a template
+    bool isCompiled(Instr ins) {
+        switch (ins.op()) {
+            case Op::Nop: case Op::Move:
+            case Op::LoadConst: case Op::LoadInt: case Op::LoadBool: case Op::LoadVoid: case Op::LoadFunction:
+            case Op::AddInt: case Op::SubInt: case Op::MulInt: case Op::LessInt: case Op::LeqInt:
+            case Op::AddFloat: case Op::SubFloat: case Op::MulFloat: case Op::DivFloat:
+            case Op::LessFloat: case Op::LeqFloat:
+                return true;
+            // Backward jumps are safepoints, which only the interpreter has
+            case Op::Jump: case Op::JumpIf: case Op::JumpIfNot:
+                return ins.sbx() >= 0;
+            default:
+                return false;
+        }
+    }
+
+    /// Switching between the interpreter and native code costs about as
+    /// much as interpreting a few instructions, so native code is only
+    /// entered where at least this many compiled instructions follow
+    constexpr uint32_t MIN_RUN = 6;
+    /// Functions are only compiled if at least one in this many of their
+    /// instructions is in a run that native code is entered for. Mostly
+    /// interpreted functions would gain too little to be worth the memory
+    constexpr uint32_t MIN_SHARE = 4;
+
+    /// Find the instructions native code is worth entering at, which start
+    /// runs of at least `MIN_RUN` compiled instructions. `covered` is set to
+    /// the number of instructions in those runs
+    std::vector<bool> findEntries(Instr const* code, uint32_t count, uint32_t& covered) {
+        std::vector<bool> entries(count);
+        covered = 0;
+        uint32_t run = 0;
+        for (uint32_t pc = count; pc-- > 0;) {
+            run = isCompiled(code[pc]) ? run + 1 : 0;
+            entries[pc] = run >= MIN_RUN;
+            if (run == MIN_RUN) {
+                covered += MIN_RUN;
+            }
+            else if (run > MIN_RUN) {
+                covered += 1;
+            }
+        }
+        return entries;
+    }
+
+    void* allocateExecutable(std::vector<uint8_t> const& code, size_t& size) {
+    #ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        size_t page = info.dwPageSize;
+    #else
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    #endif
+        size = (code.size() + page - 1) / page * page;
+        // Memory is never writable and executable at the same time
+    #ifdef _WIN32
+        auto memory = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!memory) {
+            return nullptr;
+        }
+        std::memcpy(memory, code.data(), code.size());
+        DWORD old;
+        if (!VirtualProtect(memory, size, PAGE_EXECUTE_READ, &old)) {
+            VirtualFree(memory, 0, MEM_RELEASE);
+            return nullptr;
+        }
+        FlushInstructionCache(GetCurrentProcess(), memory, size);
+    #else
+        auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+        std::memcpy(memory, code.data(), code.size());
+        if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, size);
+            return nullptr;
+        }
+    #endif
+        return memory;
+    }
+}
+
+JitFunction::JitFunction(void* memory, size_t size, std::vector<bool> entries)
+  : m_memory(memory), m_size(size), m_entry(reinterpret_cast<Entry>(memory)),
+    m_entries(std::move(entries)) {}
+
+JitFunction::~JitFunction() {
+#ifdef _WIN32
+    VirtualFree(m_memory, 0, MEM_RELEASE);
+#else
+    munmap(m_memory, m_size);
+#endif
+}
+
+std::unique_ptr<JitFunction> JitFunction::compile(Module const& module, FunctionProto const& function) {
+    if (!isJitEnabled()) {
+        return nullptr;
+    }
+    auto code = module.code(function);
+    auto count = function.codeSize;
+    uint32_t covered;
+    auto entries = findEntries(code, count, covered);
+    if (covered == 0 || covered * MIN_SHARE < count) {
+        return nullptr;
+    }
+
+    Assembler as;
+#ifdef _WIN32
+    as.bytes({ 0x49, 0x89, 0xc8 }); // mov r8, rcx
+    as.bytes({ 0x89, 0xd0 });       // mov eax, edx
+#else
+    as.bytes({ 0x49, 0x89, 0xf8 }); // mov r8, rdi
+    as.bytes({ 0x89, 0xf0 });       // mov eax, esi
+#endif
+    as.bytes({ 0x49, 0xb9 }); // movabs r9, FALSE_BITS
+    as.u64(FALSE_BITS);
+    as.bytes({ 0x49, 0xba }); // movabs r10, PAYLOAD_MASK
+    as.u64(PAYLOAD_MASK);
+    as.bytes({ 0x49, 0xbb }); // movabs r11, INT_BITS
+    as.u64(INT_BITS);
+    // Jump to the code of instruction `pc` through a table of offsets
+    as.bytes({ 0x48, 0x8d, 0x0d }); // lea rcx, [rip + table]
+    auto tableRef = as.size();
+    as.u32(0);
+    as.bytes({ 0x48, 0x63, 0x04, 0x81 }); // movsxd rax, dword [rcx + rax * 4]
+    as.bytes({ 0x48, 0x01, 0xc8 });       // add rax, rcx
+    as.bytes({ 0xff, 0xe0 });             // jmp rax
+
+    std::vector<size_t> labels(count);
+    struct Fixup {
+        size_t at;
+        uint32_t target;
+    };
+    std::vector<Fixup> fixups;
+
+    for (uint32_t pc = 0; pc < count; pc += 1) {
+        auto const ins = code[pc];
+        labels[pc] = as.size();
+        if (!isCompiled(ins)) {
+            as.exit(pc);
+            continue;
+        }
+        switch (ins.op()) {
+            case Op::Nop: break;
+
+            case Op::Move: {
+                as.loadRax(ins.b());
+                as.storeRax(ins.a());
+            } break;
+
+            case Op::LoadConst: {
+                as.movRax(bitsOf(module.constant(ins.bx())));
+                as.storeRax(ins.a());
+            } break;
+
+            case Op::LoadInt: {
+                as.movRax(bitsOf(Value::fromInt(ins.sbx())));
+                as.storeRax(ins.a());
+            } break;
+
+            case Op::LoadBool: {
+                as.movRax(bitsOf(Value::fromBool(ins.b() != 0)));
+                as.storeRax(ins.a());
+            } break;
+
+            case Op::LoadVoid: {
+                as.movRax(bitsOf(Value()));
+                as.storeRax(ins.a());
+            } break;
+
+            case Op::LoadFunction: {
+                as.movRax(bitsOf(Value::fromFunction(ins.bx())));
+                as.storeRax(ins.a());
+            } break;
+
+            // Ints wrap around at 48 bits, and the low 48 bits of a sum,
+            // difference or product only depend on the low 48 bits of the
+            // operands, so the payloads can be used as they are
+            case Op::AddInt: case Op::SubInt: case Op::MulInt: {
+                as.loadRax(ins.b());
+                switch (ins.op()) {
+                    case Op::AddInt: as.bytes({ 0x49, 0x03 }); break;       // add rax, [slot]
+                    case Op::SubInt: as.bytes({ 0x49, 0x2b }); break;       // sub rax, [slot]
+                    default:         as.bytes({ 0x49, 0x0f, 0xaf }); break; // imul rax, [slot]
+                }
+                as.slot(0, ins.c());
+                as.storeIntRax(ins.a());
+            } break;
+
+            // Shifting the payloads to the top compares them as signed
+            // 48-bit ints
+            case Op::LessInt: case Op::LeqInt: {
+                as.loadRax(ins.b());
+                as.loadRcx(ins.c());
+                as.bytes({ 0x48, 0xc1, 0xe0, 16 }); // shl rax, 16
+                as.bytes({ 0x48, 0xc1, 0xe1, 16 }); // shl rcx, 16
+                as.bytes({ 0x48, 0x39, 0xc8 });     // cmp rax, rcx
+                as.storeBool(ins.op() == Op::LessInt ? 0x9c : 0x9e, ins.a()); // setl / setle
+            } break;
+
+            case Op::AddFloat: case Op::SubFloat: case Op::MulFloat: case Op::DivFloat: {
+                as.sse(0xf2, 0x10, ins.b()); // movsd xmm0, [slot]
+                switch (ins.op()) {
+                    case Op::AddFloat: as.sse(0xf2, 0x58, ins.c()); break;
+                    case Op::SubFloat: as.sse(0xf2, 0x5c, ins.c()); break;
+                    case Op::MulFloat: as.sse(0xf2, 0x59, ins.c()); break;
+                    default:           as.sse(0xf2, 0x5e, ins.c()); break;
+                }
+                as.storeFloatXmm0(ins.a());
+            } break;
+
+            // b < c is c > b, which is false for unordered operands
+            case Op::LessFloat: case Op::LeqFloat: {
+                as.sse(0xf2, 0x10, ins.c()); // movsd xmm0, [c]
+                as.sse(0x66, 0x2e, ins.b()); // ucomisd xmm0, [b]
+                as.storeBool(ins.op() == Op::LessFloat ? 0x97 : 0x93, ins.a()); // seta / setae
+            } break;
+
+            case Op::Jump: {
+                fixups.push_back({ as.jump({ 0xe9 }), pc + 1 + ins.sbx() });
+            } break;
+
+            case Op::JumpIf: case Op::JumpIfNot: {
+                auto taken = pc + 1 + ins.sbx();
+                auto onTrue = ins.op() == Op::JumpIf ? taken : pc + 1;
+                auto onFalse = ins.op() == Op::JumpIf ? pc + 1 : taken;
+                as.loadRax(ins.a());
+                as.movRcx(TRUE_BITS);
+                as.bytes({ 0x48, 0x39, 0xc8 }); // cmp rax, rcx
+                fixups.push_back({ as.jump({ 0x0f, 0x84 }), onTrue }); // je
+                as.bytes({ 0x4c, 0x39, 0xc8 }); // cmp rax, r9
+                fixups.push_back({ as.jump({ 0x0f, 0x84 }), onFalse }); // je
+                // Not a bool, so let the interpreter raise the error
+                as.exit(pc);
+            } break;
+
+            default: break;
+        }
+    }
+    // Verified functions always end in a return or jump, so this is never
+    // reached
+    as.bytes({ 0x0f, 0x0b }); // ud2
+
+    for (auto const& fixup : fixups) {
+        as.patchRel32(fixup.at, labels[fixup.target]);
+    }
+    while (as.size() % 4 != 0) {
+        as.bytes({ 0xcc });
+    }
+    auto table = as.size();
+    as.patchRel32(tableRef, table);
+    for (auto label : labels) {
+        as.u32(static_cast<uint32_t>(static_cast<int64_t>(label) - static_cast<int64_t>(table)));
+    }
+
+    size_t size;
+    auto memory = allocateExecutable(as.code(), size);
+    if (!memory) {
+        // The system won't let us run generated code, so don't keep trying
+        s_available = false;
+        return nullptr;
+    }
+    return std::unique_ptr<JitFunction>(new JitFunction(memory, size, std::move(entries)));
+}
+
+#else
+
+JitFunction::JitFunction(void* memory, size_t size, std::vector<bool> entries)
+  : m_memory(memory), m_size(size), m_entry(nullptr), m_entries(std::move(entries)) {}
+
+JitFunction::~JitFunction() = default;
+
+std::unique_ptr<JitFunction> JitFunction::compile(Module const&, FunctionProto const&) {
+    return nullptr;
+}
+
+#endif
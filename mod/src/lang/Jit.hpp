@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Module.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Native code is only generated for x86-64, and can be left out entirely by
+// defining DASH_DISABLE_JIT. Everywhere else functions are always
+// interpreted
+#if !defined(DASH_DISABLE_JIT) && (defined(__x86_64__) || defined(_M_X64))
+    #define DASH_JIT_SUPPORTED 1
+#else
+    #define DASH_JIT_SUPPORTED 0
+#endif
+
+namespace dash::lang {
+    /// A function compiled to native code by the baseline JIT. Every
+    /// instruction is translated on its own into a fixed template that works
+    /// directly on the frame's registers, so the interpreter can switch to
+    /// the native code and back at any instruction.
+    ///
+    /// Only instructions that can never fail or call out are compiled: moves
+    /// and loads, the typed arithmetic the checker emits when it knows both
+    /// operand types, comparisons, and forward jumps. Native code runs until
+    /// it reaches any other instruction and returns its index, at which
+    /// point the interpreter executes that instruction and switches back.
+    /// Calls, returns, property accesses and backward jumps are therefore
+    /// always handled by the interpreter, which keeps frames, errors,
+    /// profiling and task deadlines working exactly like they do without
+    /// the JIT. Switching costs about as much as interpreting a few
+    /// instructions, so the interpreter only switches where a long enough
+    /// run of compiled instructions starts
+    class JitFunction final {
+    public:
+        /// Run from instruction `pc` with `registers` as the frame's
+        /// registers. Returns the index of the instruction to continue
+        /// interpreting at
+        using Entry = uint32_t(*)(Value* registers, uint32_t pc);
+
+    private:
+        void* m_memory;
+        size_t m_size;
+        Entry m_entry;
+        /// Whether running native code from an instruction pays off
+        std::vector<bool> m_entries;
+
+        JitFunction(void* memory, size_t size, std::vector<bool> entries);
+
+    public:
+        ~JitFunction();
+
+        JitFunction(JitFunction const&) = delete;
+        JitFunction& operator=(JitFunction const&) = delete;
+
+        /// Compile a function. Returns null if the JIT isn't available or
+        /// enabled, or if too little of the function could be compiled for
+        /// it to be worth it
+        static std::unique_ptr<JitFunction> compile(Module const& module, FunctionProto const& function);
+
+        /// Whether the interpreter should switch to native code at `pc`
+        bool isEntry(uint32_t pc) const {
+            return m_entries[pc];
+        }
+        uint32_t run(Value* registers, uint32_t pc) const {
+            return m_entry(registers, pc);
+        }
+    };
+
+    /// Whether native code can be generated on this platform and process.
+    /// This is false if the JIT was compiled out, or if the system doesn't
+    /// let the process make memory executable
+    bool isJitAvailable();
+    /// Turn the JIT on or off. Functions that have already been compiled
+    /// keep using native code
+    void setJitEnabled(bool enabled);
+    bool isJitEnabled();
+}
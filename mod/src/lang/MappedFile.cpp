@@ -0,0 +1,106 @@
+#include "MappedFile.hpp"
+#include <fmt/format.h>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <cerrno>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace dash::lang;
+
+MappedFile::~MappedFile() {
+    this->close();
+}
+
+#ifdef _WIN32
+
+void MappedFile::close() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file && m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_file = nullptr;
+}
+
+std::optional<std::string> MappedFile::open(std::filesystem::path const& path) {
+    this->close();
+    m_file = CreateFileW(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return fmt::format("Unable to open file (error code {})", GetLastError());
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size)) {
+        return fmt::format("Unable to get file size (error code {})", GetLastError());
+    }
+    if (size.QuadPart == 0) {
+        return "File is empty";
+    }
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+        return fmt::format("Unable to map file (error code {})", GetLastError());
+    }
+    m_data = static_cast<uint8_t const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+        return fmt::format("Unable to map file (error code {})", GetLastError());
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    return std::nullopt;
+}
+
+#else
+
+void MappedFile::close() {
+    if (m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+std::optional<std::string> MappedFile::open(std::filesystem::path const& path) {
+    this->close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return fmt::format("Unable to open file: {}", std::strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        auto err = fmt::format("Unable to get file size: {}", std::strerror(errno));
+        ::close(fd);
+        return err;
+    }
+    if (info.st_size == 0) {
+        ::close(fd);
+        return "File is empty";
+    }
+    auto data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return fmt::format("Unable to map file: {}", std::strerror(errno));
+    }
+    m_data = static_cast<uint8_t const*>(data);
+    m_size = static_cast<size_t>(info.st_size);
+    return std::nullopt;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace dash::lang {
+    /// A read-only memory mapping of a whole file. The mapping stays valid
+    /// for as long as the MappedFile is alive
+    class MappedFile final {
+    private:
+        uint8_t const* m_data = nullptr;
+        size_t m_size = 0;
+    #ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+    #endif
+
+        void close();
+
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator=(MappedFile const&) = delete;
+
+        /// Map a file into memory, returning an error if it could not be
+        /// opened or mapped
+        std::optional<std::string> open(std::filesystem::path const& path);
+
+        std::span<const uint8_t> data() const {
+            return std::span(m_data, m_size);
+        }
+    };
+}
@@ -0,0 +1,309 @@
+#include "Module.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fmt/format.h>
+#include <new>
+
+using namespace dash::lang;
+
+static std::atomic<uint64_t> s_nextGeneration = 1;
+
+template <class T>
+static std::optional<std::string> mapSection(
+    std::span<const uint8_t> image, ImageHeader const& header,
+    ImageSection section, std::span<const T>& out
+) {
+    auto const& entry = header.section(section);
+    if (
+        entry.offset % IMAGE_SECTION_ALIGN != 0 ||
+        static_cast<uint64_t>(entry.offset) + entry.size > image.size()
+    ) {
+        return fmt::format("Section #{} is out of bounds", static_cast<uint32_t>(section));
+    }
+    if (entry.size % sizeof(T) != 0) {
+        return fmt::format("Section #{} has an invalid size", static_cast<uint32_t>(section));
+    }
+    out = std::span(reinterpret_cast<T const*>(image.data() + entry.offset), entry.size / sizeof(T));
+    return std::nullopt;
+}
+
+std::optional<std::string> Module::load(std::span<const uint8_t> image, std::shared_ptr<const void> storage) {
+    if (reinterpret_cast<uintptr_t>(image.data()) % IMAGE_SECTION_ALIGN != 0) {
+        return "Image is not aligned";
+    }
+    if (image.size() < sizeof(ImageHeader)) {
+        return "Image is too small";
+    }
+    auto const& header = *reinterpret_cast<ImageHeader const*>(image.data());
+    if (std::memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0) {
+        return "Not a compiled Dash module";
+    }
+    if (header.version != IMAGE_VERSION) {
+        return fmt::format(
+            "Module was compiled for image version {}, but this runtime requires version {}",
+            header.version, IMAGE_VERSION
+        );
+    }
+    if (header.size != image.size()) {
+        return "Image size does not match its header";
+    }
+
+    Module module;
+    if (auto err = mapSection(image, header, ImageSection::Strings, module.m_strings)) return err;
+    if (auto err = mapSection(image, header, ImageSection::Constants, module.m_constants)) return err;
+    if (auto err = mapSection(image, header, ImageSection::Functions, module.m_functions)) return err;
+    if (auto err = mapSection(image, header, ImageSection::Natives, module.m_natives)) return err;
+    if (auto err = mapSection(image, header, ImageSection::Code, module.m_code)) return err;
+    if (auto err = mapSection(image, header, ImageSection::DebugSpans, module.m_debugSpans)) return err;
+    if (auto err = mapSection(image, header, ImageSection::Properties, module.m_propertySites)) return err;
+    if (auto err = mapSection(image, header, ImageSection::Exports, module.m_exports)) return err;
+    module.m_entry = header.entry;
+    module.m_globalCount = header.globalCount;
+    module.m_storage = std::move(storage);
+    module.m_generation = s_nextGeneration.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto err = module.verify()) {
+        return err;
+    }
+    module.intern();
+    *this = std::move(module);
+    return std::nullopt;
+}
+
+std::optional<std::string> Module::load(std::vector<uint8_t> image) {
+    if (reinterpret_cast<uintptr_t>(image.data()) % IMAGE_SECTION_ALIGN == 0) {
+        auto storage = std::make_shared<std::vector<uint8_t>>(std::move(image));
+        return this->load(*storage, storage);
+    }
+    // Vectors are only guaranteed to be aligned for `max_align_t`, which is
+    // less than images need on some platforms (like 32-bit Android)
+    constexpr auto align = std::align_val_t { IMAGE_SECTION_ALIGN };
+    auto storage = std::shared_ptr<uint8_t>(
+        static_cast<uint8_t*>(::operator new(image.size(), align)),
+        [align](uint8_t* data) { ::operator delete(data, align); }
+    );
+    std::memcpy(storage.get(), image.data(), image.size());
+    return this->load(std::span<const uint8_t>(storage.get(), image.size()), storage);
+}
+
+std::optional<std::string> Module::loadFromFile(std::filesystem::path const& path) {
+    auto file = std::make_shared<MappedFile>();
+    if (auto err = file->open(path)) {
+        return err;
+    }
+    return this->load(file->data(), file);
+}
+
+void Module::intern() {
+    auto& symbols = SymbolTable::get();
+    m_constantValues.reserve(m_constants.size());
+    for (auto const& k : m_constants) {
+        switch (k.type) {
+            case ConstantType::Int: {
+                m_constantValues.push_back(Value::fromInt(k.intValue));
+            } break;
+            case ConstantType::Float: {
+                m_constantValues.push_back(Value::fromFloat(k.floatValue));
+            } break;
+            case ConstantType::String: {
+                auto str = string(static_cast<uint32_t>(k.stringOffset))->view();
+                m_constantValues.push_back(Value::fromString(symbols.string(symbols.intern(str))));
+            } break;
+        }
+    }
+    m_propertySymbols.reserve(m_propertySites.size());
+    for (auto const& site : m_propertySites) {
+        m_propertySymbols.push_back(symbols.intern(string(site.name)->view()));
+    }
+}
+
+DebugSpan const* Module::debugSpan(FunctionProto const& function, uint32_t pc) const {
+    auto abs = function.codeOffset + pc;
+    // Find the last span that starts at or before the instruction
+    auto it = std::upper_bound(
+        m_debugSpans.begin(), m_debugSpans.end(), abs,
+        [](uint32_t pc, DebugSpan const& span) { return pc < span.pc; }
+    );
+    if (it == m_debugSpans.begin()) {
+        return nullptr;
+    }
+    return &*std::prev(it);
+}
+
+std::optional<std::string> Module::verify() const {
+    auto validString = [this](uint64_t offset) {
+        if (offset % alignof(String) != 0 || offset + sizeof(uint32_t) > m_strings.size()) {
+            return false;
+        }
+        return offset + sizeof(uint32_t) + string(static_cast<uint32_t>(offset))->size < m_strings.size();
+    };
+
+    for (auto const& k : m_constants) {
+        if (k.type > ConstantType::String) {
+            return "Constant has an unknown type";
+        }
+        if (k.type == ConstantType::Int && (k.intValue < MIN_INT || k.intValue > MAX_INT)) {
+            return "Int constant is out of range";
+        }
+        if (k.type == ConstantType::String && !validString(k.stringOffset)) {
+            return "String constant points outside the string table";
+        }
+    }
+    for (auto const& native : m_natives) {
+        if (!validString(native.name)) {
+            return "Native import name points outside the string table";
+        }
+    }
+    for (size_t i = 0; i < m_debugSpans.size(); i += 1) {
+        auto const& span = m_debugSpans[i];
+        if (span.pc >= m_code.size() || (i > 0 && span.pc < m_debugSpans[i - 1].pc)) {
+            return "Debug spans are out of bounds or unsorted";
+        }
+        if (!validString(span.file)) {
+            return "Debug span file name points outside the string table";
+        }
+    }
+    for (auto const& site : m_propertySites) {
+        if (!validString(site.name)) {
+            return "Property name points outside the string table";
+        }
+        if (site.type > PropertyType::Object) {
+            return "Property site has an unknown type";
+        }
+    }
+    for (auto const& symbol : m_exports) {
+        if (!validString(symbol.name) || !validString(symbol.signature)) {
+            return "Exported symbol points outside the string table";
+        }
+        if (symbol.native >= m_natives.size()) {
+            return "Exported symbol refers to a native import that doesn't exist";
+        }
+    }
+    if (m_entry >= m_functions.size()) {
+        return "Entry point is not a valid function";
+    }
+
+    for (FunctionID id = 0; id < m_functions.size(); id += 1) {
+        auto const& fun = m_functions[id];
+        if (!validString(fun.name)) {
+            return fmt::format("Name of function #{} points outside the string table", id);
+        }
+        if (
+            fun.codeSize == 0 ||
+            static_cast<uint64_t>(fun.codeOffset) + fun.codeSize > m_code.size()
+        ) {
+            return fmt::format("Code of function #{} is out of bounds", id);
+        }
+        if (fun.paramCount > fun.registerCount) {
+            return fmt::format("Function #{} has more parameters than registers", id);
+        }
+        if (fun.registerCount > MAX_REGISTERS) {
+            return fmt::format("Function #{} has more registers than instructions can address", id);
+        }
+
+        auto code = this->code(fun);
+        for (uint32_t pc = 0; pc < fun.codeSize; pc += 1) {
+            auto const ins = code[pc];
+            auto fail = [&](std::string_view what) {
+                return fmt::format(
+                    "Invalid instruction at {}+{} (opcode {}): {}",
+                    string(fun.name)->view(), pc, static_cast<int>(ins.op()), what
+                );
+            };
+            auto reg = [&](uint32_t r) { return r < fun.registerCount; };
+            auto target = [&]() {
+                int64_t to = static_cast<int64_t>(pc) + 1 + ins.sbx();
+                return to >= 0 && to < fun.codeSize;
+            };
+
+            switch (ins.op()) {
+                case Op::Nop: case Op::ReturnVoid: case Op::Yield: break;
+
+                case Op::LoadInt: case Op::LoadBool: case Op::LoadVoid: case Op::Return: {
+                    if (!reg(ins.a())) return fail("register out of bounds");
+                } break;
+
+                case Op::Move: case Op::Neg: case Op::Not: case Op::CallValue: {
+                    if (!reg(ins.a()) || !reg(ins.b())) return fail("register out of bounds");
+                } break;
+
+                case Op::Add: case Op::Sub: case Op::Mul: case Op::Div: case Op::Mod:
+                case Op::Eq: case Op::Neq: case Op::Less: case Op::Leq: case Op::Grt: case Op::Geq:
+                case Op::AddInt: case Op::SubInt: case Op::MulInt: case Op::LessInt: case Op::LeqInt:
+                case Op::AddFloat: case Op::SubFloat: case Op::MulFloat: case Op::DivFloat:
+                case Op::LessFloat: case Op::LeqFloat: {
+                    if (!reg(ins.a()) || !reg(ins.b()) || !reg(ins.c())) {
+                        return fail("register out of bounds");
+                    }
+                } break;
+
+                case Op::LoadConst: {
+                    if (!reg(ins.a())) return fail("register out of bounds");
+                    if (ins.bx() >= m_constants.size()) return fail("constant out of bounds");
+                } break;
+
+                case Op::LoadFunction: {
+                    if (!reg(ins.a())) return fail("register out of bounds");
+                    if (ins.bx() >= m_functions.size()) return fail("function out of bounds");
+                } break;
+
+                case Op::GetGlobal: case Op::SetGlobal: {
+                    if (!reg(ins.a())) return fail("register out of bounds");
+                    if (ins.bx() >= m_globalCount) return fail("global out of bounds");
+                } break;
+
+                case Op::GetProp: {
+                    if (!reg(ins.a())) return fail("register out of bounds");
+                    if (ins.bx() >= m_propertySites.size()) return fail("property site out of bounds");
+                } break;
+
+                case Op::SetProp: {
+                    if (!reg(ins.a()) || !reg(ins.a() + 1)) return fail("register out of bounds");
+                    if (ins.bx() >= m_propertySites.size()) return fail("property site out of bounds");
+                } break;
+
+                case Op::Jump: {
+                    if (!target()) return fail("jump target out of bounds");
+                } break;
+
+                case Op::JumpIf: case Op::JumpIfNot: {
+                    if (!reg(ins.a())) return fail("register out of bounds");
+                    if (!target()) return fail("jump target out of bounds");
+                } break;
+
+                case Op::Call: case Op::Spawn: {
+                    if (ins.bx() >= m_functions.size()) return fail("function out of bounds");
+                    auto const& callee = m_functions[ins.bx()];
+                    if (!reg(ins.a()) || ins.a() + callee.paramCount > fun.registerCount) {
+                        return fail("arguments out of bounds");
+                    }
+                    bool isAsync = callee.flags & FUNCTION_ASYNC;
+                    if (isAsync && ins.op() == Op::Call) return fail("async function called directly");
+                    if (!isAsync && ins.op() == Op::Spawn) return fail("spawned function is not async");
+                } break;
+
+                case Op::CallNative: {
+                    if (ins.bx() >= m_natives.size()) return fail("native out of bounds");
+                    auto const& callee = m_natives[ins.bx()];
+                    if (!reg(ins.a()) || ins.a() + callee.paramCount > fun.registerCount) {
+                        return fail("arguments out of bounds");
+                    }
+                } break;
+
+                default: return fail("unknown opcode");
+            }
+        }
+
+        // Execution must never fall off the end of a function
+        switch (code[fun.codeSize - 1].op()) {
+            case Op::Return: case Op::ReturnVoid: case Op::Jump: break;
+            default: return fmt::format(
+                "Function {} does not end in a return or jump",
+                string(fun.name)->view()
+            );
+        }
+    }
+    return std::nullopt;
+}
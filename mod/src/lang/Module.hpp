@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Bytecode.hpp"
+#include "Image.hpp"
+#include "Symbol.hpp"
+#include "Value.hpp"
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dash::lang {
+    /// A loaded bytecode module. All tables are flat arrays of POD entries
+    /// that are never mutated after loading, so a VM can read them directly
+    /// while executing. The tables are views straight into the module's
+    /// image, which is usually a memory-mapped `.dashc` file
+    class Module final {
+    private:
+        /// Keeps the memory the tables point into alive
+        std::shared_ptr<const void> m_storage;
+        std::span<const Instr> m_code;
+        std::span<const Constant> m_constants;
+        std::span<const FunctionProto> m_functions;
+        std::span<const NativeImport> m_natives;
+        std::span<const uint8_t> m_strings;
+        std::span<const DebugSpan> m_debugSpans;
+        std::span<const PropertySite> m_propertySites;
+        std::span<const ExportedSymbol> m_exports;
+        /// Constants decoded when the module is loaded, with strings pointing
+        /// to their interned copies
+        std::vector<Value> m_constantValues;
+        /// Interned names of the property sites, indexed by site
+        std::vector<Symbol> m_propertySymbols;
+        FunctionID m_entry = 0;
+        uint32_t m_globalCount = 0;
+        /// Unique to every load, unlike the module's address which a module
+        /// loaded later may reuse
+        uint64_t m_generation = 0;
+
+    public:
+        Module() = default;
+
+        Module(Module const&) = delete;
+        Module& operator=(Module const&) = delete;
+        Module(Module&&) = default;
+        Module& operator=(Module&&) = default;
+
+        std::span<const Instr> code() const {
+            return m_code;
+        }
+        Instr const* code(FunctionProto const& function) const {
+            return m_code.data() + function.codeOffset;
+        }
+        std::span<const FunctionProto> functions() const {
+            return m_functions;
+        }
+        FunctionProto const& function(FunctionID id) const {
+            return m_functions[id];
+        }
+        std::span<const NativeImport> natives() const {
+            return m_natives;
+        }
+        std::span<const Constant> constants() const {
+            return m_constants;
+        }
+        std::span<const DebugSpan> debugSpans() const {
+            return m_debugSpans;
+        }
+        std::span<const PropertySite> propertySites() const {
+            return m_propertySites;
+        }
+        std::span<const ExportedSymbol> exports() const {
+            return m_exports;
+        }
+        String const* string(uint32_t offset) const {
+            return reinterpret_cast<String const*>(m_strings.data() + offset);
+        }
+        /// Get a constant as a Value. String constants are the shared copies
+        /// from the symbol table, so equal literals from different modules
+        /// are the same pointer
+        Value constant(uint32_t index) const {
+            return m_constantValues[index];
+        }
+        Symbol propertySymbol(uint32_t site) const {
+            return m_propertySymbols[site];
+        }
+        FunctionID entry() const {
+            return m_entry;
+        }
+        uint32_t globalCount() const {
+            return m_globalCount;
+        }
+        uint64_t generation() const {
+            return m_generation;
+        }
+
+        /// Load a module from an image. The image is not copied; `storage` is
+        /// kept alive for as long as the module is and must own the memory
+        /// `image` points to. Returns an error if the image is malformed or
+        /// was compiled for a different image version
+        std::optional<std::string> load(std::span<const uint8_t> image, std::shared_ptr<const void> storage);
+        /// Load a module from an image in memory, taking ownership of it. The
+        /// image is copied if it isn't aligned like images need to be
+        std::optional<std::string> load(std::vector<uint8_t> image);
+        /// Map a `.dashc` image into memory and load it
+        std::optional<std::string> loadFromFile(std::filesystem::path const& path);
+
+        /// Find the source location of an instruction, if the module has
+        /// debug info for it
+        DebugSpan const* debugSpan(FunctionProto const& function, uint32_t pc) const;
+
+        /// Check that every instruction only references registers, constants,
+        /// functions and jump targets that exist, so the interpreter doesn't
+        /// need to bounds check anything while executing. Returns an error
+        /// message if the module is malformed
+        std::optional<std::string> verify() const;
+
+    private:
+        /// Intern the strings the VM compares or looks things up by
+        void intern();
+    };
+}
@@ -0,0 +1,131 @@
+#include "NativeClass.hpp"
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+using namespace dash::lang;
+
+static std::vector<std::unique_ptr<NativeClass>>& classes() {
+    static std::vector<std::unique_ptr<NativeClass>> classes;
+    return classes;
+}
+
+static std::unordered_map<ClassKey, NativeClass const*>& classesByKey() {
+    static std::unordered_map<ClassKey, NativeClass const*> classes;
+    return classes;
+}
+
+static ClassKeyResolver s_classKeyResolver = nullptr;
+
+void PropertyGroup::write(void* object, uint8_t component, Value const& value) const {
+    if (update) {
+        update(object, component, value);
+        return;
+    }
+    Value values[MAX_COMPONENTS];
+    load(object, values);
+    values[component] = value;
+    apply(object, values);
+}
+
+NativeClass::NativeClass(std::string_view name, NativeClass const* parent, InstanceCheck isInstance)
+  : m_name(name), m_parent(parent), m_isInstance(isInstance),
+    m_depth(parent ? parent->depth() + 1 : 0) {}
+
+NativeClass& NativeClass::addProperty(std::string_view name, PropertyGetter getter, PropertySetter setter) {
+    m_properties.insert_or_assign(intern(name), NativeProperty { getter, setter });
+    return *this;
+}
+
+NativeClass& NativeClass::addGroupedProperty(
+    std::string_view name, PropertyGetter getter, PropertyCheck check,
+    PropertyGroup const& group, uint8_t component
+) {
+    m_properties.insert_or_assign(intern(name), NativeProperty {
+        .getter = getter,
+        .setter = nullptr,
+        .group = &group,
+        .check = check,
+        .component = component,
+    });
+    return *this;
+}
+
+NativeClass& NativeClass::setFactory(Factory factory) {
+    m_factory = factory;
+    return *this;
+}
+
+std::vector<std::pair<Symbol, NativeProperty const*>> NativeClass::allProperties() const {
+    std::vector<std::pair<Symbol, NativeProperty const*>> result;
+    std::unordered_set<Symbol> seen;
+    for (auto cls = this; cls; cls = cls->m_parent) {
+        for (auto const& [name, prop] : cls->m_properties) {
+            if (seen.insert(name).second) {
+                result.push_back({ name, &prop });
+            }
+        }
+    }
+    return result;
+}
+
+NativeProperty const* NativeClass::findProperty(Symbol name) const {
+    for (auto cls = this; cls; cls = cls->m_parent) {
+        auto it = cls->m_properties.find(name);
+        if (it != cls->m_properties.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+NativeProperty const* NativeClass::findProperty(std::string_view name) const {
+    // Names that were never interned can't be the name of any property
+    auto symbol = SymbolTable::get().find(name);
+    return symbol ? this->findProperty(*symbol) : nullptr;
+}
+
+NativeClass& dash::lang::registerNativeClass(
+    std::string_view name, NativeClass const* parent, NativeClass::InstanceCheck isInstance
+) {
+    // A new class may be a better match for objects that have already been
+    // resolved
+    classesByKey().clear();
+    return *classes().emplace_back(std::make_unique<NativeClass>(name, parent, isInstance));
+}
+
+NativeClass const* dash::lang::findNativeClass(std::string_view name) {
+    for (auto const& cls : classes()) {
+        if (cls->name() == name) {
+            return cls.get();
+        }
+    }
+    return nullptr;
+}
+
+void dash::lang::setClassKeyResolver(ClassKeyResolver resolver) {
+    s_classKeyResolver = resolver;
+    classesByKey().clear();
+}
+
+ClassKey dash::lang::classKeyOf(void* object) {
+    return s_classKeyResolver ? s_classKeyResolver(object) : nullptr;
+}
+
+NativeClass const* dash::lang::nativeClassOf(ClassKey key, void* object) {
+    if (!key) {
+        return nullptr;
+    }
+    auto it = classesByKey().find(key);
+    if (it != classesByKey().end()) {
+        return it->second;
+    }
+    NativeClass const* best = nullptr;
+    for (auto const& cls : classes()) {
+        if ((!best || cls->depth() > best->depth()) && cls->isInstance(object)) {
+            best = cls.get();
+        }
+    }
+    classesByKey().insert({ key, best });
+    return best;
+}
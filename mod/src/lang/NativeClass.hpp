@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Symbol.hpp"
+#include "Value.hpp"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dash::lang {
+    class VM;
+
+    /// Gets a property of a native object. Errors are reported through
+    /// `VM::raise`
+    using PropertyGetter = Value(*)(VM& vm, void* object);
+    /// Sets a property of a native object. Errors are reported through
+    /// `VM::raise`
+    using PropertySetter = void(*)(VM& vm, void* object, Value value);
+
+    /// Checks that a value can be assigned to a property, raising an error
+    /// through `VM::raise` if not
+    using PropertyCheck = bool(*)(VM& vm, Value const& value);
+
+    /// Properties that the native object only exposes as a whole, like a
+    /// node's x and y which are both set through `setPosition`. Writes to
+    /// grouped properties are staged and applied with a single call to
+    /// `apply` once per frame (see PropertyBatch)
+    struct PropertyGroup {
+        static constexpr size_t MAX_COMPONENTS = 4;
+
+        /// Read the current value of every component
+        void(*load)(void* object, Value* values);
+        /// Write every component at once
+        void(*apply)(void* object, Value const* values);
+        uint8_t componentCount;
+        /// Write a single component in place, like `setPositionX`. Optional;
+        /// without it, writing one component loads the others so the whole
+        /// group can be applied
+        void(*update)(void* object, uint8_t component, Value const& value) = nullptr;
+
+        /// Write a single component, leaving the others as they are
+        void write(void* object, uint8_t component, Value const& value) const;
+    };
+
+    struct NativeProperty {
+        PropertyGetter getter;
+        /// Null for read-only and grouped properties
+        PropertySetter setter;
+        /// The group this property is written through, if any. Assigned
+        /// values are checked with `check` and staged in the group
+        PropertyGroup const* group = nullptr;
+        PropertyCheck check = nullptr;
+        /// Index of this property in its group
+        uint8_t component = 0;
+    };
+
+    /// Identifies the concrete class of a native object, for example its
+    /// `std::type_info`. All objects with the same key must have the same
+    /// properties
+    using ClassKey = void const*;
+
+    /// A class of native objects whose properties scripts can access, like
+    /// `CCNode`. Properties are inherited from the parent class
+    class NativeClass final {
+    public:
+        /// Check whether an object is an instance of this class
+        using InstanceCheck = bool(*)(void* object);
+        /// Create a new default-constructed object of this class
+        using Factory = void*(*)();
+
+    private:
+        std::string m_name;
+        NativeClass const* m_parent;
+        InstanceCheck m_isInstance;
+        std::unordered_map<Symbol, NativeProperty> m_properties;
+        Factory m_factory = nullptr;
+        size_t m_depth;
+
+    public:
+        NativeClass(std::string_view name, NativeClass const* parent, InstanceCheck isInstance);
+
+        NativeClass(NativeClass const&) = delete;
+        NativeClass& operator=(NativeClass const&) = delete;
+
+        std::string const& name() const {
+            return m_name;
+        }
+        NativeClass const* parent() const {
+            return m_parent;
+        }
+        /// Number of ancestors of this class
+        size_t depth() const {
+            return m_depth;
+        }
+        bool isInstance(void* object) const {
+            return m_isInstance(object);
+        }
+        /// Let objects of this class be created by the runtime, for example
+        /// when instancing templates
+        NativeClass& setFactory(Factory factory);
+        bool canCreate() const {
+            return m_factory != nullptr;
+        }
+        /// Create a new object of this class, or null if the class has no
+        /// factory
+        void* create() const {
+            return m_factory ? m_factory() : nullptr;
+        }
+
+        NativeClass& addProperty(std::string_view name, PropertyGetter getter, PropertySetter setter = nullptr);
+        /// Add a property that is written as a component of a group. Staged
+        /// values outlive the VM call that wrote them, so grouped properties
+        /// can't be strings
+        NativeClass& addGroupedProperty(
+            std::string_view name, PropertyGetter getter, PropertyCheck check,
+            PropertyGroup const& group, uint8_t component
+        );
+        /// Find a property on this class or its ancestors. The returned
+        /// pointer stays valid for as long as the class exists
+        NativeProperty const* findProperty(Symbol name) const;
+        NativeProperty const* findProperty(std::string_view name) const;
+        /// Properties declared on this class itself, not including inherited
+        /// ones
+        std::unordered_map<Symbol, NativeProperty> const& properties() const {
+            return m_properties;
+        }
+        /// All properties of this class including inherited ones. Properties
+        /// redeclared by a subclass shadow their parent's
+        std::vector<std::pair<Symbol, NativeProperty const*>> allProperties() const;
+    };
+
+    /// Register a native class. All classes should be registered on startup,
+    /// before any scripts run, since VMs cache which class objects belong to
+    NativeClass& registerNativeClass(std::string_view name, NativeClass const* parent, NativeClass::InstanceCheck isInstance);
+    NativeClass const* findNativeClass(std::string_view name);
+
+    using ClassKeyResolver = ClassKey(*)(void* object);
+    /// Set how the class key of a native object is found. This is called on
+    /// every property access, so it should be cheap
+    void setClassKeyResolver(ClassKeyResolver resolver);
+    ClassKey classKeyOf(void* object);
+    /// Find the most derived registered class an object is an instance of.
+    /// The result is remembered for the object's class key
+    NativeClass const* nativeClassOf(ClassKey key, void* object);
+}
@@ -0,0 +1,295 @@
+#include "Profiler.hpp"
+#include "Reactive.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+
+using namespace dash::lang;
+
+Profiler* Profiler::s_current = nullptr;
+
+static double toMillis(Profiler::Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static double toMicros(Profiler::Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+/// Escape a string for a JSON string literal
+static std::string escapeJSON(std::string_view str) {
+    std::string result;
+    result.reserve(str.size());
+    for (char c : str) {
+        switch (c) {
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            default: {
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    result += fmt::format("\\u{:04x}", c);
+                }
+                else {
+                    result += c;
+                }
+            } break;
+        }
+    }
+    return result;
+}
+
+Profiler::~Profiler() {
+    this->stop();
+}
+
+bool Profiler::start(Options options) {
+    if (s_current) {
+        return false;
+    }
+    m_options = options;
+    m_functionIndex.clear();
+    m_functions.clear();
+    m_activeCalls.clear();
+    m_nativeIndex.clear();
+    m_propertyIndex.clear();
+    m_natives.clear();
+    m_stack.clear();
+    m_trace.clear();
+    m_samples.clear();
+    ReactiveGraph::get().resetStats();
+
+    s_current = this;
+    m_running = true;
+    m_started = Clock::now();
+    m_sampler = std::thread([this] {
+        while (m_running) {
+            std::this_thread::sleep_for(m_options.sampleInterval);
+            m_sampleDue.store(true, std::memory_order_relaxed);
+        }
+    });
+    return true;
+}
+
+void Profiler::stop() {
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    m_sampler.join();
+    m_sampleDue = false;
+    m_stopped = Clock::now();
+    // Calls that are still running are cut off where profiling stopped
+    while (!m_stack.empty()) {
+        this->leave();
+    }
+    s_current = nullptr;
+}
+
+uint32_t Profiler::functionStats(Module const& module, FunctionID function) {
+    auto [it, inserted] = m_functionIndex.try_emplace(
+        SiteKey { module.generation(), function }, static_cast<uint32_t>(m_functions.size())
+    );
+    if (inserted) {
+        auto const& fun = module.function(function);
+        FunctionStats stats;
+        stats.name = module.string(fun.name)->view();
+        if (auto span = module.debugSpan(fun, 0)) {
+            stats.location = fmt::format(
+                "{}:{}:{}", module.string(span->file)->view(), span->line, span->column
+            );
+        }
+        m_functions.push_back(std::move(stats));
+        m_activeCalls.push_back(0);
+    }
+    return it->second;
+}
+
+uint32_t Profiler::nativeStats(SiteKey key, std::string_view name) {
+    auto [it, inserted] = m_nativeIndex.try_emplace(key, static_cast<uint32_t>(m_natives.size()));
+    if (inserted) {
+        m_natives.push_back(NativeStats { std::string(name) });
+    }
+    return it->second;
+}
+
+void Profiler::recordEvent(uint32_t stats, bool native, Clock::time_point start, Clock::time_point end) {
+    if (m_trace.size() < m_options.maxTraceEvents) {
+        m_trace.push_back(TraceEvent { stats, native, start, end - start });
+    }
+}
+
+void Profiler::enter(Module const& module, FunctionID function, bool counted) {
+    auto stats = this->functionStats(module, function);
+    if (counted) {
+        m_functions[stats].calls += 1;
+    }
+    m_activeCalls[stats] += 1;
+    m_stack.push_back(ActiveCall { stats, Clock::now() });
+}
+
+void Profiler::leave() {
+    if (m_stack.empty()) {
+        return;
+    }
+    auto call = m_stack.back();
+    m_stack.pop_back();
+    auto end = Clock::now();
+    auto elapsed = end - call.start;
+
+    auto& stats = m_functions[call.function];
+    stats.exclusive += elapsed - call.children;
+    // The outermost call of a recursive function already includes the
+    // inner ones
+    if (--m_activeCalls[call.function] == 0) {
+        stats.inclusive += elapsed;
+    }
+    if (!m_stack.empty()) {
+        m_stack.back().children += elapsed;
+    }
+    this->recordEvent(call.function, false, call.start, end);
+}
+
+void Profiler::recordNative(uint32_t index, Clock::time_point start) {
+    auto end = Clock::now();
+    auto& stats = m_natives[index];
+    stats.calls += 1;
+    stats.time += end - start;
+    if (!m_stack.empty()) {
+        m_stack.back().children += end - start;
+    }
+    this->recordEvent(index, true, start, end);
+}
+
+void Profiler::native(Module const& module, uint16_t native, Clock::time_point start) {
+    auto key = SiteKey { module.generation(), native };
+    auto it = m_nativeIndex.find(key);
+    auto index = it != m_nativeIndex.end() ? it->second : this->nativeStats(
+        key,
+        fmt::format("extern {}", module.string(module.natives()[native].name)->view())
+    );
+    this->recordNative(index, start);
+}
+
+void Profiler::property(Symbol name, Clock::time_point start) {
+    auto it = m_propertyIndex.find(name);
+    if (it == m_propertyIndex.end()) {
+        auto index = static_cast<uint32_t>(m_natives.size());
+        m_natives.push_back(NativeStats {
+            fmt::format("property {}", SymbolTable::get().string(name)->view())
+        });
+        it = m_propertyIndex.insert({ name, index }).first;
+    }
+    this->recordNative(it->second, start);
+}
+
+void Profiler::takeSample() {
+    m_sampleDue.store(false, std::memory_order_relaxed);
+    if (m_stack.empty()) {
+        return;
+    }
+    std::string line;
+    for (auto const& call : m_stack) {
+        if (!line.empty()) {
+            line += ';';
+        }
+        line += m_functions[call.function].name;
+    }
+    m_samples[line] += 1;
+}
+
+std::string Profiler::report() const {
+    auto end = m_running ? Clock::now() : m_stopped;
+    std::string out = fmt::format("Profiled {:.1f}ms\n", toMillis(end - m_started));
+
+    std::vector<FunctionStats const*> functions;
+    for (auto const& stats : m_functions) {
+        functions.push_back(&stats);
+    }
+    std::sort(functions.begin(), functions.end(), [](auto a, auto b) {
+        return a->exclusive > b->exclusive;
+    });
+    out += fmt::format("{:>10} {:>12} {:>12}  function\n", "calls", "self ms", "total ms");
+    for (auto stats : functions) {
+        out += fmt::format(
+            "{:>10} {:>12.3f} {:>12.3f}  {}{}{}\n",
+            stats->calls, toMillis(stats->exclusive), toMillis(stats->inclusive), stats->name,
+            stats->location.empty() ? "" : " at ", stats->location
+        );
+    }
+
+    if (!m_natives.empty()) {
+        std::vector<NativeStats const*> natives;
+        for (auto const& stats : m_natives) {
+            natives.push_back(&stats);
+        }
+        std::sort(natives.begin(), natives.end(), [](auto a, auto b) {
+            return a->time > b->time;
+        });
+        out += fmt::format("{:>10} {:>12}  native\n", "calls", "ms");
+        for (auto stats : natives) {
+            out += fmt::format("{:>10} {:>12.3f}  {}\n", stats->calls, toMillis(stats->time), stats->name);
+        }
+    }
+
+    auto reactive = ReactiveGraph::get().stats();
+    if (!reactive.empty()) {
+        std::sort(reactive.begin(), reactive.end(), [](auto const& a, auto const& b) {
+            return a.updates > b.updates;
+        });
+        out += fmt::format("{:>10}  reactive node\n", "updates");
+        for (auto const& node : reactive) {
+            out += fmt::format(
+                "{:>10}  {}\n",
+                node.updates, node.label.empty() ? fmt::format("#{}", node.id) : std::string(node.label)
+            );
+        }
+    }
+    return out;
+}
+
+std::optional<std::string> Profiler::writeChromeTrace(std::filesystem::path const& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        return fmt::format("Unable to write {}", path.string());
+    }
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (auto const& event : m_trace) {
+        // Natives aren't located in the source, only the functions calling
+        // them are
+        std::string_view name, location;
+        if (event.native) {
+            name = m_natives[event.stats].name;
+        }
+        else {
+            name = m_functions[event.stats].name;
+            location = m_functions[event.stats].location;
+        }
+        out << (first ? "\n" : ",\n") << fmt::format(
+            R"({{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":1,"args":{{"location":"{}"}}}})",
+            escapeJSON(name), event.native ? "native" : "script",
+            toMicros(event.start - m_started), toMicros(event.duration), escapeJSON(location)
+        );
+        first = false;
+    }
+    out << "\n]}\n";
+    if (!out) {
+        return fmt::format("Unable to write {}", path.string());
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string> Profiler::writeFoldedStacks(std::filesystem::path const& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        return fmt::format("Unable to write {}", path.string());
+    }
+    for (auto const& [stack, count] : m_samples) {
+        out << stack << ' ' << count << '\n';
+    }
+    if (!out) {
+        return fmt::format("Unable to write {}", path.string());
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "Module.hpp"
+#include "Symbol.hpp"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dash::lang {
+    /// Records where script time goes: calls and inclusive and exclusive
+    /// time of every script function, time spent in every native function
+    /// and native property, and a timeline of calls that can be written out
+    /// as a Chrome trace. A sampler thread asks the VM to record the current
+    /// call stack at a fixed interval, which is written out as folded stacks
+    /// for flamegraphs. Reactive update counts are read from the reactive
+    /// graph when reporting.
+    ///
+    /// Only one profiler can run at a time. VMs check for it once per call
+    /// into them, so profiling costs nothing while it's stopped. Functions
+    /// are named and located from the module's debug info when they are
+    /// first seen, so profiles stay readable after their modules are freed
+    class Profiler final {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Options {
+            /// How often the call stack is sampled
+            std::chrono::microseconds sampleInterval { 1000 };
+            /// Calls beyond this many are still counted, but left out of the
+            /// timeline
+            size_t maxTraceEvents = 1 << 20;
+        };
+
+        struct FunctionStats {
+            std::string name;
+            /// Source location of the function as `file:line:column`, if the
+            /// module has debug info
+            std::string location;
+            uint64_t calls = 0;
+            /// Time from entering to leaving the function, including callees.
+            /// Recursive calls are only counted once
+            Clock::duration inclusive {};
+            /// Time spent in the function's own code
+            Clock::duration exclusive {};
+        };
+        /// A native function or property
+        struct NativeStats {
+            std::string name;
+            uint64_t calls = 0;
+            Clock::duration time {};
+        };
+
+    private:
+        struct SiteKey {
+            /// Modules are told apart by their generation, since a reloaded
+            /// module can end up at the address of the one it replaces
+            uint64_t module;
+            uint32_t index;
+
+            bool operator==(SiteKey const&) const = default;
+        };
+        struct SiteKeyHash {
+            size_t operator()(SiteKey const& key) const {
+                return std::hash<uint64_t>()(key.module) ^ (key.index * 0x9e3779b97f4a7c15ull);
+            }
+        };
+        struct ActiveCall {
+            uint32_t function;
+            Clock::time_point start;
+            /// Time spent in callees and natives so far
+            Clock::duration children {};
+        };
+        struct TraceEvent {
+            /// Index into the function or native stats
+            uint32_t stats;
+            bool native;
+            Clock::time_point start;
+            Clock::duration duration;
+        };
+
+        static Profiler* s_current;
+
+        Options m_options;
+        std::unordered_map<SiteKey, uint32_t, SiteKeyHash> m_functionIndex;
+        std::vector<FunctionStats> m_functions;
+        /// How many calls of each function are active, indexed like
+        /// `m_functions`
+        std::vector<uint32_t> m_activeCalls;
+        std::unordered_map<SiteKey, uint32_t, SiteKeyHash> m_nativeIndex;
+        std::unordered_map<Symbol, uint32_t> m_propertyIndex;
+        std::vector<NativeStats> m_natives;
+        std::vector<ActiveCall> m_stack;
+        std::vector<TraceEvent> m_trace;
+        /// Sampled call stacks as folded stack lines, and how often each was
+        /// seen
+        std::unordered_map<std::string, uint64_t> m_samples;
+        Clock::time_point m_started;
+        Clock::time_point m_stopped;
+        std::thread m_sampler;
+        std::atomic<bool> m_sampleDue = false;
+        std::atomic<bool> m_running = false;
+
+        uint32_t functionStats(Module const& module, FunctionID function);
+        uint32_t nativeStats(SiteKey key, std::string_view name);
+        void recordNative(uint32_t stats, Clock::time_point start);
+        void recordEvent(uint32_t stats, bool native, Clock::time_point start, Clock::time_point end);
+        void takeSample();
+
+    public:
+        Profiler() = default;
+        ~Profiler();
+
+        Profiler(Profiler const&) = delete;
+        Profiler& operator=(Profiler const&) = delete;
+
+        /// The profiler that is running, if any
+        static Profiler* current() {
+            return s_current;
+        }
+
+        /// Clear everything recorded so far and start recording. Fails if
+        /// another profiler is already running
+        bool start(Options options);
+        bool start() {
+            return this->start(Options());
+        }
+        void stop();
+        bool isRunning() const {
+            return m_running;
+        }
+
+        // These are called by VMs while the profiler is running
+
+        /// A script function was entered. `counted` is false when a task
+        /// that was already in the function is resumed
+        void enter(Module const& module, FunctionID function, bool counted = true);
+        /// The innermost function that was entered was left
+        void leave();
+        void native(Module const& module, uint16_t native, Clock::time_point start);
+        void property(Symbol name, Clock::time_point start);
+        /// Check whether the sampler wants a sample, and take it. Cheap
+        /// enough to call at every safepoint
+        void poll() {
+            if (m_sampleDue.load(std::memory_order_relaxed)) [[unlikely]] {
+                this->takeSample();
+            }
+        }
+
+        std::vector<FunctionStats> const& functions() const {
+            return m_functions;
+        }
+        std::vector<NativeStats> const& natives() const {
+            return m_natives;
+        }
+        /// A table of the hottest functions and natives, and of reactive
+        /// nodes by how often they were updated
+        std::string report() const;
+        /// Write the timeline in the Chrome trace event format, for
+        /// chrome://tracing or Perfetto
+        std::optional<std::string> writeChromeTrace(std::filesystem::path const& path) const;
+        /// Write the sampled stacks in the folded format flamegraph tools
+        /// like inferno and speedscope read
+        std::optional<std::string> writeFoldedStacks(std::filesystem::path const& path) const;
+    };
+}
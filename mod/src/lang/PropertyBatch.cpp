@@ -0,0 +1,105 @@
+#include "PropertyBatch.hpp"
+#include <bit>
+
+using namespace dash::lang;
+
+PropertyBatch& PropertyBatch::get() {
+    static PropertyBatch batch;
+    return batch;
+}
+
+void PropertyBatch::setObjectHooks(ObjectHook retain, ObjectHook release) {
+    m_retain = retain;
+    m_release = release;
+}
+
+void PropertyBatch::setFlushScheduler(std::function<void()> scheduler) {
+    m_scheduler = std::move(scheduler);
+}
+
+size_t PropertyBatch::find(void* object, PropertyGroup const* group) const {
+    if (
+        m_last < m_entries.size() &&
+        m_entries[m_last].object == object && m_entries[m_last].group == group
+    ) {
+        return m_last;
+    }
+    auto it = m_index.find(EntryKey { object, group });
+    if (it == m_index.end()) {
+        return NOT_FOUND;
+    }
+    m_last = it->second;
+    return m_last;
+}
+
+void PropertyBatch::stage(void* object, NativeProperty const& property, Value const& value) {
+    auto index = this->find(object, property.group);
+    if (index == NOT_FOUND) {
+        index = m_entries.size();
+        m_index.insert({ EntryKey { object, property.group }, index });
+        m_entries.push_back(Entry { object, property.group, {}, 0 });
+        if (m_retain) {
+            m_retain(object);
+        }
+        if (m_scheduler && !m_flushScheduled) {
+            m_flushScheduled = true;
+            m_scheduler();
+        }
+    }
+    auto& entry = m_entries[index];
+    entry.values[property.component] = value;
+    entry.dirty |= 1u << property.component;
+}
+
+Value const* PropertyBatch::staged(void* object, NativeProperty const& property) const {
+    auto index = this->find(object, property.group);
+    if (index == NOT_FOUND) {
+        return nullptr;
+    }
+    auto const& entry = m_entries[index];
+    if (!(entry.dirty & (1u << property.component))) {
+        return nullptr;
+    }
+    return &entry.values[property.component];
+}
+
+void PropertyBatch::flush() {
+    m_flushScheduled = false;
+    // Applying may run arbitrary native code, which could stage more writes
+    // or even flush again, so the entries are swapped out first
+    std::vector<Entry> entries;
+    entries.swap(m_flushed);
+    entries.swap(m_entries);
+    m_index.clear();
+    for (auto& entry : entries) {
+        auto const& group = *entry.group;
+        uint32_t all = (1u << group.componentCount) - 1;
+        if ((entry.dirty & all) == all) {
+            group.apply(entry.object, entry.values);
+        }
+        else if (group.update && std::has_single_bit(entry.dirty)) {
+            // A single component can be written in place without reading
+            // the rest of the group back from the object
+            auto component = static_cast<uint8_t>(std::countr_zero(entry.dirty));
+            group.update(entry.object, component, entry.values[component]);
+        }
+        else {
+            // Components that weren't written keep their current values
+            Value current[PropertyGroup::MAX_COMPONENTS];
+            group.load(entry.object, current);
+            for (uint8_t i = 0; i < group.componentCount; i += 1) {
+                if (!(entry.dirty & (1u << i))) {
+                    entry.values[i] = current[i];
+                }
+            }
+            group.apply(entry.object, entry.values);
+        }
+        if (m_release) {
+            m_release(entry.object);
+        }
+    }
+    entries.clear();
+    if (entries.capacity() > m_flushed.capacity()) {
+        m_flushed.swap(entries);
+    }
+}
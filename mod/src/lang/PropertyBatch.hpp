@@ -0,0 +1,86 @@
+#pragma once
+
+#include "NativeClass.hpp"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace dash::lang {
+    /// Staged writes to grouped properties. Assigning several components of a
+    /// group, like a node's x and y, only records the new values; once per
+    /// frame every group with staged writes is applied to its object with a
+    /// single native call, like one `setPosition` instead of a `setPositionX`
+    /// and a `setPositionY` that each invalidate the node's transform
+    class PropertyBatch final {
+    public:
+        using ObjectHook = void(*)(void* object);
+
+    private:
+        struct Entry {
+            void* object;
+            PropertyGroup const* group;
+            Value values[PropertyGroup::MAX_COMPONENTS];
+            /// Which components have been written
+            uint32_t dirty;
+        };
+        struct EntryKey {
+            void* object;
+            PropertyGroup const* group;
+
+            bool operator==(EntryKey const&) const = default;
+        };
+        struct EntryKeyHash {
+            size_t operator()(EntryKey const& key) const {
+                return std::hash<void*>()(key.object) ^ std::hash<void const*>()(key.group) * 31;
+            }
+        };
+
+        std::vector<Entry> m_entries;
+        /// The entries of the last flush, kept so their storage can be
+        /// reused instead of reallocated every frame
+        std::vector<Entry> m_flushed;
+        std::unordered_map<EntryKey, size_t, EntryKeyHash> m_index;
+        /// The entry that was accessed last. Scripts usually write several
+        /// components of the same object in a row, so this skips most lookups
+        mutable size_t m_last = 0;
+        std::function<void()> m_scheduler;
+        ObjectHook m_retain = nullptr;
+        ObjectHook m_release = nullptr;
+        bool m_flushScheduled = false;
+
+        static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+        /// Find the index of an object's entry for a group
+        size_t find(void* object, PropertyGroup const* group) const;
+
+    public:
+        PropertyBatch() = default;
+
+        PropertyBatch(PropertyBatch const&) = delete;
+        PropertyBatch& operator=(PropertyBatch const&) = delete;
+
+        static PropertyBatch& get();
+
+        /// Set how objects with staged writes are kept alive until the writes
+        /// are applied
+        void setObjectHooks(ObjectHook retain, ObjectHook release);
+        /// Install a function that arranges for `flush` to be called later,
+        /// for example on the next frame. Without a scheduler, writes are
+        /// only applied when `flush` is called explicitly
+        void setFlushScheduler(std::function<void()> scheduler);
+
+        bool empty() const {
+            return m_entries.empty();
+        }
+
+        /// Stage a write to a grouped property. The value must already have
+        /// been checked with the property's `check`
+        void stage(void* object, NativeProperty const& property, Value const& value);
+        /// Get the staged value of a grouped property, if it has been written
+        /// since the last flush. Reads must see staged values, since the
+        /// object itself hasn't been updated yet
+        Value const* staged(void* object, NativeProperty const& property) const;
+        /// Apply every staged write
+        void flush();
+    };
+}
@@ -0,0 +1,257 @@
+#include "Reactive.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace dash::lang;
+
+// Entries in the dirty queue are (height, id) pairs so the heap stays valid
+// even if a node's height changes while it's queued
+static bool queueOrder(uint64_t a, uint64_t b) {
+    return a > b;
+}
+
+static uint64_t queueEntry(uint32_t height, ReactiveID id) {
+    return static_cast<uint64_t>(height) << 32 | id;
+}
+
+static void eraseID(std::vector<ReactiveID>& ids, ReactiveID id) {
+    auto it = std::find(ids.begin(), ids.end(), id);
+    if (it != ids.end()) {
+        *it = ids.back();
+        ids.pop_back();
+    }
+}
+
+ReactiveGraph& ReactiveGraph::get() {
+    static ReactiveGraph graph;
+    return graph;
+}
+
+ReactiveID ReactiveGraph::create(Kind kind, std::function<bool()> evaluate) {
+    ReactiveID id;
+    if (!m_freeIDs.empty()) {
+        id = m_freeIDs.back();
+        m_freeIDs.pop_back();
+    }
+    else {
+        id = static_cast<ReactiveID>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+    auto& node = m_nodes[id];
+    node.evaluate = std::move(evaluate);
+    node.kind = kind;
+    node.alive = true;
+    if (kind != Kind::Signal) {
+        this->evaluate(id);
+    }
+    return id;
+}
+
+ReactiveID ReactiveGraph::createSignal() {
+    return this->create(Kind::Signal, nullptr);
+}
+
+ReactiveID ReactiveGraph::createDerived(std::function<bool()> evaluate) {
+    return this->create(Kind::Derived, std::move(evaluate));
+}
+
+ReactiveID ReactiveGraph::createEffect(std::function<void()> run) {
+    return this->create(Kind::Effect, [run = std::move(run)] {
+        run();
+        return false;
+    });
+}
+
+void ReactiveGraph::destroy(ReactiveID id) {
+    this->clearSources(id);
+    for (auto observer : m_nodes[id].observers) {
+        eraseID(m_nodes[observer].sources, id);
+    }
+    // Whatever the node's function holds on to, like the script an effect
+    // runs, may destroy other nodes when it's released, so it's only
+    // released once the graph is consistent again
+    auto evaluate = std::move(m_nodes[id].evaluate);
+    m_nodes[id] = Node();
+    m_freeIDs.push_back(id);
+}
+
+void ReactiveGraph::setLabel(ReactiveID id, std::string label) {
+    m_nodes[id].label = std::move(label);
+}
+
+void ReactiveGraph::clearSources(ReactiveID id) {
+    for (auto source : m_nodes[id].sources) {
+        eraseID(m_nodes[source].observers, id);
+    }
+    m_nodes[id].sources.clear();
+}
+
+void ReactiveGraph::evaluate(ReactiveID id) {
+    // Dependencies are rediscovered on every evaluation since they may
+    // depend on the values read
+    this->clearSources(id);
+    m_nodes[id].dirty = false;
+    m_nodes[id].height = 0;
+    m_nodes[id].updates += 1;
+
+    // Evaluating may create nodes, which can reallocate the node list, so
+    // the function can't be called through a reference into it
+    auto evaluate = std::move(m_nodes[id].evaluate);
+    m_evaluating.push_back(id);
+    auto changed = evaluate();
+    m_evaluating.pop_back();
+
+    // The node may have destroyed itself
+    if (!m_nodes[id].alive) {
+        return;
+    }
+    m_nodes[id].evaluate = std::move(evaluate);
+    if (changed) {
+        this->enqueueObservers(id);
+    }
+}
+
+void ReactiveGraph::enqueueObservers(ReactiveID id) {
+    for (auto observer : m_nodes[id].observers) {
+        auto& node = m_nodes[observer];
+        if (!node.dirty) {
+            node.dirty = true;
+            m_queue.push_back(queueEntry(node.height, observer));
+            std::push_heap(m_queue.begin(), m_queue.end(), queueOrder);
+        }
+    }
+}
+
+void ReactiveGraph::track(ReactiveID id) {
+    if (m_evaluating.empty()) {
+        return;
+    }
+    // Heights only order the common case; a dirty source that hasn't been
+    // reached yet is brought up to date here so nothing reads a stale value
+    if (m_nodes[id].kind == Kind::Derived && m_nodes[id].dirty) {
+        this->evaluate(id);
+    }
+    auto observer = m_evaluating.back();
+    auto& sources = m_nodes[observer].sources;
+    if (std::find(sources.begin(), sources.end(), id) != sources.end()) {
+        return;
+    }
+    sources.push_back(id);
+    m_nodes[id].observers.push_back(observer);
+    m_nodes[observer].height = std::max(m_nodes[observer].height, m_nodes[id].height + 1);
+}
+
+void ReactiveGraph::changed(ReactiveID signal) {
+    m_nodes[signal].updates += 1;
+    this->enqueueObservers(signal);
+    this->requestFlush();
+}
+
+void ReactiveGraph::requestFlush() {
+    // Writes made while flushing are picked up by the running flush
+    if (m_flushing || m_batchDepth > 0 || m_queue.empty()) {
+        return;
+    }
+    if (!m_scheduler) {
+        this->flush();
+    }
+    else if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        m_scheduler();
+    }
+}
+
+void ReactiveGraph::setFlushScheduler(std::function<void()> scheduler) {
+    m_scheduler = std::move(scheduler);
+}
+
+void ReactiveGraph::flush() {
+    if (m_flushing) {
+        return;
+    }
+    m_flushing = true;
+    m_flushScheduled = false;
+    while (!m_queue.empty()) {
+        std::pop_heap(m_queue.begin(), m_queue.end(), queueOrder);
+        auto id = static_cast<ReactiveID>(m_queue.back() & 0xffffffff);
+        m_queue.pop_back();
+        // Nodes that were destroyed or already pulled up to date while
+        // queued are skipped
+        if (m_nodes[id].alive && m_nodes[id].dirty) {
+            this->evaluate(id);
+        }
+    }
+    m_flushing = false;
+}
+
+std::vector<ReactiveGraph::NodeStats> ReactiveGraph::stats() const {
+    std::vector<NodeStats> stats;
+    for (ReactiveID id = 0; id < m_nodes.size(); id += 1) {
+        auto const& node = m_nodes[id];
+        if (node.alive && node.updates > 0) {
+            stats.push_back({ id, node.kind, node.label, node.updates });
+        }
+    }
+    return stats;
+}
+
+void ReactiveGraph::resetStats() {
+    for (auto& node : m_nodes) {
+        node.updates = 0;
+    }
+}
+
+SignalTable::~SignalTable() {
+    for (auto const& entry : m_entries) {
+        m_graph.destroy(entry->id);
+    }
+}
+
+bool SignalTable::store(Entry& entry, Value value) {
+    if (value == entry.value && value.type() == entry.value.type()) {
+        return false;
+    }
+    entry.string.reset();
+    if (value.is(ValueType::String)) {
+        auto str = value.asString();
+        entry.string = std::make_unique<uint8_t[]>(sizeof(uint32_t) + str->size + 1);
+        std::memcpy(entry.string.get(), str, sizeof(uint32_t) + str->size + 1);
+        value = Value::fromString(reinterpret_cast<String const*>(entry.string.get()));
+    }
+    entry.value = value;
+    return true;
+}
+
+SignalTable::Handle SignalTable::createSignal(Value value) {
+    auto& entry = *m_entries.emplace_back(std::make_unique<Entry>());
+    store(entry, value);
+    entry.id = m_graph.createSignal();
+    return static_cast<Handle>(m_entries.size() - 1);
+}
+
+SignalTable::Handle SignalTable::createDerived(std::function<std::optional<Value>()> compute) {
+    auto& entry = *m_entries.emplace_back(std::make_unique<Entry>());
+    entry.derived = true;
+    entry.id = m_graph.createDerived([&entry, compute = std::move(compute)] {
+        auto value = compute();
+        return value && store(entry, *value);
+    });
+    return static_cast<Handle>(m_entries.size() - 1);
+}
+
+Value SignalTable::get(Handle handle) const {
+    auto const& entry = *m_entries[handle];
+    m_graph.track(entry.id);
+    return entry.value;
+}
+
+void SignalTable::set(Handle handle, Value value) {
+    auto& entry = *m_entries[handle];
+    if (store(entry, value)) {
+        m_graph.changed(entry.id);
+    }
+}
+
+void SignalTable::setLabel(Handle handle, std::string label) {
+    m_graph.setLabel(m_entries[handle]->id, std::move(label));
+}
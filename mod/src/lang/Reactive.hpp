@@ -0,0 +1,276 @@
+#pragma once
+
+#include "Value.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dash::lang {
+    using ReactiveID = uint32_t;
+
+    /// A dependency graph of signals, derived values and effects. Reads are
+    /// tracked while a derived value or effect is being evaluated, so
+    /// dependencies are discovered automatically and may change between
+    /// evaluations.
+    ///
+    /// Writing a signal only marks its dependents dirty. Dirty nodes are
+    /// re-evaluated in one flush, in topological order (by height in the
+    /// graph), so every dependent runs at most once per flush no matter how
+    /// many of its sources were written. With a flush scheduler installed,
+    /// writes are coalesced until the scheduler runs the flush, usually once
+    /// per frame
+    class ReactiveGraph final {
+    public:
+        enum class Kind : uint8_t {
+            Signal,
+            Derived,
+            Effect,
+        };
+
+    private:
+        struct Node {
+            /// Re-evaluates the node; returns whether its value changed. Empty
+            /// for signals
+            std::function<bool()> evaluate;
+            std::vector<ReactiveID> sources;
+            std::vector<ReactiveID> observers;
+            /// Longest path from a signal; a node is always higher than all
+            /// of its sources
+            uint32_t height = 0;
+            /// How many times the node was evaluated, or for signals how
+            /// many times it changed, since stats were last reset
+            uint32_t updates = 0;
+            Kind kind = Kind::Signal;
+            bool dirty = false;
+            bool alive = false;
+            /// What the node is bound to, like the property it drives, for
+            /// profiling
+            std::string label;
+        };
+
+        std::vector<Node> m_nodes;
+        std::vector<ReactiveID> m_freeIDs;
+        /// Dirty nodes as (height, id) entries, in a min-heap on height
+        std::vector<uint64_t> m_queue;
+        /// Nodes currently being evaluated; reads are recorded as
+        /// dependencies of the innermost one
+        std::vector<ReactiveID> m_evaluating;
+        std::function<void()> m_scheduler;
+        size_t m_batchDepth = 0;
+        bool m_flushScheduled = false;
+        bool m_flushing = false;
+
+        ReactiveID create(Kind kind, std::function<bool()> evaluate);
+        void evaluate(ReactiveID id);
+        void enqueueObservers(ReactiveID id);
+        void clearSources(ReactiveID id);
+        void requestFlush();
+
+    public:
+        struct NodeStats {
+            ReactiveID id;
+            Kind kind;
+            std::string_view label;
+            uint32_t updates;
+        };
+
+        ReactiveGraph() = default;
+
+        ReactiveGraph(ReactiveGraph const&) = delete;
+        ReactiveGraph& operator=(ReactiveGraph const&) = delete;
+
+        /// The graph the runtime's UI bindings live in
+        static ReactiveGraph& get();
+
+        ReactiveID createSignal();
+        /// Create a derived value. `evaluate` recomputes the value and returns
+        /// whether it changed; it is run once right away to discover its
+        /// dependencies
+        ReactiveID createDerived(std::function<bool()> evaluate);
+        /// Create an effect, which is re-run whenever something it read
+        /// changes. It is run once right away to discover its dependencies
+        ReactiveID createEffect(std::function<void()> run);
+        void destroy(ReactiveID id);
+        /// Name a node in profiles
+        void setLabel(ReactiveID id, std::string label);
+
+        /// Record a read of a node, making it a dependency of whatever is
+        /// being evaluated. Dirty derived values are brought up to date first
+        void track(ReactiveID id);
+        /// Notify the graph that a signal's value changed
+        void changed(ReactiveID signal);
+
+        /// Run a function without flushing until it returns, even if no
+        /// scheduler is installed
+        template <class F>
+        void batch(F&& func) {
+            m_batchDepth += 1;
+            std::forward<F>(func)();
+            m_batchDepth -= 1;
+            if (m_batchDepth == 0 && !m_queue.empty()) {
+                this->requestFlush();
+            }
+        }
+
+        /// Install a function that arranges for `flush` to be called later,
+        /// for example on the next frame. Without a scheduler, writes are
+        /// flushed right away (or at the end of the outermost batch)
+        void setFlushScheduler(std::function<void()> scheduler);
+        /// Re-evaluate every dirty node
+        void flush();
+
+        size_t dirtyCount() const {
+            return m_queue.size();
+        }
+        /// Update counts of every live node that updated since the last
+        /// reset
+        std::vector<NodeStats> stats() const;
+        void resetStats();
+    };
+
+    /// A reactive value that can be written directly
+    template <class T>
+    class Signal final {
+    private:
+        ReactiveGraph& m_graph;
+        ReactiveID m_id;
+        T m_value;
+
+    public:
+        Signal(T value, ReactiveGraph& graph = ReactiveGraph::get())
+          : m_graph(graph), m_id(graph.createSignal()), m_value(std::move(value)) {}
+        ~Signal() {
+            m_graph.destroy(m_id);
+        }
+
+        Signal(Signal const&) = delete;
+        Signal& operator=(Signal const&) = delete;
+
+        T const& get() const {
+            m_graph.track(m_id);
+            return m_value;
+        }
+        /// Get the value without becoming dependent on it
+        T const& peek() const {
+            return m_value;
+        }
+        void set(T value) {
+            if (m_value == value) {
+                return;
+            }
+            m_value = std::move(value);
+            m_graph.changed(m_id);
+        }
+    };
+
+    /// A value computed from other reactive values. It is only recomputed
+    /// when one of its sources changes, and only notifies its own dependents
+    /// if the result is different
+    template <class T>
+    class Derived final {
+    private:
+        ReactiveGraph& m_graph;
+        std::function<T()> m_compute;
+        T m_value {};
+        ReactiveID m_id;
+
+    public:
+        Derived(std::function<T()> compute, ReactiveGraph& graph = ReactiveGraph::get())
+          : m_graph(graph), m_compute(std::move(compute)),
+            m_id(graph.createDerived([this] {
+                auto value = m_compute();
+                if (value == m_value) {
+                    return false;
+                }
+                m_value = std::move(value);
+                return true;
+            })) {}
+        ~Derived() {
+            m_graph.destroy(m_id);
+        }
+
+        Derived(Derived const&) = delete;
+        Derived& operator=(Derived const&) = delete;
+
+        T const& get() const {
+            m_graph.track(m_id);
+            return m_value;
+        }
+    };
+
+    /// A side effect, like updating a node's property, that re-runs whenever
+    /// a reactive value it read changes
+    class Effect final {
+    private:
+        ReactiveGraph& m_graph;
+        ReactiveID m_id;
+
+    public:
+        Effect(std::function<void()> run, ReactiveGraph& graph = ReactiveGraph::get())
+          : m_graph(graph), m_id(graph.createEffect(std::move(run))) {}
+        ~Effect() {
+            m_graph.destroy(m_id);
+        }
+
+        Effect(Effect const&) = delete;
+        Effect& operator=(Effect const&) = delete;
+    };
+
+    /// The signals and derived values of a script, holding VM values.
+    /// Scripts refer to them by handle, and they all live as long as the
+    /// table. Strings are copied into the table, since strings created at
+    /// runtime only live as long as the call that created them
+    class SignalTable final {
+    public:
+        using Handle = uint32_t;
+
+    private:
+        struct Entry {
+            ReactiveID id = 0;
+            Value value;
+            std::unique_ptr<uint8_t[]> string;
+            bool derived = false;
+        };
+
+        ReactiveGraph& m_graph;
+        /// Derived values are evaluated through pointers to their entries,
+        /// so entries can't move
+        std::vector<std::unique_ptr<Entry>> m_entries;
+
+        static bool store(Entry& entry, Value value);
+
+    public:
+        SignalTable(ReactiveGraph& graph = ReactiveGraph::get()) : m_graph(graph) {}
+        ~SignalTable();
+
+        SignalTable(SignalTable const&) = delete;
+        SignalTable& operator=(SignalTable const&) = delete;
+
+        Handle createSignal(Value value);
+        /// Create a derived value. `compute` returns the new value, or
+        /// nothing to keep the current one, for example if it failed
+        Handle createDerived(std::function<std::optional<Value>()> compute);
+        bool contains(Handle handle) const {
+            return handle < m_entries.size();
+        }
+        bool isDerived(Handle handle) const {
+            return m_entries[handle]->derived;
+        }
+        /// Read a value, making it a dependency of whatever is being
+        /// evaluated
+        Value get(Handle handle) const;
+        /// Read a value without becoming dependent on it
+        Value peek(Handle handle) const {
+            return m_entries[handle]->value;
+        }
+        /// Write a signal, updating everything that depends on it if the
+        /// value changed
+        void set(Handle handle, Value value);
+        void setLabel(Handle handle, std::string label);
+    };
+}
@@ -0,0 +1,41 @@
+#include "SourceWatcher.hpp"
+#include <algorithm>
+
+using namespace dash::lang;
+
+void SourceWatcher::watch(std::filesystem::path const& path) {
+    if (this->isWatching(path)) {
+        return;
+    }
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    auto size = std::filesystem::file_size(path, ec);
+    m_files.push_back(File { path, time, ec ? 0 : size });
+}
+
+void SourceWatcher::unwatch(std::filesystem::path const& path) {
+    std::erase_if(m_files, [&](File const& file) { return file.path == path; });
+}
+
+bool SourceWatcher::isWatching(std::filesystem::path const& path) const {
+    return std::any_of(m_files.begin(), m_files.end(), [&](File const& file) {
+        return file.path == path;
+    });
+}
+
+std::vector<std::filesystem::path> SourceWatcher::poll() {
+    std::vector<std::filesystem::path> changed;
+    for (auto& file : m_files) {
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(file.path, ec);
+        if (ec) continue;
+        auto size = std::filesystem::file_size(file.path, ec);
+        if (ec) continue;
+        if (time != file.time || size != file.size) {
+            file.time = time;
+            file.size = size;
+            changed.push_back(file.path);
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+namespace dash::lang {
+    /// Polls source files for changes. Files are compared by their last write
+    /// time and size, so this is cheap enough to run a few times a second
+    class SourceWatcher final {
+    private:
+        struct File {
+            std::filesystem::path path;
+            std::filesystem::file_time_type time;
+            uintmax_t size;
+        };
+
+        std::vector<File> m_files;
+
+    public:
+        /// Start watching a file. Changes made before this call aren't
+        /// reported
+        void watch(std::filesystem::path const& path);
+        void unwatch(std::filesystem::path const& path);
+        bool isWatching(std::filesystem::path const& path) const;
+
+        /// Get the files that changed since the last poll. Files that can't
+        /// be read at the moment, for example because an editor is in the
+        /// middle of saving them, are reported once they can be
+        std::vector<std::filesystem::path> poll();
+    };
+}
@@ -0,0 +1,36 @@
+#include "Std.hpp"
+#include "Compiler.hpp"
+#include "MappedFile.hpp"
+#include "Module.hpp"
+#include <fmt/format.h>
+#include <memory>
+
+using namespace dash::lang;
+
+StdLibrary& StdLibrary::get() {
+    static StdLibrary std;
+    return std;
+}
+
+std::optional<std::string> StdLibrary::load(std::filesystem::path const& path) {
+    if (m_loaded) {
+        return std::nullopt;
+    }
+    auto file = std::make_shared<MappedFile>();
+    if (auto err = file->open(path)) {
+        return err;
+    }
+    // Loading the image checks that it's a valid image for this runtime
+    // before the compiler trusts it. Both read the mapping in place
+    Module module;
+    if (auto err = module.load(file->data(), file)) {
+        return err;
+    }
+    // The compiler decodes the symbol table into its own copy, so the
+    // mapping isn't needed afterwards
+    if (!loadCompilerStd(file->data())) {
+        return fmt::format("The compiler rejected {}", path.string());
+    }
+    m_loaded = true;
+    return std::nullopt;
+}
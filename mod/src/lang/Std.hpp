@@ -0,0 +1,33 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace dash::lang {
+    /// The standard library that every module implicitly imports. Std is
+    /// shipped as a precompiled image whose symbol table is all that's
+    /// needed to check modules against it, so it's loaded into the embedded
+    /// compiler once at startup instead of its sources being checked again
+    /// for each compile
+    class StdLibrary final {
+    private:
+        bool m_loaded = false;
+
+        StdLibrary() = default;
+
+    public:
+        static StdLibrary& get();
+
+        StdLibrary(StdLibrary const&) = delete;
+        StdLibrary& operator=(StdLibrary const&) = delete;
+
+        /// Map the precompiled Std image and hand its symbol table to the
+        /// embedded compiler. Must be called before anything is compiled;
+        /// later calls do nothing
+        std::optional<std::string> load(std::filesystem::path const& path);
+        bool isLoaded() const {
+            return m_loaded;
+        }
+    };
+}
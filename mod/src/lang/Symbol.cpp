@@ -0,0 +1,61 @@
+#include "Symbol.hpp"
+
+using namespace dash::lang;
+
+SymbolTable& SymbolTable::get() {
+    static SymbolTable table;
+    return table;
+}
+
+Symbol SymbolTable::intern(std::string_view str) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_symbols.find(str);
+    if (it != m_symbols.end()) {
+        return it->second;
+    }
+    auto mem = m_storage.allocate(sizeof(uint32_t) + str.size() + 1, alignof(String));
+    auto count = m_chunkCount.load(std::memory_order_relaxed);
+    if (count == 0 || m_chunks[count - 1].data() != m_storage.currentChunk().data()) {
+        m_chunks[count] = m_storage.currentChunk();
+        m_chunkCount.store(count + 1, std::memory_order_release);
+    }
+    auto copy = reinterpret_cast<String*>(mem);
+    copy->size = static_cast<uint32_t>(str.size());
+    std::memcpy(copy->data, str.data(), str.size());
+    copy->data[str.size()] = '\0';
+
+    auto symbol = static_cast<Symbol>(m_strings.size());
+    m_strings.push_back(copy);
+    m_symbols.insert({ copy->view(), symbol });
+    return symbol;
+}
+
+std::optional<Symbol> SymbolTable::find(std::string_view str) const {
+    std::lock_guard lock(m_mutex);
+    auto it = m_symbols.find(str);
+    if (it == m_symbols.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+String const* SymbolTable::string(Symbol symbol) const {
+    std::lock_guard lock(m_mutex);
+    return m_strings.at(symbol);
+}
+
+bool SymbolTable::owns(String const* str) const {
+    auto p = reinterpret_cast<uint8_t const*>(str);
+    auto count = m_chunkCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i += 1) {
+        if (p >= m_chunks[i].data() && p < m_chunks[i].data() + m_chunks[i].size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t SymbolTable::size() const {
+    std::lock_guard lock(m_mutex);
+    return m_strings.size();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Arena.hpp"
+#include "Value.hpp"
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dash::lang {
+    /// An interned string. Equal strings are always interned as the same
+    /// symbol, so symbols can be compared and hashed as plain integers
+    using Symbol = uint32_t;
+
+    /// The process-wide table of interned strings. Every module interns its
+    /// string table when it's loaded, so literals like property names and
+    /// sprite names that appear in many modules share a single copy, and
+    /// equal literals are always the same `String`. Interned strings are
+    /// never freed
+    class SymbolTable final {
+    private:
+        /// Chunks start at `Arena::CHUNK_SIZE` and double, so this is more
+        /// than the address space could ever hold
+        static constexpr size_t MAX_CHUNKS = 48;
+
+        /// Modules may be loaded off the main thread
+        mutable std::mutex m_mutex;
+        Arena m_storage;
+        /// The chunks of `m_storage`, published for `owns`. The table never
+        /// rewinds its arena, so chunks are only ever added, and an entry
+        /// never changes once `m_chunkCount` includes it
+        std::span<const uint8_t> m_chunks[MAX_CHUNKS];
+        std::atomic<size_t> m_chunkCount = 0;
+        std::vector<String const*> m_strings;
+        /// Views into `m_storage`, so lookups never allocate
+        std::unordered_map<std::string_view, Symbol> m_symbols;
+
+        SymbolTable() = default;
+
+    public:
+        static SymbolTable& get();
+
+        SymbolTable(SymbolTable const&) = delete;
+        SymbolTable& operator=(SymbolTable const&) = delete;
+
+        Symbol intern(std::string_view str);
+        /// Find the symbol of a string without interning it
+        std::optional<Symbol> find(std::string_view str) const;
+        /// The shared copy of an interned string. The pointer stays valid
+        /// forever
+        String const* string(Symbol symbol) const;
+        /// Whether a string is one of the shared copies owned by the table,
+        /// as opposed to a temporary created at runtime. This doesn't lock
+        /// the table, since the interpreter checks every string it stores
+        bool owns(String const* str) const;
+        size_t size() const;
+    };
+
+    inline Symbol intern(std::string_view str) {
+        return SymbolTable::get().intern(str);
+    }
+}
@@ -0,0 +1,73 @@
+#include "TaskScheduler.hpp"
+#include <algorithm>
+
+using namespace dash::lang;
+
+Script::Script(Module&& module)
+  : m_module(std::move(module)),
+    m_vm(m_module)
+{
+    m_vm.setScript(this);
+}
+
+TaskScheduler& TaskScheduler::get() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+void TaskScheduler::setFrameBudget(std::chrono::microseconds budget) {
+    m_frameBudget = budget;
+}
+
+void TaskScheduler::setErrorHandler(ErrorHandler handler) {
+    m_errorHandler = std::move(handler);
+}
+
+void TaskScheduler::setTickScheduler(std::function<void()> scheduler) {
+    m_tickScheduler = std::move(scheduler);
+}
+
+void TaskScheduler::add(std::shared_ptr<Script> script) {
+    if (!script->vm().hasTasks()) {
+        return;
+    }
+    if (std::find(m_scripts.begin(), m_scripts.end(), script) != m_scripts.end()) {
+        return;
+    }
+    bool wasIdle = m_scripts.empty();
+    m_scripts.push_back(std::move(script));
+    if (wasIdle && m_tickScheduler) {
+        m_tickScheduler();
+    }
+}
+
+void TaskScheduler::cancel(Script& script) {
+    script.vm().cancelTasks();
+    if (!m_ticking) {
+        std::erase_if(m_scripts, [&](auto const& s) { return s.get() == &script; });
+    }
+}
+
+bool TaskScheduler::tick() {
+    m_ticking = true;
+    auto deadline = Clock::now() + m_frameBudget;
+    // Scripts that tasks add while resuming wait for the next tick
+    auto count = m_scripts.size();
+    std::vector<RuntimeError> errors;
+    for (size_t i = 0; i < count && (i == 0 || Clock::now() < deadline); i += 1) {
+        // Tasks can add scripts, so the list may be reallocated while this
+        // one runs
+        auto script = m_scripts[(m_next + i) % count];
+        script->vm().resume(deadline, errors);
+        for (auto const& error : errors) {
+            if (m_errorHandler) {
+                m_errorHandler(*script, error);
+            }
+        }
+        errors.clear();
+    }
+    m_ticking = false;
+    std::erase_if(m_scripts, [](auto const& script) { return !script->vm().hasTasks(); });
+    m_next = m_scripts.empty() ? 0 : (m_next + 1) % m_scripts.size();
+    return !m_scripts.empty();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Module.hpp"
+#include "Reactive.hpp"
+#include "VM.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace dash::lang {
+    /// A module together with the VM running it. Scripts are shared, so the
+    /// task scheduler and callbacks into the script can keep one alive for
+    /// as long as they need it, even if whatever ran it is long done with it
+    class Script final : public std::enable_shared_from_this<Script> {
+    private:
+        Module m_module;
+        VM m_vm;
+        SignalTable m_signals;
+        std::vector<ReactiveID> m_effects;
+
+    public:
+        Script(Module&& module);
+
+        Script(Script const&) = delete;
+        Script& operator=(Script const&) = delete;
+
+        Module const& module() const {
+            return m_module;
+        }
+        VM& vm() {
+            return m_vm;
+        }
+        /// The signals and derived values the script created
+        SignalTable& signals() {
+            return m_signals;
+        }
+        /// The effects the script created that haven't been destroyed yet.
+        /// Effects are owned by whatever they're attached to, but stopped
+        /// along with the script when it's unloaded
+        std::vector<ReactiveID>& effects() {
+            return m_effects;
+        }
+    };
+
+    /// Resumes the tasks of every script once per frame, with all of them
+    /// sharing a fixed time budget. Work that would stall a frame, like
+    /// building a large layer, can be done in an async function and is then
+    /// spread over as many frames as it needs
+    class TaskScheduler final {
+    public:
+        using Clock = VM::Clock;
+        using ErrorHandler = std::function<void(Script& script, RuntimeError const& error)>;
+
+        /// How long tasks get to run each frame unless configured otherwise
+        static constexpr std::chrono::microseconds DEFAULT_FRAME_BUDGET { 4000 };
+
+    private:
+        std::vector<std::shared_ptr<Script>> m_scripts;
+        /// Index of the script that gets to run first on the next tick, so
+        /// one busy script can't take the whole budget every frame
+        size_t m_next = 0;
+        std::chrono::microseconds m_frameBudget = DEFAULT_FRAME_BUDGET;
+        ErrorHandler m_errorHandler;
+        std::function<void()> m_tickScheduler;
+        /// Scripts can't be removed from the list while it's being ticked,
+        /// so scripts cancelled by a task are only dropped once it's done
+        bool m_ticking = false;
+
+        TaskScheduler() = default;
+
+    public:
+        static TaskScheduler& get();
+
+        TaskScheduler(TaskScheduler const&) = delete;
+        TaskScheduler& operator=(TaskScheduler const&) = delete;
+
+        void setFrameBudget(std::chrono::microseconds budget);
+        std::chrono::microseconds getFrameBudget() const {
+            return m_frameBudget;
+        }
+        /// Install a function to report errors of failed tasks with.
+        /// Without one, failed tasks are dropped silently
+        void setErrorHandler(ErrorHandler handler);
+        /// Install a function that arranges for `tick` to be called once
+        /// every frame until it returns false. It's called whenever the
+        /// scheduler goes from having nothing to do to having tasks
+        void setTickScheduler(std::function<void()> scheduler);
+
+        /// Keep a script alive and resume its tasks every frame until it has
+        /// none left. Scripts without tasks are ignored
+        void add(std::shared_ptr<Script> script);
+        /// Drop every task of a script, for example once the node it builds
+        /// into is gone. Can be called from one of the script's own tasks
+        void cancel(Script& script);
+        bool isIdle() const {
+            return m_scripts.empty();
+        }
+
+        /// Resume tasks until they are all suspended or the frame's budget
+        /// runs out. Returns whether any tasks are left
+        bool tick();
+    };
+}
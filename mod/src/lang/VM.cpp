@@ -0,0 +1,863 @@
+#include "VM.hpp"
+#include "Profiler.hpp"
+#include "PropertyBatch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <limits>
+#include <unordered_map>
+
+using namespace dash::lang;
+
+static std::unordered_map<std::string, NativeFunction>& natives() {
+    static std::unordered_map<std::string, NativeFunction> natives;
+    return natives;
+}
+
+void dash::lang::registerNative(std::string_view name, NativeFunction function) {
+    natives().insert_or_assign(std::string(name), function);
+}
+
+NativeFunction dash::lang::findNative(std::string_view name) {
+    auto it = natives().find(std::string(name));
+    return it != natives().end() ? it->second : nullptr;
+}
+
+char const* dash::lang::valueTypeName(ValueType type) {
+    switch (type) {
+        case ValueType::Void:     return "void";
+        case ValueType::Bool:     return "bool";
+        case ValueType::Int:      return "int";
+        case ValueType::Float:    return "float";
+        case ValueType::String:   return "string";
+        case ValueType::Function: return "function";
+        case ValueType::Object:   return "object";
+        case ValueType::Color:    return "color";
+    }
+    return "unknown";
+}
+
+/// Check a value read through a property site against the type the site
+/// expects, reading ints as floats
+static bool matchPropertyType(PropertyType type, Value& value) {
+    switch (type) {
+        case PropertyType::Any: return true;
+        case PropertyType::Int: return value.is(ValueType::Int);
+        case PropertyType::String: return value.is(ValueType::String);
+        case PropertyType::Object: return value.is(ValueType::Object);
+        case PropertyType::Float: {
+            if (value.is(ValueType::Int)) {
+                value = Value::fromFloat(value.asNumber());
+            }
+            return value.is(ValueType::Float);
+        }
+    }
+    return false;
+}
+
+static char const* propertyTypeName(PropertyType type) {
+    switch (type) {
+        case PropertyType::Any:    return "value";
+        case PropertyType::Int:    return "int";
+        case PropertyType::String: return "string";
+        case PropertyType::Float:  return "number";
+        case PropertyType::Object: return "object";
+    }
+    return "unknown";
+}
+
+VM::Fiber::Fiber(size_t stackSize)
+  : stack(new Value[stackSize]),
+    stackEnd(stack.get() + stackSize)
+{
+    // Frames are referenced by pointer while executing, so the frame stack
+    // must never reallocate
+    frames.reserve(MAX_FRAMES);
+}
+
+VM::VM(Module const& module)
+  : m_module(module),
+    m_main(STACK_SIZE),
+    m_fiber(&m_main),
+    m_globals(module.globalCount()),
+    m_globalStrings(module.globalCount()),
+    m_propertyCaches(module.propertySites().size()),
+    m_hotness(module.functions().size()),
+    m_jit(module.functions().size())
+{}
+
+std::optional<std::string> VM::link() {
+    m_natives.clear();
+    for (auto const& import : m_module.natives()) {
+        auto name = m_module.string(import.name)->view();
+        auto native = findNative(name);
+        if (!native) {
+            return fmt::format("Unknown native function '{}'", name);
+        }
+        m_natives.push_back(native);
+    }
+    return std::nullopt;
+}
+
+void VM::raise(std::string message) {
+    if (m_error) {
+        return;
+    }
+    RuntimeError error { std::move(message), 0, 0 };
+    if (!m_fiber->frames.empty()) {
+        auto const& frame = m_fiber->frames.back();
+        error.function = this->idOf(*frame.function);
+        error.pc = static_cast<uint32_t>(frame.ip - m_module.code(*frame.function)) - 1;
+    }
+    m_error = std::move(error);
+}
+
+std::string VM::formatError(RuntimeError const& error) const {
+    auto const& fun = m_module.function(error.function);
+    if (auto span = m_module.debugSpan(fun, error.pc)) {
+        return fmt::format(
+            "{} (in {} at {}:{}:{})",
+            error.message, m_module.string(fun.name)->view(),
+            m_module.string(span->file)->view(), span->line, span->column
+        );
+    }
+    return fmt::format(
+        "{} (in {}+{})",
+        error.message, m_module.string(fun.name)->view(), error.pc
+    );
+}
+
+String const* VM::allocString(size_t size, char*& data) {
+    // Strings store their size in 32 bits
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        this->raise(fmt::format("String of {} bytes is too long", size));
+        return nullptr;
+    }
+    auto mem = m_fiber->arena.allocate(sizeof(uint32_t) + size + 1, alignof(String));
+    auto str = reinterpret_cast<String*>(mem);
+    str->size = static_cast<uint32_t>(size);
+    str->data[size] = '\0';
+    data = str->data;
+    return str;
+}
+
+String const* VM::makeString(std::string_view str) {
+    char* data;
+    auto ret = this->allocString(str.size(), data);
+    if (ret) {
+        std::memcpy(data, str.data(), str.size());
+    }
+    return ret;
+}
+
+String const* VM::concat(String const* a, String const* b) {
+    char* data;
+    auto ret = this->allocString(size_t(a->size) + b->size, data);
+    if (ret) {
+        std::memcpy(data, a->data, a->size);
+        std::memcpy(data + a->size, b->data, b->size);
+    }
+    return ret;
+}
+
+String const* VM::repeat(String const* str, int64_t times) {
+    times = std::max<int64_t>(times, 0);
+    // Checked before multiplying, since the product may not even fit in 64
+    // bits
+    if (str->size != 0 && static_cast<uint64_t>(times) > std::numeric_limits<uint32_t>::max() / str->size) {
+        this->raise(fmt::format("Repeating a string of {} bytes {} times is too long", str->size, times));
+        return nullptr;
+    }
+    char* data;
+    auto ret = this->allocString(size_t(str->size) * times, data);
+    for (int64_t i = 0; i < times; i += 1) {
+        std::memcpy(data + size_t(str->size) * i, str->data, str->size);
+    }
+    return ret;
+}
+
+NativeProperty const* VM::resolveProperty(uint32_t site, ClassKey key, void* object) {
+    auto const& cache = m_propertyCaches[site];
+    for (uint8_t i = 0; i < cache.count; i += 1) {
+        if (cache.keys[i] == key) {
+            return cache.properties[i];
+        }
+    }
+    return this->resolvePropertySlow(site, key, object);
+}
+
+NativeProperty const* VM::resolvePropertySlow(uint32_t site, ClassKey key, void* object) {
+    auto cls = nativeClassOf(key, object);
+    if (!cls) {
+        return nullptr;
+    }
+    auto prop = cls->findProperty(m_module.propertySymbol(site));
+    if (!prop) {
+        return nullptr;
+    }
+    auto& cache = m_propertyCaches[site];
+    uint8_t way;
+    if (cache.count < PropertyCache::WAYS) {
+        way = cache.count++;
+    }
+    else {
+        // Megamorphic sites just keep the most recent classes
+        way = cache.next;
+        cache.next = (cache.next + 1) % PropertyCache::WAYS;
+    }
+    cache.keys[way] = key;
+    cache.properties[way] = prop;
+    return prop;
+}
+
+JitFunction const* VM::warm(FunctionID id) {
+    if (auto const& jit = m_jit[id]) {
+        return jit.get();
+    }
+    if (++m_hotness[id] == JIT_THRESHOLD) {
+        m_jit[id] = JitFunction::compile(m_module, m_module.function(id));
+    }
+    return m_jit[id].get();
+}
+
+std::optional<Value> VM::call(FunctionID id, std::span<const Value> args) {
+    auto& fiber = *m_fiber;
+    Value* base = fiber.stack.get();
+    if (fiber.frames.empty()) {
+        // Strings from the previous call's result are no longer referenced
+        fiber.arena.reset();
+        m_error = std::nullopt;
+    }
+    else {
+        // Called from a native; the native's arguments are still in use, so
+        // put the new frame after the caller's register window
+        auto const& top = fiber.frames.back();
+        base = top.base + top.function->registerCount;
+    }
+
+    auto const& fun = m_module.function(id);
+    if (args.size() != fun.paramCount) {
+        this->raise(fmt::format(
+            "Function {} expects {} arguments, got {}",
+            m_module.string(fun.name)->view(), fun.paramCount, args.size()
+        ));
+        return std::nullopt;
+    }
+    if (fun.flags & FUNCTION_ASYNC) {
+        if (!this->spawn(fun, args.data())) {
+            return std::nullopt;
+        }
+        return Value();
+    }
+    if (fiber.frames.size() >= MAX_FRAMES || base + fun.registerCount > fiber.stackEnd) {
+        this->raise("Stack overflow");
+        return std::nullopt;
+    }
+
+    std::copy(args.begin(), args.end(), base);
+    std::fill(base + fun.paramCount, base + fun.registerCount, Value());
+
+    auto depth = fiber.frames.size();
+    this->warm(id);
+    fiber.frames.push_back({ &fun, m_module.code(fun), base });
+    if (auto profiler = Profiler::current()) {
+        profiler->enter(m_module, id);
+    }
+    Value result;
+    if (!this->execute(depth, result)) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+std::optional<Value> VM::run(std::span<const Value> args) {
+    return this->call(m_module.entry(), args);
+}
+
+bool VM::spawn(FunctionProto const& fun, Value const* args) {
+    if (fun.registerCount > TASK_STACK_SIZE) {
+        this->raise(fmt::format(
+            "Function {} needs {} registers, but tasks only have {}",
+            m_module.string(fun.name)->view(), fun.registerCount, TASK_STACK_SIZE
+        ));
+        return false;
+    }
+    auto task = std::make_unique<Fiber>(TASK_STACK_SIZE);
+    Value* base = task->stack.get();
+    for (uint8_t i = 0; i < fun.paramCount; i += 1) {
+        auto value = args[i];
+        if (value.is(ValueType::String) && !SymbolTable::get().owns(value.asString())) {
+            // The spawner's temporaries may be gone by the time the task
+            // runs, so the task gets its own copies
+            auto str = value.asString();
+            auto mem = task->arena.allocate(sizeof(uint32_t) + str->size + 1, alignof(String));
+            std::memcpy(mem, str, sizeof(uint32_t) + str->size + 1);
+            value = Value::fromString(reinterpret_cast<String const*>(mem));
+        }
+        base[i] = value;
+    }
+    std::fill(base + fun.paramCount, base + fun.registerCount, Value());
+    task->frames.push_back({ &fun, m_module.code(fun), base });
+    m_tasks.push_back(std::move(task));
+    return true;
+}
+
+bool VM::resume(Clock::time_point deadline, std::vector<RuntimeError>& errors) {
+    // Suspended tasks go to the back of the queue, and tasks spawned while
+    // resuming have to wait for the next resume
+    auto count = m_tasks.size();
+    m_cancelled = false;
+    for (size_t i = 0; i < count && !m_cancelled && (i == 0 || Clock::now() < deadline); i += 1) {
+        auto task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+
+        m_fiber = task.get();
+        auto profiler = Profiler::current();
+        if (profiler) {
+            // Only the first slice of a task is a call; the later ones
+            // continue the calls it was suspended in
+            for (auto const& frame : task->frames) {
+                profiler->enter(m_module, this->idOf(*frame.function), !task->started);
+            }
+        }
+        task->started = true;
+        m_deadline = deadline;
+        m_untilDeadlineCheck = DEADLINE_CHECK_INTERVAL;
+        m_suspended = false;
+        m_error = std::nullopt;
+        Value result;
+        bool ok = this->execute(0, result);
+        m_fiber = &m_main;
+
+        if (!ok) {
+            errors.push_back(std::move(*m_error));
+            m_error = std::nullopt;
+        }
+        else if (m_suspended) {
+            if (profiler) {
+                for (size_t i = 0; i < task->frames.size(); i += 1) {
+                    profiler->leave();
+                }
+            }
+            if (!m_cancelled) {
+                m_tasks.push_back(std::move(task));
+            }
+        }
+    }
+    return !m_tasks.empty();
+}
+
+void VM::cancelTasks() {
+    m_tasks.clear();
+    m_cancelled = m_fiber != &m_main;
+}
+
+void VM::replaceObjects(std::unordered_map<void*, void*> const& replacements) {
+    auto replace = [&](Value& value) {
+        if (!value.is(ValueType::Object)) {
+            return;
+        }
+        auto it = replacements.find(value.asObject());
+        if (it != replacements.end()) {
+            value = Value::fromObject(it->second);
+        }
+    };
+    for (auto& global : m_globals) {
+        replace(global);
+    }
+    for (auto const& task : m_tasks) {
+        for (auto const& frame : task->frames) {
+            std::for_each(frame.base, frame.base + frame.function->registerCount, replace);
+        }
+    }
+    if (auto it = replacements.find(m_root); it != replacements.end()) {
+        m_root = it->second;
+    }
+}
+
+bool VM::execute(size_t baseDepth, Value& result) {
+    auto& frames = m_fiber->frames;
+    Frame* frame = &frames.back();
+    Instr const* ip = frame->ip;
+    Value* r = frame->base;
+    Value* const stackEnd = m_fiber->stackEnd;
+    // Native code of the current function, if it has been compiled
+    JitFunction const* jit = m_jit[this->idOf(*frame->function)].get();
+    // A task can only be suspended if no native is calling into it, since
+    // the native's C++ frames can't be suspended along with it
+    bool const suspendable = m_fiber != &m_main && baseDepth == 0;
+
+    // Save the instruction pointer so errors know where they came from, then
+    // bail out
+    #define DASH_VM_ERROR(...) do {                     \
+        frame->ip = ip;                                 \
+        this->raise(fmt::format(__VA_ARGS__));          \
+        goto error;                                     \
+    } while (false)
+
+    // Tasks check their deadline at function entries and backward jumps,
+    // so even a task that never yields can't hold up the frame for long
+    #define DASH_VM_SAFEPOINT() do {                                        \
+        if (auto profiler = Profiler::current()) [[unlikely]] {             \
+            profiler->poll();                                               \
+        }                                                                   \
+        if (suspendable && --m_untilDeadlineCheck == 0) {                   \
+            m_untilDeadlineCheck = DEADLINE_CHECK_INTERVAL;                 \
+            if (Clock::now() >= m_deadline) {                               \
+                frame->ip = ip;                                             \
+                m_suspended = true;                                         \
+                return true;                                                \
+            }                                                               \
+        }                                                                   \
+    } while (false)
+
+    #define DASH_VM_ENTER(callee, base) do {                                \
+        if (frames.size() >= MAX_FRAMES || (base) + (callee).registerCount > stackEnd) { \
+            DASH_VM_ERROR("Stack overflow");                                \
+        }                                                                   \
+        std::fill((base) + (callee).paramCount, (base) + (callee).registerCount, Value()); \
+        frame->ip = ip;                                                     \
+        frames.push_back({ &(callee), m_module.code(callee), (base) });     \
+        frame = &frames.back();                                             \
+        ip = frame->ip;                                                     \
+        r = (base);                                                         \
+        jit = this->warm(this->idOf(callee));                               \
+        if (auto profiler = Profiler::current()) [[unlikely]] {             \
+            profiler->enter(m_module, this->idOf(callee));                  \
+        }                                                                   \
+        DASH_VM_SAFEPOINT();                                                \
+    } while (false)
+
+    // Loops count towards making a function hot, and start running in
+    // native code as soon as it's been compiled
+    #define DASH_VM_BACKWARD_JUMP() do {                                    \
+        jit = this->warm(this->idOf(*frame->function));                     \
+        DASH_VM_SAFEPOINT();                                                \
+    } while (false)
+
+    while (true) {
+        if (jit) {
+            // Native code runs until an instruction it can't handle, which
+            // is interpreted below before switching back. Instructions that
+            // don't start a long enough compiled run are interpreted right
+            // away, since switching would cost more than it saves
+            auto code = m_module.code(*frame->function);
+            auto pc = static_cast<uint32_t>(ip - code);
+            if (jit->isEntry(pc)) {
+                ip = code + jit->run(r, pc);
+            }
+        }
+        Instr const ins = *ip++;
+        switch (ins.op()) {
+            case Op::Nop: break;
+
+            case Op::Move: {
+                r[ins.a()] = r[ins.b()];
+            } break;
+
+            case Op::LoadConst: {
+                r[ins.a()] = m_module.constant(ins.bx());
+            } break;
+
+            case Op::LoadInt: {
+                r[ins.a()] = Value::fromInt(ins.sbx());
+            } break;
+
+            case Op::LoadBool: {
+                r[ins.a()] = Value::fromBool(ins.b() != 0);
+            } break;
+
+            case Op::LoadVoid: {
+                r[ins.a()] = Value();
+            } break;
+
+            case Op::LoadFunction: {
+                r[ins.a()] = Value::fromFunction(ins.bx());
+            } break;
+
+            case Op::GetGlobal: {
+                r[ins.a()] = m_globals[ins.bx()];
+            } break;
+
+            case Op::SetGlobal: {
+                auto value = r[ins.a()];
+                if (value.is(ValueType::String) && !SymbolTable::get().owns(value.asString())) {
+                    // Temporaries are freed after the call returns, so the
+                    // global needs its own copy
+                    m_globalStrings[ins.bx()].reset();
+                    auto str = value.asString();
+                    auto mem = std::make_unique<uint8_t[]>(sizeof(uint32_t) + str->size + 1);
+                    std::memcpy(mem.get(), str, sizeof(uint32_t) + str->size + 1);
+                    value = Value::fromString(reinterpret_cast<String const*>(mem.get()));
+                    m_globalStrings[ins.bx()] = std::move(mem);
+                }
+                m_globals[ins.bx()] = value;
+            } break;
+
+            case Op::GetProp: case Op::SetProp: {
+                auto const& target = r[ins.a()];
+                auto name = [&] {
+                    return m_module.string(m_module.propertySites()[ins.bx()].name)->view();
+                };
+                if (!target.is(ValueType::Object)) {
+                    DASH_VM_ERROR(
+                        "Cannot access property '{}' on a value of type {}",
+                        name(), valueTypeName(target.type())
+                    );
+                }
+                auto object = target.asObject();
+                if (!object) {
+                    DASH_VM_ERROR("Cannot access property '{}' on a null object", name());
+                }
+                auto key = classKeyOf(object);
+                auto prop = this->resolveProperty(ins.bx(), key, object);
+                if (!prop) {
+                    auto cls = nativeClassOf(key, object);
+                    DASH_VM_ERROR("{} has no property '{}'", cls ? cls->name() : "Object", name());
+                }
+                frame->ip = ip;
+                auto& batch = PropertyBatch::get();
+                if (ins.op() == Op::GetProp) {
+                    Value const* staged = nullptr;
+                    if (prop->group && !batch.empty()) {
+                        staged = batch.staged(object, *prop);
+                    }
+                    Value value;
+                    if (staged) {
+                        value = *staged;
+                    }
+                    else {
+                        auto start = Profiler::current() ? Profiler::Clock::now() : Profiler::Clock::time_point();
+                        value = prop->getter(*this, object);
+                        if (auto profiler = Profiler::current()) [[unlikely]] {
+                            profiler->property(m_module.propertySymbol(ins.bx()), start);
+                        }
+                        if (m_error) {
+                            goto error;
+                        }
+                    }
+                    auto type = m_module.propertySites()[ins.bx()].type;
+                    if (!matchPropertyType(type, value)) {
+                        DASH_VM_ERROR("Property '{}' is not a {}", name(), propertyTypeName(type));
+                    }
+                    r[ins.a()] = value;
+                }
+                else if (prop->group) {
+                    auto const& value = r[ins.a() + 1];
+                    if (!prop->check(*this, value)) {
+                        goto error;
+                    }
+                    batch.stage(object, *prop, value);
+                }
+                else {
+                    if (!prop->setter) {
+                        DASH_VM_ERROR("Property '{}' is read-only", name());
+                    }
+                    auto start = Profiler::current() ? Profiler::Clock::now() : Profiler::Clock::time_point();
+                    prop->setter(*this, object, r[ins.a() + 1]);
+                    if (auto profiler = Profiler::current()) [[unlikely]] {
+                        profiler->property(m_module.propertySymbol(ins.bx()), start);
+                    }
+                    if (m_error) {
+                        goto error;
+                    }
+                }
+            } break;
+
+            case Op::Add: case Op::Sub: case Op::Mul: case Op::Div: case Op::Mod: {
+                auto const& a = r[ins.b()];
+                auto const& b = r[ins.c()];
+                if (a.is(ValueType::Int) && b.is(ValueType::Int)) {
+                    auto x = a.asInt(), y = b.asInt();
+                    // Add, subtract and multiply unsigned so overflow wraps 
+                    // instead of being UB, like the typed int ops
+                    auto ux = static_cast<uint64_t>(x), uy = static_cast<uint64_t>(y);
+                    switch (ins.op()) {
+                        case Op::Add: r[ins.a()] = Value::fromInt(static_cast<int64_t>(ux + uy)); break;
+                        case Op::Sub: r[ins.a()] = Value::fromInt(static_cast<int64_t>(ux - uy)); break;
+                        case Op::Mul: r[ins.a()] = Value::fromInt(static_cast<int64_t>(ux * uy)); break;
+                        default: {
+                            if (y == 0) {
+                                DASH_VM_ERROR("Integer division by zero");
+                            }
+                            r[ins.a()] = Value::fromInt(ins.op() == Op::Div ? x / y : x % y);
+                        } break;
+                    }
+                }
+                else if (
+                    (a.is(ValueType::Int) || a.is(ValueType::Float)) &&
+                    (b.is(ValueType::Int) || b.is(ValueType::Float))
+                ) {
+                    auto x = a.asNumber(), y = b.asNumber();
+                    switch (ins.op()) {
+                        case Op::Add: r[ins.a()] = Value::fromFloat(x + y); break;
+                        case Op::Sub: r[ins.a()] = Value::fromFloat(x - y); break;
+                        case Op::Mul: r[ins.a()] = Value::fromFloat(x * y); break;
+                        case Op::Div: r[ins.a()] = Value::fromFloat(x / y); break;
+                        default: {
+                            // `int % float` is an int, matching the checker.
+                            // NaN, like from a modulo by zero, has no int
+                            // value to convert to
+                            auto mod = std::fmod(x, y);
+                            if (!a.is(ValueType::Int)) {
+                                r[ins.a()] = Value::fromFloat(mod);
+                            }
+                            else if (std::isfinite(mod)) {
+                                r[ins.a()] = Value::fromInt(static_cast<int64_t>(mod));
+                            }
+                            else {
+                                DASH_VM_ERROR("Integer modulo by {} has no result", y);
+                            }
+                        } break;
+                    }
+                }
+                else if (ins.op() == Op::Add && a.is(ValueType::String) && b.is(ValueType::String)) {
+                    // Strings that are too long raise an error
+                    frame->ip = ip;
+                    auto str = this->concat(a.asString(), b.asString());
+                    if (!str) {
+                        goto error;
+                    }
+                    r[ins.a()] = Value::fromString(str);
+                }
+                else if (ins.op() == Op::Mul && a.is(ValueType::String) && b.is(ValueType::Int)) {
+                    // Strings that are too long raise an error
+                    frame->ip = ip;
+                    auto str = this->repeat(a.asString(), b.asInt());
+                    if (!str) {
+                        goto error;
+                    }
+                    r[ins.a()] = Value::fromString(str);
+                }
+                else {
+                    DASH_VM_ERROR(
+                        "Invalid operand types {} and {} for arithmetic",
+                        valueTypeName(a.type()), valueTypeName(b.type())
+                    );
+                }
+            } break;
+
+            case Op::Neg: {
+                auto const& a = r[ins.b()];
+                if (a.is(ValueType::Int)) {
+                    r[ins.a()] = Value::fromInt(-a.asInt());
+                }
+                else if (a.is(ValueType::Float)) {
+                    r[ins.a()] = Value::fromFloat(-a.asFloat());
+                }
+                else {
+                    DASH_VM_ERROR("Cannot negate a value of type {}", valueTypeName(a.type()));
+                }
+            } break;
+
+            case Op::Not: {
+                auto const& a = r[ins.b()];
+                if (!a.is(ValueType::Bool)) {
+                    DASH_VM_ERROR("Cannot invert a value of type {}", valueTypeName(a.type()));
+                }
+                r[ins.a()] = Value::fromBool(!a.asBool());
+            } break;
+
+            case Op::Eq: {
+                r[ins.a()] = Value::fromBool(r[ins.b()] == r[ins.c()]);
+            } break;
+
+            case Op::Neq: {
+                r[ins.a()] = Value::fromBool(!(r[ins.b()] == r[ins.c()]));
+            } break;
+
+            case Op::Less: case Op::Leq: case Op::Grt: case Op::Geq: {
+                auto const& a = r[ins.b()];
+                auto const& b = r[ins.c()];
+                // Numbers are compared with the operators themselves rather 
+                // than through a three-way comparison, so every comparison 
+                // with NaN is false like in the typed float ops
+                auto compare = [op = ins.op()](auto const& x, auto const& y) {
+                    switch (op) {
+                        case Op::Less: return x < y;
+                        case Op::Leq:  return x <= y;
+                        case Op::Grt:  return x > y;
+                        default:       return x >= y;
+                    }
+                };
+                bool res;
+                if (a.is(ValueType::Int) && b.is(ValueType::Int)) {
+                    res = compare(a.asInt(), b.asInt());
+                }
+                else if (
+                    (a.is(ValueType::Int) || a.is(ValueType::Float)) &&
+                    (b.is(ValueType::Int) || b.is(ValueType::Float))
+                ) {
+                    res = compare(a.asNumber(), b.asNumber());
+                }
+                else if (a.is(ValueType::String) && b.is(ValueType::String)) {
+                    res = compare(a.asString()->view(), b.asString()->view());
+                }
+                else {
+                    DASH_VM_ERROR(
+                        "Cannot compare values of types {} and {}",
+                        valueTypeName(a.type()), valueTypeName(b.type())
+                    );
+                }
+                r[ins.a()] = Value::fromBool(res);
+            } break;
+
+            case Op::AddInt: {
+                r[ins.a()] = Value::fromInt(r[ins.b()].asInt() + r[ins.c()].asInt());
+            } break;
+
+            case Op::SubInt: {
+                r[ins.a()] = Value::fromInt(r[ins.b()].asInt() - r[ins.c()].asInt());
+            } break;
+
+            case Op::MulInt: {
+                // Multiply unsigned so overflow wraps instead of being UB
+                auto x = static_cast<uint64_t>(r[ins.b()].asInt());
+                auto y = static_cast<uint64_t>(r[ins.c()].asInt());
+                r[ins.a()] = Value::fromInt(static_cast<int64_t>(x * y));
+            } break;
+
+            case Op::LessInt: {
+                r[ins.a()] = Value::fromBool(r[ins.b()].asInt() < r[ins.c()].asInt());
+            } break;
+
+            case Op::LeqInt: {
+                r[ins.a()] = Value::fromBool(r[ins.b()].asInt() <= r[ins.c()].asInt());
+            } break;
+
+            case Op::AddFloat: {
+                r[ins.a()] = Value::fromFloat(r[ins.b()].asFloat() + r[ins.c()].asFloat());
+            } break;
+
+            case Op::SubFloat: {
+                r[ins.a()] = Value::fromFloat(r[ins.b()].asFloat() - r[ins.c()].asFloat());
+            } break;
+
+            case Op::MulFloat: {
+                r[ins.a()] = Value::fromFloat(r[ins.b()].asFloat() * r[ins.c()].asFloat());
+            } break;
+
+            case Op::DivFloat: {
+                r[ins.a()] = Value::fromFloat(r[ins.b()].asFloat() / r[ins.c()].asFloat());
+            } break;
+
+            case Op::LessFloat: {
+                r[ins.a()] = Value::fromBool(r[ins.b()].asFloat() < r[ins.c()].asFloat());
+            } break;
+
+            case Op::LeqFloat: {
+                r[ins.a()] = Value::fromBool(r[ins.b()].asFloat() <= r[ins.c()].asFloat());
+            } break;
+
+            case Op::Jump: {
+                ip += ins.sbx();
+                if (ins.sbx() < 0) {
+                    DASH_VM_BACKWARD_JUMP();
+                }
+            } break;
+
+            case Op::JumpIf: case Op::JumpIfNot: {
+                auto const& cond = r[ins.a()];
+                if (!cond.is(ValueType::Bool)) {
+                    DASH_VM_ERROR("Condition has type {}, expected bool", valueTypeName(cond.type()));
+                }
+                if (cond.asBool() == (ins.op() == Op::JumpIf)) {
+                    ip += ins.sbx();
+                    if (ins.sbx() < 0) {
+                        DASH_VM_BACKWARD_JUMP();
+                    }
+                }
+            } break;
+
+            case Op::Call: {
+                auto const& callee = m_module.function(ins.bx());
+                Value* base = r + ins.a();
+                DASH_VM_ENTER(callee, base);
+            } break;
+
+            case Op::CallValue: {
+                auto const& target = r[ins.b()];
+                if (!target.is(ValueType::Function)) {
+                    DASH_VM_ERROR("Cannot call a value of type {}", valueTypeName(target.type()));
+                }
+                auto const& callee = m_module.function(target.asFunction());
+                if (callee.flags & FUNCTION_ASYNC) {
+                    frame->ip = ip;
+                    if (!this->spawn(callee, r + ins.a())) {
+                        goto error;
+                    }
+                    r[ins.a()] = Value();
+                    break;
+                }
+                Value* base = r + ins.a();
+                DASH_VM_ENTER(callee, base);
+            } break;
+
+            case Op::CallNative: {
+                auto const& import = m_module.natives()[ins.bx()];
+                frame->ip = ip;
+                auto start = Profiler::current() ? Profiler::Clock::now() : Profiler::Clock::time_point();
+                auto ret = m_natives[ins.bx()](*this, std::span(r + ins.a(), import.paramCount));
+                if (auto profiler = Profiler::current()) [[unlikely]] {
+                    profiler->native(m_module, ins.bx(), start);
+                }
+                if (m_error) {
+                    goto error;
+                }
+                r[ins.a()] = ret;
+            } break;
+
+            case Op::Return: case Op::ReturnVoid: {
+                auto ret = ins.op() == Op::Return ? r[ins.a()] : Value();
+                if (auto profiler = Profiler::current()) [[unlikely]] {
+                    profiler->leave();
+                }
+                frames.pop_back();
+                if (frames.size() == baseDepth) {
+                    result = ret;
+                    return true;
+                }
+                // The callee's window starts at the caller's result register
+                *r = ret;
+                frame = &frames.back();
+                ip = frame->ip;
+                r = frame->base;
+                jit = m_jit[this->idOf(*frame->function)].get();
+            } break;
+
+            case Op::Spawn: {
+                frame->ip = ip;
+                if (!this->spawn(m_module.function(ins.bx()), r + ins.a())) {
+                    goto error;
+                }
+                r[ins.a()] = Value();
+            } break;
+
+            case Op::Yield: {
+                if (!suspendable) {
+                    DASH_VM_ERROR("Cannot yield while a native function is calling into the script");
+                }
+                frame->ip = ip;
+                m_suspended = true;
+                return true;
+            }
+
+            // The module has been verified, so this should never happen
+            default: DASH_VM_ERROR("Invalid opcode {}", static_cast<int>(ins.op()));
+        }
+    }
+
+error:
+    if (auto profiler = Profiler::current()) {
+        for (size_t i = baseDepth; i < frames.size(); i += 1) {
+            profiler->leave();
+        }
+    }
+    frames.resize(baseDepth);
+    return false;
+
+    #undef DASH_VM_ERROR
+    #undef DASH_VM_SAFEPOINT
+    #undef DASH_VM_ENTER
+    #undef DASH_VM_BACKWARD_JUMP
+}
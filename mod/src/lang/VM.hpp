@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Arena.hpp"
+#include "Jit.hpp"
+#include "Module.hpp"
+#include "NativeClass.hpp"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dash::lang {
+    class VM;
+    class Script;
+
+    /// A function implemented in C++ that scripts can call. Natives report
+    /// errors through `VM::raise`
+    using NativeFunction = Value(*)(VM& vm, std::span<const Value> args);
+
+    /// Register a native function that modules can import by name
+    void registerNative(std::string_view name, NativeFunction function);
+    NativeFunction findNative(std::string_view name);
+
+    struct RuntimeError {
+        std::string message;
+        /// Function and instruction where the error was raised
+        FunctionID function;
+        uint32_t pc;
+    };
+
+    /// Register-based bytecode interpreter. A VM runs one Module and keeps
+    /// that module's globals alive for as long as the VM exists.
+    ///
+    /// Calling an async function starts a task instead: a call stack of its
+    /// own that only runs when the VM is resumed, and that is suspended
+    /// whenever it yields or runs past the deadline it was resumed with
+    class VM final {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// Maximum number of registers across all active frames
+        static constexpr size_t STACK_SIZE = 1 << 14;
+        /// Maximum number of registers across all active frames of a task
+        static constexpr size_t TASK_STACK_SIZE = 1 << 11;
+        /// Maximum call depth
+        static constexpr size_t MAX_FRAMES = 256;
+        /// Tasks only read the clock at every this many function entries
+        /// and backward jumps, since reading it is comparatively slow
+        static constexpr uint32_t DEADLINE_CHECK_INTERVAL = 64;
+        /// Functions are compiled to native code once they've been entered
+        /// or looped in this many times
+        static constexpr uint32_t JIT_THRESHOLD = 256;
+
+    private:
+        struct Frame {
+            FunctionProto const* function;
+            /// Next instruction to execute once this frame is resumed
+            Instr const* ip;
+            Value* base;
+        };
+
+        /// A call stack that can be left and later resumed where it was.
+        /// Calls from C++ run on the main fiber, tasks each run on their own
+        struct Fiber {
+            std::unique_ptr<Value[]> stack;
+            Value* stackEnd;
+            std::vector<Frame> frames;
+            /// Transient state created while running, like strings. The main
+            /// fiber rewinds it when the next outermost call starts; a task's
+            /// lives as long as the task
+            Arena arena;
+            /// Whether a task has been resumed before
+            bool started = false;
+
+            Fiber(size_t stackSize);
+        };
+
+        /// Inline cache of a property access site: the properties the site
+        /// resolved to for the last few concrete classes it saw. Most sites
+        /// only ever see one class, so they're resolved by a single compare
+        struct PropertyCache {
+            static constexpr size_t WAYS = 4;
+            ClassKey keys[WAYS] {};
+            NativeProperty const* properties[WAYS] {};
+            uint8_t count = 0;
+            /// Entry to replace next once all ways are taken
+            uint8_t next = 0;
+        };
+
+        Module const& m_module;
+        Fiber m_main;
+        /// Tasks waiting to be resumed, in the order they'll run
+        std::deque<std::unique_ptr<Fiber>> m_tasks;
+        /// The fiber that is currently running
+        Fiber* m_fiber;
+        /// When the task that is running has to suspend
+        Clock::time_point m_deadline;
+        uint32_t m_untilDeadlineCheck = 0;
+        /// Set when the running task suspends instead of finishing
+        bool m_suspended = false;
+        /// Set when the tasks are cancelled while one of them is running, so
+        /// that task isn't queued again once it suspends
+        bool m_cancelled = false;
+        std::vector<Value> m_globals;
+        std::vector<NativeFunction> m_natives;
+        /// Copies of the temporary strings that have been stored in globals,
+        /// indexed by global
+        std::vector<std::unique_ptr<uint8_t[]>> m_globalStrings;
+        std::vector<PropertyCache> m_propertyCaches;
+        /// How often each function has been entered or looped in, until
+        /// it's compiled
+        std::vector<uint32_t> m_hotness;
+        /// Native code of the functions that have been compiled
+        std::vector<std::unique_ptr<JitFunction>> m_jit;
+        std::optional<RuntimeError> m_error;
+        void* m_root = nullptr;
+        Script* m_script = nullptr;
+
+        bool execute(size_t baseDepth, Value& result);
+        FunctionID idOf(FunctionProto const& function) const {
+            return static_cast<FunctionID>(&function - m_module.functions().data());
+        }
+        /// Note that a function was entered or looped in, compiling it once
+        /// it's hot. Returns its native code, if it has been compiled
+        JitFunction const* warm(FunctionID function);
+        /// Start a task running the function. Returns false after raising
+        /// an error if the task can't be started
+        bool spawn(FunctionProto const& function, Value const* args);
+        NativeProperty const* resolveProperty(uint32_t site, ClassKey key, void* object);
+        NativeProperty const* resolvePropertySlow(uint32_t site, ClassKey key, void* object);
+        String const* allocString(size_t size, char*& data);
+        String const* concat(String const* a, String const* b);
+        String const* repeat(String const* str, int64_t times);
+
+    public:
+        VM(Module const& module);
+
+        VM(VM const&) = delete;
+        VM& operator=(VM const&) = delete;
+
+        Module const& module() const {
+            return m_module;
+        }
+
+        /// Link the module's native imports, returning an error if an import
+        /// could not be found
+        std::optional<std::string> link();
+
+        /// Call a function. Strings in the result are temporary; they are
+        /// only valid until the next call into the VM. Calling an async
+        /// function only starts its task and returns void
+        std::optional<Value> call(FunctionID function, std::span<const Value> args);
+        /// Run the module's entry point
+        std::optional<Value> run(std::span<const Value> args);
+
+        /// Whether a call is in progress, like when a native calls back
+        /// into the VM
+        bool isRunning() const {
+            return !m_fiber->frames.empty();
+        }
+        /// Whether any tasks are waiting to be resumed
+        bool hasTasks() const {
+            return !m_tasks.empty();
+        }
+        size_t taskCount() const {
+            return m_tasks.size();
+        }
+        /// Run each waiting task until it yields, finishes or passes the
+        /// deadline, in turn. Every task runs at most once, and at least one
+        /// task runs even if the deadline has already passed. Errors of the
+        /// tasks that failed are appended to `errors`; those tasks are
+        /// dropped. Returns whether any tasks are left. Must not be called
+        /// while the VM is already running
+        bool resume(Clock::time_point deadline, std::vector<RuntimeError>& errors);
+        /// Drop every task. A task that is running finishes its current
+        /// slice, but isn't resumed again
+        void cancelTasks();
+
+        /// Raise an error from a native function; the calling script is
+        /// aborted once the native returns
+        void raise(std::string message);
+        std::optional<RuntimeError> const& error() const {
+            return m_error;
+        }
+        /// Format an error with the function and source location it
+        /// occurred in
+        std::string formatError(RuntimeError const& error) const;
+
+        /// Create a temporary string that lives until the outermost call
+        /// into the VM returns, or until the task creating it finishes.
+        /// Strings longer than their 32-bit size allows raise an error and
+        /// give null instead
+        String const* makeString(std::string_view str);
+        /// The arena temporaries are allocated from. Natives can use it for
+        /// scratch memory that only needs to live until the outermost call
+        /// into the VM returns, or until the task calling them finishes
+        Arena& arena() {
+            return m_fiber->arena;
+        }
+
+        /// The native object the module is run for, like the node a file
+        /// builds into. Natives find it through `root`. The object isn't
+        /// retained; whoever runs the module clears it once the object is
+        /// gone
+        void setRoot(void* object) {
+            m_root = object;
+        }
+        void* root() const {
+            return m_root;
+        }
+        /// Make the globals and the registers of waiting tasks that hold one
+        /// of the replaced objects hold its replacement instead, along with
+        /// the root. Used when the objects a script built are swapped for
+        /// others, like by hot reloading. Must not be called while the VM is
+        /// running
+        void replaceObjects(std::unordered_map<void*, void*> const& replacements);
+        /// The script this VM belongs to, if any. Natives that hold on to
+        /// script functions keep the script alive through it
+        void setScript(Script* script) {
+            m_script = script;
+        }
+        Script* script() const {
+            return m_script;
+        }
+    };
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace dash::lang {
+    /// Immutable string as laid out in memory. Literal strings point straight
+    /// into the module's string table, runtime strings are allocated by the VM
+    struct String {
+        uint32_t size;
+        char data[1];
+
+        std::string_view view() const {
+            return std::string_view(data, size);
+        }
+        bool operator==(String const& other) const {
+            return this == &other || view() == other.view();
+        }
+    };
+
+    using FunctionID = uint32_t;
+
+    enum class ValueType : uint8_t {
+        Void,
+        Bool,
+        Int,
+        Float,
+        String,
+        Function,
+        /// Opaque handle to a native object (usually a `CCNode*`)
+        Object,
+        /// A packed RGBA color, like `ccColor3B` or `ccColor4B`
+        Color,
+    };
+
+    /// Ints are 48 bits wide so they can be stored in a NaN-boxed Value.
+    /// Arithmetic wraps around at these bounds
+    constexpr int64_t MIN_INT = -(int64_t(1) << 47);
+    constexpr int64_t MAX_INT = (int64_t(1) << 47) - 1;
+
+    /// A dynamically typed value that can be stored in a VM register. Values
+    /// never own anything, so they are freely copyable
+    ///
+    /// Values are NaN-boxed into a single 64-bit word: floats are stored as
+    /// plain doubles, and every other type is stored in the 48-bit payload
+    /// of a negative quiet NaN, with the type in the 3 bits above it. Floats
+    /// that are NaN are canonicalized to a positive NaN so they can't be
+    /// confused with a boxed value. Native pointers have to fit in the
+    /// payload, which holds for user-space addresses on every platform the
+    /// mod runs on. None of this ever allocates, so arithmetic on any type
+    /// stays in registers
+    class Value final {
+    private:
+        static constexpr uint64_t BOXED = 0xfff8'0000'0000'0000;
+        static constexpr uint64_t PAYLOAD = 0x0000'ffff'ffff'ffff;
+        static constexpr uint64_t CANONICAL_NAN = 0x7ff8'0000'0000'0000;
+        static constexpr int TAG_SHIFT = 48;
+
+        /// Boxed value tags. Floats aren't boxed, so they don't have one
+        enum Tag : uint64_t {
+            TAG_VOID,
+            TAG_BOOL,
+            TAG_INT,
+            TAG_STRING,
+            TAG_FUNCTION,
+            TAG_OBJECT,
+            TAG_COLOR,
+        };
+
+        uint64_t m_bits = BOXED | (uint64_t(TAG_VOID) << TAG_SHIFT);
+
+        static Value boxed(Tag tag, uint64_t payload) {
+            Value ret;
+            ret.m_bits = BOXED | (uint64_t(tag) << TAG_SHIFT) | (payload & PAYLOAD);
+            return ret;
+        }
+        bool hasTag(Tag tag) const {
+            return (m_bits & ~PAYLOAD) == (BOXED | (uint64_t(tag) << TAG_SHIFT));
+        }
+        uint64_t payload() const {
+            return m_bits & PAYLOAD;
+        }
+
+    public:
+        Value() = default;
+
+        static Value fromBool(bool value) {
+            return boxed(TAG_BOOL, value);
+        }
+        static Value fromInt(int64_t value) {
+            return boxed(TAG_INT, static_cast<uint64_t>(value));
+        }
+        static Value fromFloat(double value) {
+            Value ret;
+            if (value != value) {
+                ret.m_bits = CANONICAL_NAN;
+            }
+            else {
+                std::memcpy(&ret.m_bits, &value, sizeof(double));
+            }
+            return ret;
+        }
+        static Value fromString(String const* value) {
+            return boxed(TAG_STRING, reinterpret_cast<uintptr_t>(value));
+        }
+        static Value fromFunction(FunctionID value) {
+            return boxed(TAG_FUNCTION, value);
+        }
+        static Value fromObject(void* value) {
+            return boxed(TAG_OBJECT, reinterpret_cast<uintptr_t>(value));
+        }
+        /// Create a color from its components packed as `0xRRGGBBAA`
+        static Value fromColor(uint32_t rgba) {
+            return boxed(TAG_COLOR, rgba);
+        }
+
+        ValueType type() const {
+            if (m_bits < BOXED) {
+                return ValueType::Float;
+            }
+            switch (static_cast<Tag>((m_bits >> TAG_SHIFT) & 0b111)) {
+                case TAG_VOID:     return ValueType::Void;
+                case TAG_BOOL:     return ValueType::Bool;
+                case TAG_INT:      return ValueType::Int;
+                case TAG_STRING:   return ValueType::String;
+                case TAG_FUNCTION: return ValueType::Function;
+                case TAG_OBJECT:   return ValueType::Object;
+                case TAG_COLOR:    return ValueType::Color;
+            }
+            return ValueType::Void;
+        }
+        bool is(ValueType type) const {
+            switch (type) {
+                case ValueType::Void:     return hasTag(TAG_VOID);
+                case ValueType::Bool:     return hasTag(TAG_BOOL);
+                case ValueType::Int:      return hasTag(TAG_INT);
+                case ValueType::Float:    return m_bits < BOXED;
+                case ValueType::String:   return hasTag(TAG_STRING);
+                case ValueType::Function: return hasTag(TAG_FUNCTION);
+                case ValueType::Object:   return hasTag(TAG_OBJECT);
+                case ValueType::Color:    return hasTag(TAG_COLOR);
+            }
+            return false;
+        }
+
+        bool asBool() const {
+            return payload() != 0;
+        }
+        int64_t asInt() const {
+            // Sign-extend the payload
+            return static_cast<int64_t>(m_bits << (64 - TAG_SHIFT)) >> (64 - TAG_SHIFT);
+        }
+        double asFloat() const {
+            double ret;
+            std::memcpy(&ret, &m_bits, sizeof(double));
+            return ret;
+        }
+        String const* asString() const {
+            return reinterpret_cast<String const*>(static_cast<uintptr_t>(payload()));
+        }
+        FunctionID asFunction() const {
+            return static_cast<FunctionID>(payload());
+        }
+        template <class T = void>
+        T* asObject() const {
+            return reinterpret_cast<T*>(static_cast<uintptr_t>(payload()));
+        }
+        /// The color's components packed as `0xRRGGBBAA`
+        uint32_t asColor() const {
+            return static_cast<uint32_t>(payload());
+        }
+
+        /// Numeric value of this Value, whether it's an int or a float
+        double asNumber() const {
+            return hasTag(TAG_INT) ? static_cast<double>(asInt()) : asFloat();
+        }
+
+        bool operator==(Value const& other) const {
+            // Floats compare numerically, so NaN != NaN and 0.0 == -0.0
+            if (m_bits < BOXED || other.m_bits < BOXED) {
+                // Ints and floats compare by their numeric value
+                if (
+                    (is(ValueType::Int) || is(ValueType::Float)) &&
+                    (other.is(ValueType::Int) || other.is(ValueType::Float))
+                ) {
+                    return asNumber() == other.asNumber();
+                }
+                return false;
+            }
+            if (m_bits == other.m_bits) {
+                return true;
+            }
+            // Strings that aren't the same pointer may still be equal
+            return hasTag(TAG_STRING) && other.hasTag(TAG_STRING) && *asString() == *other.asString();
+        }
+    };
+
+    static_assert(sizeof(Value) == 8, "Value should stay a single NaN-boxed word");
+
+    char const* valueTypeName(ValueType type);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dash::lang {
+    /// A fixed set of background threads that run jobs in the order they were
+    /// submitted. Used for work that doesn't touch any nodes, like reading
+    /// and compiling files, so it doesn't block the main thread
+    class WorkerPool final {
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::function<void()>> m_jobs;
+        std::vector<std::thread> m_threads;
+        bool m_stopping = false;
+
+        void work();
+
+    public:
+        /// The shared pool, with one thread less than the machine has cores
+        /// so the main thread always has one to itself
+        static WorkerPool& get();
+
+        WorkerPool(size_t threadCount);
+        /// Finishes the jobs that are already running, drops the rest
+        ~WorkerPool();
+
+        WorkerPool(WorkerPool const&) = delete;
+        WorkerPool& operator=(WorkerPool const&) = delete;
+
+        size_t threadCount() const {
+            return m_threads.size();
+        }
+
+        void post(std::function<void()> job);
+        /// Run a function on the pool, with a future for its result
+        template <class F>
+        auto submit(F&& func) -> std::future<std::invoke_result_t<F>> {
+            // std::function needs to be copyable, so the task is shared
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(func));
+            auto future = task->get_future();
+            this->post([task] { (*task)(); });
+            return future;
+        }
+    };
+}